@@ -8,6 +8,8 @@ typedef struct node { // 메모리 관리에 사용할 링크드 리스트의 
 	struct node *prev_node; // 이전 메모리 관리 노드의 주소
 } Node;
 
+#define MAX_NODE_COUNT ((int)(PAGESIZE / sizeof(Node))) // management_mem에 들어갈 수 있는 노드의 개수
+
 typedef struct mem_list { // 메모리 관리 링크드 리스트들 저장하는 구조체
 	Node *mem_in_use_head; // 할당되어 사용중인 메모리 영역 관리 링크드 리스트
 	Node *mem_not_in_use_head; // 사용중이지 않은 메모리 영역 관리 링크드 리스트
@@ -15,10 +17,23 @@ typedef struct mem_list { // 메모리 관리 링크드 리스트들 저장하
 
 char *mem; // heap 메모리 영역
 Node *management_mem; // 메모리 관리 링크드 리스트의 노드들을 할당할 메모리 영역
+Node *node_cursor; // management_mem에서 새 노드 자리를 찾기 시작할 위치
 MemLinkedList mem_linked_list; // 메모리 관리 링크드 리스트들 구조체
+char *alloc_bins[ALLOC_NUM_BINS]; // 크기별로 해제된 조각들을 모아두는 bin (alloc.h 참고)
+unsigned char alloc_binned[PAGESIZE / MINALLOC]; // 1이면 그 자리에서 시작하는 조각이 bin에 들어있다 (ALLOC_BINNED_INDEX로 접근)
 
 Node *getNewNode(); // 새로운 노드를 메모리에 할당하여 리턴하는 함수
 void removeNode(Node *node); // 더이상 사용하지 않는 노드를 메모리에서 해제하는 함수
+Node *findInUseNode(int mem_index); // 해당 주소의 in_use 노드를 찾는 함수
+void unlinkInUseNode(Node *node); // in_use 리스트에서 노드를 떼어내는 함수
+Node *insertFreeNode(Node *start, Node *node); // not_in_use 리스트에 노드를 넣고 병합하는 함수
+char *allocChunk(int size); // bin 또는 not_in_use 리스트에서 메모리를 할당하는 함수
+char *allocFromList(int size); // not_in_use 리스트에서 메모리를 할당하는 함수
+int allocBulk(int size, int n, char **out); // 한번의 탐색으로 n개 할당하는 함수
+int flushBins(); // bin에 모아둔 조각들을 해제하는 함수
+int alloc_bulk_fallback(int size, int n, char **out); // allocChunk()를 반복해 n개 할당하는 함수
+int compareAddr(const void *a, const void *b); // 주소 비교 함수
+int isSortedAddr(char **ptrs, int n); // 주소 정렬 여부 확인 함수
 
 int init_alloc() {
 	Node *new_node;
@@ -28,6 +43,7 @@ int init_alloc() {
 
 	management_mem = mmap(NULL, PAGESIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); // 메모리 관리 링크드 리스트에 사용할 메모리 영역을 mmap으로 할당
 	if (management_mem == MAP_FAILED) return -1; // mmap 실패시 -1 리턴
+	node_cursor = management_mem;
 
 	// 초기에는 메모리의 모든 공간이 할당 가능하므로 사용하지 않는 메모리 영역의 링크드 리스트에 메모리 전체 크기를 나타내는 노드를 넣는다
 	new_node = getNewNode(); // 새로운 노드 생성
@@ -59,21 +75,52 @@ int cleanup() {
 		node = node->next_node;
 	}
 
+	memset(alloc_bins, 0, sizeof(alloc_bins)); // bin 비움
+	memset(alloc_binned, 0, sizeof(alloc_binned));
+
 	if (!munmap(management_mem, PAGESIZE)) return -1;
 	if (!munmap(mem, PAGESIZE)) return -1;
 
 	return 0;
 }
 
-char *alloc(int size) {
-	Node *new_node;
-	Node *new_alloced_mem;
-	Node* mem_not_in_use;
+char *(alloc)(int size) { // alloc.h의 alloc() 매크로와 구분하기 위해 괄호로 감싼다
+	char *ptr;
 
 	if (size % MINALLOC) { // 요청된 크기가 8의 배수가 아니면 NULL을 리턴한다
 		return NULL;
 	}
 
+	// heapprof는 호출한 쪽의 call stack을 기록하므로 샘플은 alloc()에서 직접 기록한다
+	if ((ptr = allocChunk(size))) {
+		HEAPPROF_ALLOC(ptr, size);
+	}
+
+	return ptr;
+}
+
+char *allocChunk(int size) { // bin 또는 not_in_use 리스트에서 메모리를 할당하는 함수
+	char *ptr;
+
+	if (0 < size && size <= ALLOC_BIN_MAX && (ptr = alloc_bins[ALLOC_SIZE_TO_BIN(size)])) { // 같은 크기의 조각이 bin에 있으면 바로 꺼내준다
+		alloc_bins[ALLOC_SIZE_TO_BIN(size)] = *(char **)ptr;
+		alloc_binned[ALLOC_BINNED_INDEX(ptr)] = 0;
+		return ptr;
+	}
+
+	ptr = allocFromList(size);
+	if (!ptr && flushBins()) { // 공간이 부족하면 bin에 모아둔 조각들을 합친 뒤 다시 시도
+		ptr = allocFromList(size);
+	}
+
+	return ptr;
+}
+
+char *allocFromList(int size) { // not_in_use 리스트에서 first fit으로 메모리를 할당하는 함수
+	Node *new_node;
+	Node *new_alloced_mem;
+	Node* mem_not_in_use;
+
 	mem_not_in_use = mem_linked_list.mem_not_in_use_head;
 	while (1) {
 		if (!mem_not_in_use) { // 여유 공간이 부족한 경우 NULL을 리턴한다
@@ -81,12 +128,15 @@ char *alloc(int size) {
 		}
 
 		if (mem_not_in_use->size > size) {
+			// in_use list에 넣을 새로운 노드 생성
+			if (!(new_node = getNewNode())) { // 관리 노드가 부족하면 NULL을 리턴한다
+				return NULL;
+			}
+
 			// 사용할 만큼 할당
 			// not_in_use Node의 size 변경
 			mem_not_in_use->size -= size;
 
-			// in_use list에 넣을 새로운 노드 생성
-			new_node = getNewNode();
 			new_node->size = size;
 			new_node->start_addr = mem_not_in_use->start_addr + mem_not_in_use->size; // 앞에서 mem_not_in_use의 size 줄였기 때문에 그냥 size만 더해주면 됨
 			new_node->prev_node = NULL;
@@ -141,16 +191,201 @@ char *alloc(int size) {
 void dealloc(char *dealloc_ptr) {
 	int mem_index = dealloc_ptr - mem; // dealloc할 메모리의 주소
 	Node *node;
-	Node *mem_not_in_use;
-	Node *tmp_node;
-	Node *prev_node = NULL;
 
 	if (mem_index < 0 || 4096 <= mem_index) { // 범위를 벗어난 주소가 전달됐을 때
 		return;
 	}
+	if (alloc_binned[ALLOC_BINNED_INDEX(dealloc_ptr)]) { // 이미 해제되어 bin에 들어있는 조각 (노드는 in_use 리스트에 남아있다)
+		return;
+	}
+
+	node = findInUseNode(mem_index);
+	if (!node) return; // 인자로 전달된 주소에 해당되는 노드를 찾지 못했으면 종료
+	HEAPPROF_FREE(dealloc_ptr);
 
+	if (0 < node->size && node->size <= ALLOC_BIN_MAX) { // 작은 조각은 합치지 않고 bin에 넣어두었다가 같은 크기의 요청에 재사용한다
+		*(char **)dealloc_ptr = alloc_bins[ALLOC_SIZE_TO_BIN(node->size)];
+		alloc_bins[ALLOC_SIZE_TO_BIN(node->size)] = dealloc_ptr;
+		alloc_binned[ALLOC_BINNED_INDEX(dealloc_ptr)] = 1;
+		return;
+	}
+
+	unlinkInUseNode(node); // mem_in_use 리스트를 정리한다
+	insertFreeNode(NULL, node); // mem_not_in_use 리스트에 넣는다
+
+	return;
+}
+
+int flushBins() {
+	/*
+		bin에 모아둔 조각들을 모두 실제로 해제(not_in_use 리스트에 넣고 병합)한다.
+		해제한 조각의 개수를 리턴한다.
+	*/
+	Node *node;
+	char *ptr;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < ALLOC_NUM_BINS; ++i) {
+		while ((ptr = alloc_bins[i])) {
+			alloc_bins[i] = *(char **)ptr;
+			alloc_binned[ALLOC_BINNED_INDEX(ptr)] = 0;
+
+			if ((node = findInUseNode(ptr - mem))) {
+				unlinkInUseNode(node);
+				insertFreeNode(NULL, node);
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+int alloc_bulk(int size, int n, char **out) {
+	int i;
+
+	if (size <= 0 || n <= 0 || (size % MINALLOC)) { // 잘못된 요청이면 -1 리턴
+		return -1;
+	}
+
+	if (allocBulk(size, n, out)) {
+		return -1;
+	}
+
+	// alloc()과 마찬가지로 샘플은 여기서 직접 기록한다 (내부 함수에서 기록하면 call stack이 어긋난다)
+	for (i = 0; i < n; ++i) {
+		HEAPPROF_ALLOC(out[i], size);
+	}
+
+	return 0;
+}
+
+int allocBulk(int size, int n, char **out) {
+	/*
+		한번의 탐색으로 size 크기의 메모리 n개를 할당한다.
+		연속된 공간이 없으면 bin을 비워서 다시 시도하고, 그래도 없으면 하나씩 할당한다.
+	*/
+	Node *mem_not_in_use;
+	Node *new_nodes = NULL; // 새로 할당받은 노드들 (next_node로 연결)
+	Node *new_node;
+	int total_size;
+	int base_addr;
+	int need_nodes;
+	int i;
+
+	total_size = size * n;
+
+	// 한번의 탐색으로 n개를 모두 담을 수 있는 빈 공간을 찾는다
+	mem_not_in_use = mem_linked_list.mem_not_in_use_head;
+	while (mem_not_in_use && mem_not_in_use->size < total_size) {
+		mem_not_in_use = mem_not_in_use->next_node;
+	}
+
+	if (!mem_not_in_use) { // 한번에 담을 공간이 없으면 bin을 비워서 다시 시도하고, 그래도 없으면 하나씩 할당한다
+		return flushBins() ? allocBulk(size, n, out) : alloc_bulk_fallback(size, n, out);
+	}
+
+	// 크기가 딱 맞으면 빈 공간 노드를 첫 조각으로 재사용하므로 노드가 하나 덜 필요하다
+	need_nodes = (mem_not_in_use->size == total_size) ? n - 1 : n;
+	for (i = 0; i < need_nodes; ++i) {
+		if (!(new_node = getNewNode())) { // 관리 노드가 부족하면 확보했던 노드들 반환하고 bin을 비워서 다시 시도
+			while (new_nodes) {
+				new_node = new_nodes->next_node;
+				removeNode(new_nodes);
+				new_nodes = new_node;
+			}
+			return flushBins() ? allocBulk(size, n, out) : -1;
+		}
+		new_node->next_node = new_nodes;
+		new_nodes = new_node;
+	}
+
+	// alloc()과 마찬가지로 빈 공간의 뒷부분부터 잘라서 사용한다
+	base_addr = mem_not_in_use->start_addr + mem_not_in_use->size - total_size;
+	if (need_nodes < n) { // 빈 공간 전체를 사용하는 경우 not_in_use 리스트에서 제거
+		if (mem_not_in_use->prev_node) {
+			mem_not_in_use->prev_node->next_node = mem_not_in_use->next_node;
+		} else {
+			mem_linked_list.mem_not_in_use_head = mem_not_in_use->next_node;
+		}
+
+		if (mem_not_in_use->next_node) {
+			mem_not_in_use->next_node->prev_node = mem_not_in_use->prev_node;
+		}
+
+		mem_not_in_use->next_node = new_nodes;
+		new_nodes = mem_not_in_use;
+	} else {
+		mem_not_in_use->size -= total_size;
+	}
+
+	// 잘라낸 조각들을 in_use 리스트의 앞부분에 넣는다
+	// 뒤쪽 조각부터 넣어서 주소가 낮은 조각이 헤드 쪽에 오도록 한다 (주소 순으로 해제할 때 바로 찾을 수 있음)
+	for (i = n - 1; i >= 0; --i) {
+		new_node = new_nodes;
+		new_nodes = new_nodes->next_node;
+
+		new_node->start_addr = base_addr + i * size;
+		new_node->size = size;
+		new_node->prev_node = NULL;
+		new_node->next_node = mem_linked_list.mem_in_use_head;
+		if (mem_linked_list.mem_in_use_head) {
+			mem_linked_list.mem_in_use_head->prev_node = new_node;
+		}
+		mem_linked_list.mem_in_use_head = new_node;
+
+		out[i] = mem + new_node->start_addr;
+	}
+
+	return 0;
+}
+
+void dealloc_bulk(char **ptrs, int n) {
+	Node *node;
+	Node *pos = NULL; // 다음 삽입 위치를 찾기 시작할 not_in_use 노드
+	int mem_index;
+	int i;
+
+	if (n <= 0) return;
+
+	// 주소 순으로 정렬해두면 not_in_use 리스트를 한번만 훑으면서 모두 삽입, 병합할 수 있다
+	if (!isSortedAddr(ptrs, n)) {
+		qsort(ptrs, n, sizeof(char *), compareAddr);
+	}
+
+	for (i = 0; i < n; ++i) {
+		mem_index = ptrs[i] - mem;
+		if (mem_index < 0 || PAGESIZE <= mem_index) continue;
+		if (alloc_binned[ALLOC_BINNED_INDEX(ptrs[i])]) continue; // 이미 해제되어 bin에 들어있는 조각
+
+		node = findInUseNode(mem_index);
+		if (!node) continue;
+		HEAPPROF_FREE(ptrs[i]);
+
+		unlinkInUseNode(node);
+		pos = insertFreeNode(pos, node);
+	}
+
+	return;
+}
+
+int alloc_bulk_fallback(int size, int n, char **out) { // 연속된 공간이 없을 때 allocChunk()를 반복해 할당하는 함수
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		if (!(out[i] = allocChunk(size))) { // 하나라도 실패하면 앞서 할당한 것들 해제하고 실패
+			dealloc_bulk(out, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+Node *findInUseNode(int mem_index) { // start_addr가 mem_index인 in_use 노드를 찾는 함수
+	Node *node = mem_linked_list.mem_in_use_head;
 
-	node = mem_linked_list.mem_in_use_head;
 	while (node) {
 		if (node->start_addr == mem_index) {
 			break;
@@ -159,10 +394,10 @@ void dealloc(char *dealloc_ptr) {
 		node = node->next_node;
 	}
 
+	return node;
+}
 
-	if (!node) return; // 인자로 전달된 주소에 해당되는 노드를 찾지 못했으면 종료
-
-	// mem_in_use 리스트를 정리한다
+void unlinkInUseNode(Node *node) { // in_use 리스트에서 노드를 떼어내는 함수
 	if (node->prev_node) { // 헤드노드가 아닐 때
 		node->prev_node->next_node = node->next_node;
 	} else { // 헤드노드일 때
@@ -172,97 +407,99 @@ void dealloc(char *dealloc_ptr) {
 	if (node->next_node) {
 		node->next_node->prev_node = node->prev_node;
 	}
+}
 
+Node *insertFreeNode(Node *start, Node *node) {
+	/*
+		node를 주소 순으로 정렬된 not_in_use 리스트에 넣고 앞뒤 노드와 합칠 수 있으면 합친다.
+		start부터 삽입 위치를 찾으며(NULL이면 헤드부터), 최종적으로 node가 합쳐진 노드를 리턴한다.
+	*/
+	Node *mem_not_in_use = start ? start : mem_linked_list.mem_not_in_use_head;
+	Node *prev_node = mem_not_in_use ? mem_not_in_use->prev_node : NULL;
+	Node *tmp_node;
 
-	// mem_not_in_use 리스트에 넣는다
-	mem_not_in_use = mem_linked_list.mem_not_in_use_head;
-	if (!mem_not_in_use) {
-		node->prev_node = NULL;
-		node->next_node = NULL;
-		mem_linked_list.mem_not_in_use_head = node;
+	while (mem_not_in_use && mem_not_in_use->start_addr < node->start_addr) {
+		prev_node = mem_not_in_use;
+		mem_not_in_use = mem_not_in_use->next_node;
+	}
+
+	// prev_node와 mem_not_in_use 사이에 node 삽입
+	node->prev_node = prev_node;
+	node->next_node = mem_not_in_use;
+	if (prev_node) {
+		prev_node->next_node = node;
 	} else {
-		while (mem_not_in_use) {
-			if (mem_not_in_use->start_addr > node->start_addr) {
-				// mem_not_in_list에 node 삽입
-				node->prev_node = mem_not_in_use->prev_node;
-				node->next_node = mem_not_in_use;
-				if (node->prev_node) {
-					node->prev_node->next_node = node;
-				} else {
-					mem_linked_list.mem_not_in_use_head = node;	
-				}
-				mem_not_in_use->prev_node = node;
-
-
-				// 뒤쪽 노드와 합칠 수 있는지 확인
-				if (node->next_node) {
-					if (node->start_addr + node->size == node->next_node->start_addr) {
-						tmp_node = node->next_node;
-						node->size += node->next_node->size;
-						node->next_node = node->next_node->next_node;
-						if (node->next_node) {
-							node->next_node->prev_node = node;
-						}
-
-						// 필요 없어진 노드 제거
-						removeNode(tmp_node);
-					}
-				}
-				
-				
-				// 앞쪽 노드와 합칠 수 있는지 확인
-				if (node->prev_node) {
-					if (node->prev_node->start_addr + node->prev_node->size == node->start_addr) {
-						node->prev_node->next_node = node->next_node;
-						if (node->next_node) {
-							node->next_node->prev_node = node->prev_node;
-						}
-						node->prev_node->size += node->size;
-
-						// 필요 없어진 노드 제거
-						removeNode(node);
-					}
-
-				}
-
-				break;
-			}
+		mem_linked_list.mem_not_in_use_head = node;
+	}
+	if (mem_not_in_use) {
+		mem_not_in_use->prev_node = node;
+	}
 
-			prev_node = mem_not_in_use;
-			mem_not_in_use = mem_not_in_use->next_node;
+	// 뒤쪽 노드와 합칠 수 있는지 확인
+	if (node->next_node && node->start_addr + node->size == node->next_node->start_addr) {
+		tmp_node = node->next_node;
+		node->size += tmp_node->size;
+		node->next_node = tmp_node->next_node;
+		if (node->next_node) {
+			node->next_node->prev_node = node;
 		}
 
-		if (!mem_not_in_use) {
-			// mem_not_in_use list의 맨 끝에 삽입해야 하는 경우
-			prev_node->next_node = node;
-			node->prev_node = prev_node;
-			node->next_node = NULL;
+		// 필요 없어진 노드 제거
+		removeNode(tmp_node);
+	}
+
+	// 앞쪽 노드와 합칠 수 있는지 확인
+	if (node->prev_node && node->prev_node->start_addr + node->prev_node->size == node->start_addr) {
+		tmp_node = node->prev_node;
+		tmp_node->next_node = node->next_node;
+		if (node->next_node) {
+			node->next_node->prev_node = tmp_node;
+		}
+		tmp_node->size += node->size;
 
-			// 앞쪽 노드와 합칠 수 있는지 확인
-			if (node->prev_node) {
-				if (node->prev_node->start_addr + node->prev_node->size == node->start_addr) {
-					node->prev_node->next_node = node->next_node;
-					node->prev_node->size += node->size;
+		// 필요 없어진 노드 제거
+		removeNode(node);
+		node = tmp_node;
+	}
 
-					// 필요 없어진 노드 제거
-					removeNode(node);
-				}
+	return node;
+}
 
-			}
+int isSortedAddr(char **ptrs, int n) { // 주소가 이미 오름차순으로 정렬되어 있는지 확인하는 함수
+	int i;
+
+	for (i = 1; i < n; ++i) {
+		if (ptrs[i - 1] > ptrs[i]) {
+			return 0;
 		}
 	}
 
+	return 1;
+}
+
+int compareAddr(const void *a, const void *b) { // qsort에 사용할 주소 비교 함수
+	char *addr_a = *(char * const *)a;
+	char *addr_b = *(char * const *)b;
 
-	return;
+	return (addr_a > addr_b) - (addr_a < addr_b);
 }
 
-Node *getNewNode() { // 새로운 노드 할당하고 주소 리턴하는 함수
-	while (management_mem->is_valid) { // 해당 메모리가 사용중이라면
-		management_mem += 1; // 다음 위치 확인
+Node *getNewNode() { // 새로운 노드 할당하고 주소 리턴하는 함수, 남은 노드가 없으면 NULL 리턴
+	int i;
+
+	for (i = 0; i < MAX_NODE_COUNT; ++i) {
+		if (!node_cursor->is_valid) { // 사용중이지 않은 위치를 찾았으면
+			node_cursor->is_valid = 1; // 새로 할당할 위치 사용중이라고 표시
+			return node_cursor; // 주소 리턴
+		}
+
+		node_cursor += 1; // 다음 위치 확인
+		if (node_cursor == management_mem + MAX_NODE_COUNT) { // 관리 영역의 끝에 도달하면 처음부터 다시 확인
+			node_cursor = management_mem;
+		}
 	}
-	management_mem->is_valid = 1; // 새로 할당할 위치 사용중이라고 표시
 
-	return management_mem; // 주소 리턴
+	return NULL;
 }
 
 void removeNode(Node *node) { // 사용 끝난 노드 메모리 해제하는 함수
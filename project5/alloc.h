@@ -3,6 +3,8 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include "heapprof.h"
 
 #define PAGESIZE 4096 //size of memory to allocate from OS
 #define MINALLOC 8 //allocations will be 8 bytes or multiples of it
@@ -12,3 +14,42 @@ int init_alloc();
 int cleanup();
 char *alloc(int);
 void dealloc(char *);
+
+// size class bins: chunks of at most ALLOC_BIN_MAX bytes are not merged on dealloc()
+// but pushed onto the bin of their size, and the next alloc() of that size pops them back.
+// the first sizeof(char *) bytes of a binned chunk hold the next chunk of the bin.
+// alloc_binned marks the chunks that sit in a bin, so a repeated dealloc() of one is ignored.
+// the heap is one mmap()ed page, so the offset inside the page indexes it without the heap address.
+#define ALLOC_BIN_MAX 256
+#define ALLOC_NUM_BINS (ALLOC_BIN_MAX / MINALLOC)
+#define ALLOC_SIZE_TO_BIN(size) ((size) / MINALLOC - 1)
+#define ALLOC_BINNED_INDEX(ptr) (((uintptr_t)(ptr) & (PAGESIZE - 1)) / MINALLOC)
+
+extern char *alloc_bins[ALLOC_NUM_BINS];
+extern unsigned char alloc_binned[PAGESIZE / MINALLOC];
+
+// fast path for compile-time constant sizes: the size checks and the bin index fold away,
+// leaving a pop from the bin. the generic alloc() runs only when the bin is empty,
+// the heap profiler is sampling or a profile dump was requested.
+static inline char *alloc_const(int size)
+{
+	char *ptr;
+
+	if (size <= 0 || size % MINALLOC || size > ALLOC_BIN_MAX || heapprof_sampling || heapprof_dump_requested)
+		return (alloc)(size);
+
+	ptr = alloc_bins[ALLOC_SIZE_TO_BIN(size)];
+	if (!ptr)
+		return (alloc)(size);
+	alloc_bins[ALLOC_SIZE_TO_BIN(size)] = *(char **)ptr;
+	alloc_binned[ALLOC_BINNED_INDEX(ptr)] = 0;
+
+	return ptr;
+}
+
+#define alloc(size) (__builtin_constant_p(size) ? alloc_const(size) : (alloc)(size))
+
+// batch allocation: n chunks of the same size in one free list pass
+// dealloc_bulk() sorts ptrs by address in place, so the caller's array is reordered.
+int alloc_bulk(int size, int n, char **out);
+void dealloc_bulk(char **ptrs, int n);
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef EALLOC
+#include "ealloc.h"
+#define OBJ_SIZE (2 * MINALLOC) // 벤치마크에 사용할 객체 크기
+#define HOLE_COUNT 8 // 단편화 시나리오에서 만들 구멍의 개수 (구멍은 MINALLOC 크기)
+#define TAIL_SIZE 0 // 단편화 시나리오에서 구멍들 뒤쪽에 남겨둘 빈 공간의 크기
+int batches[] = {1, 4, 8};
+#else
+#include "alloc.h"
+#define OBJ_SIZE (2 * MINALLOC)
+#define HOLE_COUNT 32
+#define TAIL_SIZE 2048
+int batches[] = {1, 4, 16, 32};
+#endif
+
+/*
+	alloc()/dealloc()를 n번 반복하는 경우와 alloc_bulk()/dealloc_bulk()로 한번에 처리하는 경우의
+	객체 하나당 비용(ns)을 비교한다. alloc() 반복은 상수 크기(헤더의 bin fast path)와
+	변수 크기(일반 경로) 호출을 따로 측정한다.
+	fragmented 시나리오에서는 요청 크기보다 작은 구멍들을 free list 앞쪽에 만들어 두어
+	alloc()이 매번 구멍들을 지나쳐야 하는 상황을 만든다.
+
+	gcc -O2 -o bench_alloc bench_alloc.c alloc.c heapprof.c -lm
+	gcc -O2 -DEALLOC -o bench_ealloc bench_alloc.c ealloc.c heapprof.c -lm -lrt
+*/
+
+#define ROUNDS 100000
+#define MAX_BATCH 64
+
+unsigned long get_nanos() { // 나노초 단위의 현재시간 리턴하는 함수
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+volatile int var_size = OBJ_SIZE; // 컴파일 시점에 크기를 알 수 없는 alloc() 호출에 사용
+
+double bench_loop(int n, int constant) { // alloc()/dealloc()를 n번씩 반복 (constant면 상수 크기로 호출)
+	char *ptrs[MAX_BATCH];
+	unsigned long start = get_nanos();
+
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int i = 0; i < n; i++) {
+			if (!(ptrs[i] = constant ? alloc(OBJ_SIZE) : alloc(var_size))) {
+				printf("alloc failed\n");
+				exit(1);
+			}
+		}
+		for (int i = 0; i < n; i++)
+			dealloc(ptrs[i]);
+	}
+
+	return (double)(get_nanos() - start) / ((double)ROUNDS * n);
+}
+
+double bench_bulk(int n) { // alloc_bulk()/dealloc_bulk()로 n개씩 처리
+	char *ptrs[MAX_BATCH];
+	unsigned long start = get_nanos();
+
+	for (int r = 0; r < ROUNDS; r++) {
+		if (alloc_bulk(OBJ_SIZE, n, ptrs)) {
+			printf("alloc_bulk failed\n");
+			exit(1);
+		}
+		dealloc_bulk(ptrs, n);
+	}
+
+	return (double)(get_nanos() - start) / ((double)ROUNDS * n);
+}
+
+void run(char *scenario) {
+	for (int i = 0; i < (int)(sizeof(batches) / sizeof(int)); i++) {
+		double loop_const = bench_loop(batches[i], 1);
+		double loop_var = bench_loop(batches[i], 0);
+		double bulk = bench_bulk(batches[i]);
+		printf("%s\t%d\t%d\t%.1f\t\t%.1f\t\t%.1f\n", scenario, OBJ_SIZE, batches[i], loop_const, loop_var, bulk);
+	}
+}
+
+int main()
+{
+	char *holes[2 * HOLE_COUNT];
+
+	init_alloc();
+
+	printf("scenario\tsize\tn\tconst(ns/obj)\tvar(ns/obj)\tbulk(ns/obj)\n");
+	run("empty");
+
+	// 첫 페이지를 [나머지][MINALLOC 조각들][TAIL_SIZE] 순서로 채운 뒤
+	// 조각들을 하나 걸러 해제하여 free list 앞쪽에 작은 구멍들을 만든다
+	// (빈 공간의 뒷부분부터 잘라주므로 먼저 할당한 것이 높은 주소에 위치함)
+	char *tail = TAIL_SIZE ? alloc(TAIL_SIZE) : NULL;
+	for (int i = 0; i < 2 * HOLE_COUNT; i++)
+		holes[i] = alloc(MINALLOC);
+	if (PAGESIZE - TAIL_SIZE - 2 * HOLE_COUNT * MINALLOC > 0)
+		alloc(PAGESIZE - TAIL_SIZE - 2 * HOLE_COUNT * MINALLOC);
+	// dealloc()은 작은 조각을 bin에 넣으므로 dealloc_bulk()로 free list에 바로 돌려준다
+	for (int i = 0; i < 2 * HOLE_COUNT; i += 2)
+		dealloc_bulk(&holes[i], 1);
+	if (tail)
+		dealloc(tail);
+	run("fragmented");
+
+	cleanup();
+	return 0;
+}
@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+/*
+	멀티쓰레드 할당기 벤치마크
+	threadtest, larson, random, fragment 워크로드를 1..N개의 쓰레드로 실행하고
+	ops/sec, 지연시간 p50/p99, peak RSS를 한 줄에 하나씩 JSON으로 출력한다.
+	각 실행은 fork한 자식 프로세스에서 하므로 할당기 상태와 peak RSS가 실행마다 분리된다.
+
+	alloc.c, ealloc.c는 쓰레드 안전하지 않으므로 하나의 mutex로 감싸서 측정한다.
+	NULL을 돌려받은 alloc은 ops와 지연시간에 넣지 않고 failed로 따로 센다.
+	기본값(DEFAULT_MAX_SIZE, DEFAULT_LIVE)은 모든 워크로드가 실패 없이 돌도록 힙 크기에 맞춰져 있다.
+
+	gcc -O2 -DBENCH_ALLOC -o bench_mt_alloc bench_mt.c alloc.c heapprof.c -lpthread -lm
+	gcc -O2 -DBENCH_EALLOC -o bench_mt_ealloc bench_mt.c ealloc.c heapprof.c -lpthread -lm -lrt
+	gcc -O2 -DBENCH_MALLOC -o bench_mt_malloc bench_mt.c -lpthread
+
+	usage: bench_mt [-t max threads] [-n ops per thread] [-w workload] [-m min size] [-M max size] [-l live objects]
+*/
+
+#if defined(BENCH_ALLOC)
+#include "alloc.h"
+#define ALLOCATOR_NAME "alloc"
+#define DEFAULT_MIN_SIZE MINALLOC
+#define DEFAULT_MAX_SIZE (8 * MINALLOC)
+#define DEFAULT_LIVE 48 // 모든 쓰레드가 합쳐서 동시에 들고 있을 객체 수 (관리 노드 개수 제한에 맞춤)
+#elif defined(BENCH_EALLOC)
+#include "ealloc.h"
+#define ALLOCATOR_NAME "ealloc"
+#define DEFAULT_MIN_SIZE MINALLOC
+#define DEFAULT_MAX_SIZE (4 * MINALLOC)
+#define DEFAULT_LIVE 12 // 16KB 힙에 최대 크기 객체가 단편화된 채로 들어가는 개수 (24개면 larson, random, fragment가 실패한다)
+#else
+#define ALLOCATOR_NAME "glibc"
+#define DEFAULT_MIN_SIZE 8
+#define DEFAULT_MAX_SIZE 64
+#define DEFAULT_LIVE 48
+#endif
+
+#if defined(BENCH_ALLOC) || defined(BENCH_EALLOC)
+#define SIZE_UNIT MINALLOC // 요청 크기는 MINALLOC의 배수여야 한다
+pthread_mutex_t alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void bench_init() {
+	init_alloc();
+}
+
+char *bench_alloc(int size) {
+	char *ptr;
+
+	pthread_mutex_lock(&alloc_lock);
+	ptr = alloc(size);
+	pthread_mutex_unlock(&alloc_lock);
+
+	return ptr;
+}
+
+void bench_free(char *ptr) {
+	pthread_mutex_lock(&alloc_lock);
+	dealloc(ptr);
+	pthread_mutex_unlock(&alloc_lock);
+}
+#else
+#define SIZE_UNIT 8
+
+void bench_init() {
+}
+
+char *bench_alloc(int size) {
+	return malloc(size);
+}
+
+void bench_free(char *ptr) {
+	free(ptr);
+}
+#endif
+
+#define MAX_THREADS 64
+
+typedef struct thread_arg { // 쓰레드별 인자와 결과
+	int id;
+	unsigned long rng; // 쓰레드별 난수 상태
+	long ops; // 성공한 alloc/free 횟수
+	long failed; // NULL을 돌려받은 alloc 횟수
+	long lat_count; // 기록된 지연시간 개수
+	long *latencies; // op별 지연시간(ns)
+} ThreadArg;
+
+int nthreads;
+long ops_per_thread = 100000;
+int min_size = DEFAULT_MIN_SIZE;
+int max_size = DEFAULT_MAX_SIZE;
+int total_live = DEFAULT_LIVE;
+int live_per_thread;
+char **larson_slots; // larson 워크로드에서 쓰레드들이 돌려가며 사용하는 슬롯 배열
+pthread_barrier_t barrier;
+ThreadArg args[MAX_THREADS];
+
+unsigned long now_nanos() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+unsigned long next_rand(ThreadArg *arg) { // xorshift64
+	arg->rng ^= arg->rng << 13;
+	arg->rng ^= arg->rng >> 7;
+	arg->rng ^= arg->rng << 17;
+	return arg->rng;
+}
+
+int random_size(ThreadArg *arg) { // [min_size, max_size] 범위에서 SIZE_UNIT 배수인 크기를 뽑는다
+	int units = (max_size - min_size) / SIZE_UNIT + 1;
+	return min_size + (int)(next_rand(arg) % units) * SIZE_UNIT;
+}
+
+char *timed_alloc(ThreadArg *arg, int size) { // 지연시간을 기록하며 할당
+	unsigned long start = now_nanos();
+	char *ptr = bench_alloc(size);
+	unsigned long end = now_nanos();
+
+	if (ptr) {
+		if (arg->lat_count < 2 * ops_per_thread)
+			arg->latencies[arg->lat_count++] = end - start;
+		arg->ops++;
+		ptr[0] = (char)size; // 실제로 사용하는 것처럼 한 바이트 써본다
+	} else {
+		arg->failed++;
+	}
+
+	return ptr;
+}
+
+void timed_free(ThreadArg *arg, char *ptr) { // 지연시간을 기록하며 해제
+	unsigned long start, end;
+
+	if (!ptr) return;
+
+	start = now_nanos();
+	bench_free(ptr);
+	end = now_nanos();
+
+	if (arg->lat_count < 2 * ops_per_thread)
+		arg->latencies[arg->lat_count++] = end - start;
+	arg->ops++;
+}
+
+void *threadtest(void *p) {
+	/*
+		threadtest: 각 쓰레드가 고정 크기 객체들을 한 묶음 할당하고 모두 해제하는 것을 반복한다.
+	*/
+	ThreadArg *arg = p;
+	char *objs[256];
+	int batch = live_per_thread;
+
+	for (long done = 0; done < ops_per_thread; done += 2 * batch) {
+		for (int i = 0; i < batch; i++)
+			objs[i] = timed_alloc(arg, min_size);
+		for (int i = 0; i < batch; i++)
+			timed_free(arg, objs[i]);
+	}
+
+	return NULL;
+}
+
+void *larson(void *p) {
+	/*
+		larson: 각 쓰레드가 자기 슬롯 구역에서 임의의 슬롯을 해제하고 새로 할당하기를 반복한다.
+		한 라운드가 끝나면 구역을 다음 쓰레드에게 넘기므로, 다른 쓰레드가 할당한 객체를 해제하게 된다.
+	*/
+	ThreadArg *arg = p;
+	long rounds = 16;
+	long per_round = ops_per_thread / rounds / 2; // 한번에 해제와 할당 두 op
+	int region = arg->id;
+	char **slots;
+
+	for (long r = 0; r < rounds; r++) {
+		slots = larson_slots + region * live_per_thread;
+		for (long i = 0; i < per_round; i++) {
+			int slot = next_rand(arg) % live_per_thread;
+			timed_free(arg, slots[slot]);
+			slots[slot] = timed_alloc(arg, random_size(arg));
+		}
+
+		pthread_barrier_wait(&barrier); // 모든 쓰레드가 라운드를 끝내면 구역을 바꾼다
+		region = (region + 1) % nthreads;
+	}
+
+	return NULL;
+}
+
+void *random_mix(void *p) {
+	/*
+		random: 임의의 크기로 할당하거나, 들고 있는 객체 중 하나를 해제하는 것을 반반의 확률로 반복한다.
+	*/
+	ThreadArg *arg = p;
+	char *objs[256];
+	int live = 0;
+
+	for (long i = 0; i < ops_per_thread; i++) {
+		if (live < live_per_thread && (live == 0 || next_rand(arg) % 2)) {
+			if ((objs[live] = timed_alloc(arg, random_size(arg))))
+				live++;
+		} else {
+			int victim = next_rand(arg) % live;
+			timed_free(arg, objs[victim]);
+			objs[victim] = objs[--live];
+		}
+	}
+
+	while (live)
+		timed_free(arg, objs[--live]);
+
+	return NULL;
+}
+
+void *fragment(void *p) {
+	/*
+		fragment: 작은 객체를 가득 할당한 뒤 하나 걸러 해제하여 구멍을 만들고,
+		그 상태에서 큰 객체 할당을 시도한다. 단편화가 심할수록 실패(failed)가 늘어난다.
+	*/
+	ThreadArg *arg = p;
+	char *objs[256];
+	char *big[256];
+	int count = live_per_thread;
+
+	for (long done = 0; done < ops_per_thread; ) {
+		for (int i = 0; i < count; i++)
+			objs[i] = timed_alloc(arg, min_size);
+		for (int i = 0; i < count; i += 2) {
+			timed_free(arg, objs[i]);
+			objs[i] = NULL;
+		}
+		for (int i = 0; i < count / 2; i++)
+			big[i] = timed_alloc(arg, max_size);
+		for (int i = 0; i < count / 2; i++)
+			timed_free(arg, big[i]);
+		for (int i = 1; i < count; i += 2)
+			timed_free(arg, objs[i]);
+		done += 3 * count;
+	}
+
+	return NULL;
+}
+
+int compare_long(const void *a, const void *b) {
+	long x = *(const long *)a, y = *(const long *)b;
+	return (x > y) - (x < y);
+}
+
+void run(char *workload, void *(*func)(void *), int threads) {
+	/*
+		자식 프로세스에서 워크로드를 threads개의 쓰레드로 실행하고 결과를 JSON 한 줄로 출력한다.
+	*/
+	pthread_t tids[MAX_THREADS];
+	struct rusage usage;
+	long *all;
+	long total_ops = 0, total_failed = 0, total_lat = 0;
+	unsigned long start, elapsed;
+	pid_t pid;
+
+	fflush(stdout);
+	if ((pid = fork()) != 0) {
+		waitpid(pid, NULL, 0);
+		return;
+	}
+
+	nthreads = threads;
+	live_per_thread = total_live / threads > 0 ? total_live / threads : 1;
+	if (live_per_thread > 256)
+		live_per_thread = 256;
+	larson_slots = calloc(threads * live_per_thread, sizeof(char *));
+	pthread_barrier_init(&barrier, NULL, threads);
+	bench_init();
+
+	for (int i = 0; i < threads; i++) {
+		args[i].id = i;
+		args[i].rng = 0x9e3779b97f4a7c15UL * (i + 1);
+		args[i].latencies = malloc(sizeof(long) * 2 * ops_per_thread);
+	}
+
+	start = now_nanos();
+	for (int i = 0; i < threads; i++)
+		pthread_create(&tids[i], NULL, func, &args[i]);
+	for (int i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+	elapsed = now_nanos() - start;
+
+	for (int i = 0; i < threads; i++) {
+		total_ops += args[i].ops;
+		total_failed += args[i].failed;
+		total_lat += args[i].lat_count;
+	}
+	all = malloc(sizeof(long) * (total_lat + 1));
+	total_lat = 0;
+	for (int i = 0; i < threads; i++) {
+		memcpy(all + total_lat, args[i].latencies, sizeof(long) * args[i].lat_count);
+		total_lat += args[i].lat_count;
+	}
+	qsort(all, total_lat, sizeof(long), compare_long);
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("{\"allocator\":\"%s\",\"workload\":\"%s\",\"threads\":%d,\"ops\":%ld,\"failed\":%ld,"
+			"\"ops_per_sec\":%.0f,\"p50_ns\":%ld,\"p99_ns\":%ld,\"peak_rss_kb\":%ld}\n",
+			ALLOCATOR_NAME, workload, threads, total_ops, total_failed,
+			total_ops * 1e9 / elapsed, total_lat ? all[total_lat / 2] : 0,
+			total_lat ? all[total_lat * 99 / 100] : 0, usage.ru_maxrss);
+	fflush(stdout);
+	exit(0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct {
+		char *name;
+		void *(*func)(void *);
+	} workloads[] = {
+		{"threadtest", threadtest},
+		{"larson", larson},
+		{"random", random_mix},
+		{"fragment", fragment},
+	};
+	int max_threads = 0;
+	char *only = NULL;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "t:n:w:m:M:l:")) != -1) {
+		switch (opt) {
+			case 't': max_threads = atoi(optarg); break;
+			case 'n': ops_per_thread = atol(optarg); break;
+			case 'w': only = optarg; break;
+			case 'm': min_size = atoi(optarg); break;
+			case 'M': max_size = atoi(optarg); break;
+			case 'l': total_live = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: %s [-t max threads] [-n ops per thread] [-w workload] [-m min size] [-M max size] [-l live objects]\n", argv[0]);
+				exit(1);
+		}
+	}
+	if (!max_threads) { // 기본값은 코어 수, 단 쓰레드마다 객체를 하나 이상 들고 있으므로 live 객체 수를 넘지 않게 한다
+		max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (max_threads > total_live)
+			max_threads = total_live;
+	}
+	if (max_threads < 1)
+		max_threads = 1;
+	if (max_threads > MAX_THREADS)
+		max_threads = MAX_THREADS;
+
+	for (int w = 0; w < (int)(sizeof(workloads) / sizeof(workloads[0])); w++) {
+		if (only && strcmp(only, workloads[w].name))
+			continue;
+		for (int t = 1; t <= max_threads; t++)
+			run(workloads[w].name, workloads[w].func, t);
+	}
+
+	return 0;
+}
@@ -0,0 +1,13 @@
+#!/bin/bash
+# 세 할당기(alloc, ealloc, glibc malloc)에 대해 멀티쓰레드 벤치마크를 실행하고
+# 결과를 JSON lines 형식으로 bench_mt.jsonl에 저장한다.
+# usage: ./bench_mt.sh [bench_mt options...]
+
+make bench_mt_alloc bench_mt_ealloc bench_mt_malloc || exit 1
+
+rm -f bench_mt.jsonl
+for allocator in alloc ealloc malloc
+do
+    echo "Running bench_mt_$allocator"
+    ./bench_mt_$allocator "$@" | tee -a bench_mt.jsonl
+done
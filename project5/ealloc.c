@@ -1,4 +1,7 @@
+#include <fcntl.h>
+#include <time.h>
 #include "ealloc.h"
+#include "ealloc_telemetry.h"
 
 #define MAX_PAGE_COUNT 4
 
@@ -16,30 +19,99 @@ typedef struct mem_list { // 메모리 관리 링크드 리스트들 저장하
 	Node *mem_not_in_use_head; // 사용중이지 않은 메모리 영역 관리 링크드 리스트
 } MemLinkedList;
 
+#define MAX_NODE_COUNT ((int)(PAGESIZE / sizeof(Node))) // management_mem에 들어갈 수 있는 노드의 개수
+
 char *mem[MAX_PAGE_COUNT]; // heap 메모리 영역 (페이지 4개)
 MemLinkedList memLinkedLists[MAX_PAGE_COUNT]; // 메모리 관리 링크드 리스트들 구조체(페이지당 하나씩)
 Node *management_mem; // 메모리 관리 링크드 리스트의 노드들을 할당할 메모리 영역
-
+Node *node_cursor; // management_mem에서 새 노드 자리를 찾기 시작할 위치
+char *alloc_bins[ALLOC_NUM_BINS]; // 크기별로 해제된 조각들을 모아두는 bin (ealloc.h 참고)
+int ealloc_telemetry_enabled; // 공유 메모리로 카운터를 공개하고 있는지
+struct ealloc_telemetry *telemetry; // 카운터를 공개할 공유 메모리 영역
+char telemetry_name[64]; // 공유 메모리 이름
+long rate_window_start; // alloc 속도 측정 구간의 시작 시간(ns)
+
+char *allocChunk(int size, int map_new);
+char *allocFromPages(int size, int map_new);
+int allocBulk(int size, int n, char **out);
+int bulkFromPages(int size, int n, char **out, int map_new);
+int piecesFromPages(int size, int n, char **out, int map_new);
+int flushBins();
+int isBinned(char *ptr, int size);
 int init_alloc_one_page(int i);
 int cleanup_one_page(int i);
 char *alloc_one_page(int i, int size);
 void dealloc_one_page(int i, char *dealloc_ptr);
 Node *getNewNode();
 void removeNode(Node *node);
+Node *findInUseNode(int i, int mem_index);
+void unlinkInUseNode(int i, Node *node);
+Node *insertFreeNode(int i, Node *start, Node *node);
+int alloc_bulk_one_page(int i, int size, int n, char **out);
+int compareAddr(const void *a, const void *b);
+int isSortedAddr(char **ptrs, int n);
 int checkallocedatpage(int page_num, char *addr);
+void telemetryUpdate(int allocs, int deallocs, long bytes, long binned, int page);
+void scanPageTelemetry(int i);
+int pageOf(char *addr);
 void printallnode(int i);
 
 void init_alloc() {
 	management_mem = mmap(NULL, PAGESIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); // 메모리 관리에 사용할 메모리 영역을 할당받는다
+	node_cursor = management_mem;
 }
 
 
-char *alloc(int size) {
+char *(alloc)(int size) { // ealloc.h의 alloc() 매크로와 구분하기 위해 괄호로 감싼다
+	char *new_alloced_mem = NULL;
+
+	if (size % MINALLOC) {
+		return NULL;
+	}
+
+	// heapprof는 호출한 쪽의 call stack을 기록하므로 샘플은 alloc()에서 직접 기록한다
+	if ((new_alloced_mem = allocChunk(size, 1))) {
+		HEAPPROF_ALLOC(new_alloced_mem, size);
+	}
+
+	return new_alloced_mem;
+}
+
+char *allocChunk(int size, int map_new) { // bin 또는 페이지에서 메모리를 할당하는 함수 (map_new가 0이면 새 페이지는 매핑하지 않는다)
+	char *new_alloced_mem = NULL;
+
+	if (0 < size && size <= ALLOC_BIN_MAX && (new_alloced_mem = alloc_bins[ALLOC_SIZE_TO_BIN(size)])) { // 같은 크기의 조각이 bin에 있으면 바로 꺼내준다
+		alloc_bins[ALLOC_SIZE_TO_BIN(size)] = *(char **)new_alloced_mem;
+		((char **)new_alloced_mem)[1] = NULL;
+		if (ealloc_telemetry_enabled) {
+			telemetryUpdate(1, 0, size, -size, -2);
+		}
+		return new_alloced_mem;
+	}
+
+	// 새 페이지는 이미 매핑된 페이지들에 공간이 없을 때만 매핑한다
+	new_alloced_mem = allocFromPages(size, 0);
+	if (!new_alloced_mem && flushBins()) { // 공간이 부족하면 bin에 모아둔 조각들을 합친 뒤 다시 시도
+		new_alloced_mem = allocFromPages(size, 0);
+	}
+	if (!new_alloced_mem && map_new) {
+		new_alloced_mem = allocFromPages(size, 1);
+	}
+
+	if (new_alloced_mem && ealloc_telemetry_enabled) {
+		telemetryUpdate(1, 0, size, 0, pageOf(new_alloced_mem));
+	}
+
+	return new_alloced_mem;
+}
+
+char *allocFromPages(int size, int map_new) { // 앞쪽 페이지부터 차례로 할당을 시도하는 함수 (map_new가 0이면 매핑된 페이지에서만)
 	int i;
 	char *new_alloced_mem = NULL;
 
 	for (i = 0; i < MAX_PAGE_COUNT; ++i) {
 		if (!mem[i]) { // 해당 heap 메모리 페이지가 아직 할당되지 않았다면
+			if (!map_new) continue;
 			init_alloc_one_page(i); // 한페이지 할당
 		}
 
@@ -56,15 +128,350 @@ char *alloc(int size) {
 
 void dealloc(char *dealloc_ptr) {
 	int i;
+	int size;
+	Node *node;
 
 	for (i = 0; i < MAX_PAGE_COUNT; ++i) {
 		if (checkallocedatpage(i, dealloc_ptr)) { // 해제할 메모리가 해당 페이지에 있는지 확인
+			node = findInUseNode(i, dealloc_ptr - mem[i]);
+			if (isBinned(dealloc_ptr, node->size)) { // 이미 해제되어 bin에 들어있는 조각 (노드는 in_use 리스트에 남아있다)
+				break;
+			}
+			HEAPPROF_FREE(dealloc_ptr);
+			if (node->size <= ALLOC_BIN_MAX) { // 작은 조각은 합치지 않고 bin에 넣어두었다가 같은 크기의 요청에 재사용한다
+				*(char **)dealloc_ptr = alloc_bins[ALLOC_SIZE_TO_BIN(node->size)];
+				((char **)dealloc_ptr)[1] = ALLOC_BIN_KEY;
+				alloc_bins[ALLOC_SIZE_TO_BIN(node->size)] = dealloc_ptr;
+				if (ealloc_telemetry_enabled) {
+					telemetryUpdate(0, 1, -node->size, node->size, -2);
+				}
+				break;
+			}
+
+			size = node->size; // 해제하면서 노드가 병합되어 사라질 수 있으므로 크기를 먼저 저장한다
 			dealloc_one_page(i, dealloc_ptr); // 해당 페이지에서 메모리 해제
+			if (ealloc_telemetry_enabled) { // 사용량과 페이지 정보를 한번에 공개한다
+				telemetryUpdate(0, 1, -size, 0, i);
+			}
 			break;
 		}
 	}
 }
 
+int isBinned(char *ptr, int size) {
+	/*
+		size 크기의 조각 ptr이 bin에 들어있으면 1을 리턴한다.
+		ALLOC_BIN_KEY가 기록된 조각만 bin을 훑어서 확인한다. (사용자가 우연히 같은 값을 써둔 조각은 bin에서 찾지 못한다)
+	*/
+	char *binned;
+
+	if (size > ALLOC_BIN_MAX || ((char **)ptr)[1] != ALLOC_BIN_KEY) {
+		return 0;
+	}
+	for (binned = alloc_bins[ALLOC_SIZE_TO_BIN(size)]; binned; binned = *(char **)binned) {
+		if (binned == ptr) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int flushBins() {
+	/*
+		bin에 모아둔 조각들을 모두 실제로 해제(not_in_use 리스트에 넣고 병합)한다.
+		해제한 조각의 개수를 리턴한다.
+	*/
+	char *ptr;
+	int count = 0;
+	int i, j;
+
+	for (i = 0; i < ALLOC_NUM_BINS; ++i) {
+		while ((ptr = alloc_bins[i])) {
+			alloc_bins[i] = *(char **)ptr;
+			((char **)ptr)[1] = NULL;
+
+			for (j = 0; j < MAX_PAGE_COUNT; ++j) {
+				if (mem[j] && mem[j] <= ptr && ptr < mem[j] + PAGESIZE) {
+					dealloc_one_page(j, ptr);
+					count++;
+					break;
+				}
+			}
+		}
+	}
+
+	if (count && ealloc_telemetry_enabled) { // bin이 모두 비고 페이지들의 free list가 바뀌었다
+		telemetryUpdate(0, 0, 0, -telemetry->binned_bytes, -1);
+	}
+
+	return count;
+}
+
+int alloc_bulk(int size, int n, char **out) {
+	int i;
+
+	if (size <= 0 || n <= 0 || (size % MINALLOC)) {
+		return -1;
+	}
+
+	if (allocBulk(size, n, out)) {
+		return -1;
+	}
+
+	// alloc()과 마찬가지로 샘플은 여기서 직접 기록한다 (내부 함수에서 기록하면 call stack이 어긋난다)
+	for (i = 0; i < n; ++i) {
+		HEAPPROF_ALLOC(out[i], size);
+	}
+
+	return 0;
+}
+
+int allocBulk(int size, int n, char **out) {
+	/*
+		size 크기의 메모리 n개를 할당한다. 새 페이지는 이미 매핑된 페이지들을 다 써본 뒤에만 매핑한다.
+		매핑된 페이지 한 곳에 연속으로 -> bin을 비운 뒤 다시 연속으로 -> 매핑된 페이지들에 하나씩 -> 새 페이지까지 포함해서 같은 순서로
+		n개가 한 페이지에 들어가지 않는 크기면 연속 할당을 위해 새 페이지를 매핑하지 않는다 (남은 페이지를 전부 매핑하게 된다)
+	*/
+	if (bulkFromPages(size, n, out, 0) == 0 || (flushBins() && bulkFromPages(size, n, out, 0) == 0)) {
+		return 0;
+	}
+	if (piecesFromPages(size, n, out, 0) == 0 || ((long)size * n <= PAGESIZE && bulkFromPages(size, n, out, 1) == 0)) {
+		return 0;
+	}
+
+	return piecesFromPages(size, n, out, 1);
+}
+
+int bulkFromPages(int size, int n, char **out, int map_new) { // 한 페이지에서 n개를 한번에 할당하는 함수 (map_new가 0이면 매핑된 페이지에서만)
+	int i;
+
+	for (i = 0; i < MAX_PAGE_COUNT; ++i) {
+		if (!mem[i]) { // 해당 heap 메모리 페이지가 아직 할당되지 않았다면
+			if (!map_new) continue;
+			init_alloc_one_page(i); // 한페이지 할당
+		}
+
+		if (alloc_bulk_one_page(i, size, n, out) == 0) { // 한 페이지 안에서 n개 모두 할당되었다면
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int piecesFromPages(int size, int n, char **out, int map_new) { // 연속된 빈 공간이 없을 때 여러 페이지에 걸쳐 하나씩 할당하는 함수
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		if (!(out[i] = allocChunk(size, map_new))) { // 하나라도 실패하면 앞서 할당한 것들 해제하고 실패
+			dealloc_bulk(out, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void dealloc_bulk(char **ptrs, int n) {
+	Node *node;
+	Node *pos = NULL; // 다음 삽입 위치를 찾기 시작할 not_in_use 노드
+	int page = -1; // pos가 속한 페이지
+	int freed = 0; // 해제한 조각 수
+	long freed_bytes = 0; // 해제한 바이트 수
+	int i, j;
+
+	if (n <= 0) return;
+
+	// 주소 순으로 정렬해두면 페이지마다 not_in_use 리스트를 한번만 훑으면서 모두 삽입, 병합할 수 있다
+	if (!isSortedAddr(ptrs, n)) {
+		qsort(ptrs, n, sizeof(char *), compareAddr);
+	}
+
+	for (i = 0; i < n; ++i) {
+		for (j = 0; j < MAX_PAGE_COUNT; ++j) {
+			if (mem[j] && mem[j] <= ptrs[i] && ptrs[i] < mem[j] + PAGESIZE) {
+				break;
+			}
+		}
+		if (j == MAX_PAGE_COUNT) continue;
+
+		if (!(node = findInUseNode(j, ptrs[i] - mem[j])) || isBinned(ptrs[i], node->size)) continue;
+		HEAPPROF_FREE(ptrs[i]);
+
+		if (j != page) { // 다른 페이지로 넘어가면 해당 페이지 리스트의 처음부터 찾는다
+			page = j;
+			pos = NULL;
+		}
+
+		freed++;
+		freed_bytes += node->size;
+
+		unlinkInUseNode(j, node);
+		pos = insertFreeNode(j, pos, node);
+	}
+
+	if (ealloc_telemetry_enabled) { // 사용량과 페이지 정보를 한번에 공개한다
+		telemetryUpdate(0, freed, -freed_bytes, 0, -1);
+	}
+}
+
+int isSortedAddr(char **ptrs, int n) { // 주소가 이미 오름차순으로 정렬되어 있는지 확인하는 함수
+	int i;
+
+	for (i = 1; i < n; ++i) {
+		if (ptrs[i - 1] > ptrs[i]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int compareAddr(const void *a, const void *b) { // qsort에 사용할 주소 비교 함수
+	char *addr_a = *(char * const *)a;
+	char *addr_b = *(char * const *)b;
+
+	return (addr_a > addr_b) - (addr_a < addr_b);
+}
+
+int ealloc_telemetry_open(const char *name) {
+	/*
+		name 이름의 공유 메모리를 만들어 카운터를 공개하기 시작한다.
+		외부 모니터는 같은 이름으로 읽기 전용 mmap하여 ealloc_telemetry_read()로 읽는다.
+	*/
+	int fd;
+	int i;
+	char *ptr;
+	long binned = 0; // bin에 들어있는 바이트 수
+	long bytes = 0; // 매핑된 페이지에서 free list에 없는 바이트 수
+
+	if (telemetry) return -1; // 이미 공개중
+
+	if ((fd = shm_open(name, O_CREAT | O_RDWR, 0644)) == -1) return -1;
+	if (ftruncate(fd, sizeof(struct ealloc_telemetry)) == -1) {
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+	telemetry = mmap(NULL, sizeof(struct ealloc_telemetry), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (telemetry == MAP_FAILED) {
+		telemetry = NULL;
+		shm_unlink(name);
+		return -1;
+	}
+	strncpy(telemetry_name, name, sizeof(telemetry_name) - 1);
+
+	memset(telemetry, 0, sizeof(struct ealloc_telemetry));
+	telemetry->pid = getpid();
+	telemetry->page_count = MAX_PAGE_COUNT;
+
+	// 지금까지의 상태로 카운터 초기화: bin에 있는 조각은 해제된 것으로 본다
+	// 카운터는 모두 telemetryUpdate()로 갱신해서 모니터가 중간 상태를 읽지 않게 한다
+	for (i = 0; i < ALLOC_NUM_BINS; ++i) {
+		for (ptr = alloc_bins[i]; ptr; ptr = *(char **)ptr) {
+			binned += (i + 1) * MINALLOC;
+		}
+	}
+	rate_window_start = 0;
+	telemetryUpdate(0, 0, 0, binned, -1); // 페이지 정보를 먼저 채운다
+	for (i = 0; i < MAX_PAGE_COUNT; ++i) {
+		if (mem[i]) {
+			bytes += PAGESIZE - telemetry->pages[i].free_bytes;
+		}
+	}
+	telemetryUpdate(0, 0, bytes - binned, 0, -2);
+
+	ealloc_telemetry_enabled = 1;
+	__atomic_store_n(&telemetry->magic, EALLOC_TELEMETRY_MAGIC, __ATOMIC_RELEASE); // 카운터가 다 채워진 뒤에야 모니터가 붙을 수 있다
+
+	return 0;
+}
+
+void ealloc_telemetry_close(void) {
+	/*
+		카운터 공개를 멈추고 공유 메모리를 제거한다.
+	*/
+	if (!telemetry) return;
+
+	ealloc_telemetry_enabled = 0;
+	munmap(telemetry, sizeof(struct ealloc_telemetry));
+	shm_unlink(telemetry_name);
+	telemetry = NULL;
+}
+
+void telemetryUpdate(int allocs, int deallocs, long bytes, long binned, int page) {
+	/*
+		카운터에 변화량을 반영한다. page가 0 이상이면 해당 페이지의 free list를,
+		-1이면 모든 페이지를 다시 훑는다. (-2면 페이지 정보는 그대로)
+		seq를 홀수로 만든 뒤 갱신하고 다시 짝수로 만들어서 reader가 갱신 중인 값을 쓰지 않게 한다.
+	*/
+	struct timespec now;
+	long nanos;
+	int i;
+
+	__atomic_store_n(&telemetry->seq, telemetry->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	telemetry->alloc_count += allocs;
+	telemetry->dealloc_count += deallocs;
+	telemetry->bytes_in_use += bytes;
+	telemetry->binned_bytes += binned;
+
+	if (page >= 0) {
+		scanPageTelemetry(page);
+	} else if (page == -1) {
+		for (i = 0; i < MAX_PAGE_COUNT; ++i) {
+			scanPageTelemetry(i);
+		}
+	}
+
+	// 시간 측정은 EALLOC_RATE_WINDOW번 할당마다 한번만 한다
+	if (!rate_window_start || telemetry->alloc_count / EALLOC_RATE_WINDOW != (telemetry->alloc_count - allocs) / EALLOC_RATE_WINDOW) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		nanos = now.tv_sec * 1000000000L + now.tv_nsec;
+		if (rate_window_start && nanos > rate_window_start) {
+			telemetry->alloc_rate = EALLOC_RATE_WINDOW * 1e9 / (nanos - rate_window_start);
+		}
+		rate_window_start = nanos;
+		telemetry->update_nanos = nanos;
+	}
+
+	__atomic_store_n(&telemetry->seq, telemetry->seq + 1, __ATOMIC_RELEASE);
+}
+
+void scanPageTelemetry(int i) { // i번 페이지의 free list를 훑어서 페이지 정보를 갱신하는 함수
+	struct ealloc_page_telemetry *page = &telemetry->pages[i];
+	Node *node;
+	int was_mapped = page->mapped;
+
+	page->mapped = mem[i] != NULL;
+	page->free_list_len = 0;
+	page->free_bytes = 0;
+	page->largest_free = 0;
+
+	for (node = memLinkedLists[i].mem_not_in_use_head; node; node = node->next_node) {
+		page->free_list_len++;
+		page->free_bytes += node->size;
+		if (node->size > page->largest_free) {
+			page->largest_free = node->size;
+		}
+	}
+
+	telemetry->pages_mapped += page->mapped - was_mapped;
+}
+
+int pageOf(char *addr) { // addr이 속한 페이지 번호를 리턴하는 함수, 없으면 -2
+	int i;
+
+	for (i = 0; i < MAX_PAGE_COUNT; ++i) {
+		if (mem[i] && mem[i] <= addr && addr < mem[i] + PAGESIZE) {
+			return i;
+		}
+	}
+
+	return -2;
+}
 
 void cleanup() {
 	int i = 0;
@@ -75,6 +482,11 @@ void cleanup() {
 		memLinkedLists[i].mem_not_in_use_head = NULL;
 		management_mem = NULL;
 	}
+	memset(alloc_bins, 0, sizeof(alloc_bins)); // bin 비움
+
+	if (ealloc_telemetry_enabled) { // 모든 메모리를 정리했으므로 공개중인 카운터도 맞춰준다
+		telemetryUpdate(0, 0, -telemetry->bytes_in_use, -telemetry->binned_bytes, -1);
+	}
 	
 	return;
 }
@@ -117,6 +529,10 @@ int init_alloc_one_page(int i) {
 	memLinkedLists[i].mem_in_use_head = NULL;
 	memLinkedLists[i].mem_not_in_use_head = new_node;
 
+	if (ealloc_telemetry_enabled) {
+		telemetryUpdate(0, 0, 0, 0, i);
+	}
+
 	return 0;
 }
 
@@ -157,12 +573,16 @@ char *alloc_one_page(int i, int size) {
 		}
 
 		if (mem_not_in_use->size > size) {
+			// in_use list에 넣을 새로운 노드 생성
+			if (!(new_node = getNewNode())) {
+				return NULL;
+			}
+
 			// 사용할 만큼 할당
 			// not_in_use node의 size 변경
 			mem_not_in_use->size -= size;
 
-			// in_use list에 넣을 새로운 노드 생성
-			new_node = getNewNode();
+			new_node->page_index = i;
 			new_node->size = size;
 			new_node->start_addr = mem_not_in_use->start_addr + mem_not_in_use->size; // 앞에서 mem_not_in_use의 size 줄였기 때문에 그냥 size만 더해주면 됨
 			new_node->prev_node = NULL;
@@ -215,16 +635,103 @@ char *alloc_one_page(int i, int size) {
 void dealloc_one_page(int i, char *dealloc_ptr) {
 	int mem_index = dealloc_ptr - mem[i];
 	Node *node;
-	Node *mem_not_in_use;
-	Node *tmp_node;
-	Node *prev_node = NULL;
 
 	if (mem_index < 0 || 4096 <= mem_index) {
 		return;
 	}
 
+	node = findInUseNode(i, mem_index);
+	if (!node) return; // 인자로 전달된 주소에 해당되는 노드를 찾지 못했으면 종료
+
+	unlinkInUseNode(i, node); // mem_in_use 리스트를 정리한다
+	insertFreeNode(i, NULL, node); // mem_not_in_use 리스트에 넣는다
+
+	return;
+}
+
+int alloc_bulk_one_page(int i, int size, int n, char **out) {
+	/*
+		i번 페이지에서 한번의 탐색으로 size 크기의 메모리 n개를 할당한다.
+		n개를 모두 담을 수 있는 빈 공간 하나를 찾아 n조각으로 나누며, 그런 공간이 없으면 -1 리턴
+	*/
+	Node *mem_not_in_use;
+	Node *new_nodes = NULL;
+	Node *new_node;
+	int total_size = size * n;
+	int base_addr;
+	int need_nodes;
+	int j;
+
+	mem_not_in_use = memLinkedLists[i].mem_not_in_use_head;
+	while (mem_not_in_use && mem_not_in_use->size < total_size) {
+		mem_not_in_use = mem_not_in_use->next_node;
+	}
+
+	if (!mem_not_in_use) {
+		return -1;
+	}
+
+	// 크기가 딱 맞으면 빈 공간 노드를 첫 조각으로 재사용하므로 노드가 하나 덜 필요하다
+	need_nodes = (mem_not_in_use->size == total_size) ? n - 1 : n;
+	for (j = 0; j < need_nodes; ++j) {
+		if (!(new_node = getNewNode())) {
+			while (new_nodes) {
+				new_node = new_nodes->next_node;
+				removeNode(new_nodes);
+				new_nodes = new_node;
+			}
+			return -1;
+		}
+		new_node->next_node = new_nodes;
+		new_nodes = new_node;
+	}
+
+	base_addr = mem_not_in_use->start_addr + mem_not_in_use->size - total_size;
+	if (need_nodes < n) {
+		if (mem_not_in_use->prev_node) {
+			mem_not_in_use->prev_node->next_node = mem_not_in_use->next_node;
+		} else {
+			memLinkedLists[i].mem_not_in_use_head = mem_not_in_use->next_node;
+		}
+
+		if (mem_not_in_use->next_node) {
+			mem_not_in_use->next_node->prev_node = mem_not_in_use->prev_node;
+		}
+
+		mem_not_in_use->next_node = new_nodes;
+		new_nodes = mem_not_in_use;
+	} else {
+		mem_not_in_use->size -= total_size;
+	}
+
+	// 뒤쪽 조각부터 넣어서 주소가 낮은 조각이 헤드 쪽에 오도록 한다 (주소 순으로 해제할 때 바로 찾을 수 있음)
+	for (j = n - 1; j >= 0; --j) {
+		new_node = new_nodes;
+		new_nodes = new_nodes->next_node;
+
+		new_node->page_index = i;
+		new_node->start_addr = base_addr + j * size;
+		new_node->size = size;
+		new_node->prev_node = NULL;
+		new_node->next_node = memLinkedLists[i].mem_in_use_head;
+		if (memLinkedLists[i].mem_in_use_head) {
+			memLinkedLists[i].mem_in_use_head->prev_node = new_node;
+		}
+		memLinkedLists[i].mem_in_use_head = new_node;
+
+		out[j] = mem[i] + new_node->start_addr;
+	}
+
+	if (ealloc_telemetry_enabled) {
+		telemetryUpdate(n, 0, (long)size * n, 0, i);
+	}
+
+	return 0;
+}
+
+Node *findInUseNode(int i, int mem_index) {
+	Node *node = memLinkedLists[i].mem_in_use_head;
 
-	node = memLinkedLists[i].mem_in_use_head;
 	while (node) {
 		if (node->start_addr == mem_index) {
 			break;
@@ -233,10 +740,10 @@ void dealloc_one_page(int i, char *dealloc_ptr) {
 		node = node->next_node;
 	}
 
+	return node;
+}
 
-	if (!node) return; // 인자로 전달된 주소에 해당되는 노드를 찾지 못했으면 종료
-
-	// mem_in_use 리스트를 정리한다
+void unlinkInUseNode(int i, Node *node) {
 	if (node->prev_node) { // 헤드노드가 아닐 때
 		node->prev_node->next_node = node->next_node;
 	} else { // 헤드노드일 때
@@ -246,95 +753,80 @@ void dealloc_one_page(int i, char *dealloc_ptr) {
 	if (node->next_node) {
 		node->next_node->prev_node = node->prev_node;
 	}
+}
 
-	// mem_not_in_use 리스트에 넣는다
-	mem_not_in_use = memLinkedLists[i].mem_not_in_use_head;
-	if (!mem_not_in_use) {
-		node->prev_node = NULL;
-		node->next_node = NULL;
-		memLinkedLists[i].mem_not_in_use_head = node;
-	} else {
-		while (mem_not_in_use) {
-			if (mem_not_in_use->start_addr > node->start_addr) {
-				// mem_not_in_list에 node 삽입
-				node->prev_node = mem_not_in_use->prev_node;
-				node->next_node = mem_not_in_use;
-				if (node->prev_node) {
-					node->prev_node->next_node = node;
-				} else {
-					memLinkedLists[i].mem_not_in_use_head = node;	
-				}
-				mem_not_in_use->prev_node = node;
-
-
-				// 뒤쪽 노드와 합칠 수 있는지 확인
-				if (node->next_node) {
-					if (node->start_addr + node->size == node->next_node->start_addr) {
-						tmp_node = node->next_node;
-						node->size += node->next_node->size;
-						node->next_node = node->next_node->next_node;
-						if (node->next_node) {
-							node->next_node->prev_node = node;
-						}
-
-						// 필요 없어진 노드 제거
-						removeNode(tmp_node);
-					}
-				}
-				
-				// 앞쪽 노드와 합칠 수 있는지 확인
-				if (node->prev_node) {
-					if (node->prev_node->start_addr + node->prev_node->size == node->start_addr) {
-						node->prev_node->next_node = node->next_node;
-						if (node->next_node) {
-							node->next_node->prev_node = node->prev_node;
-						}
-						node->prev_node->size += node->size;
-
-						// 필요 없어진 노드 제거
-						removeNode(node);
-					}
+Node *insertFreeNode(int i, Node *start, Node *node) {
+	/*
+		node를 i번 페이지의 not_in_use 리스트에 주소 순으로 넣고 앞뒤 노드와 합칠 수 있으면 합친다.
+		start부터 삽입 위치를 찾으며(NULL이면 헤드부터), 최종적으로 node가 합쳐진 노드를 리턴한다.
+	*/
+	Node *mem_not_in_use = start ? start : memLinkedLists[i].mem_not_in_use_head;
+	Node *prev_node = mem_not_in_use ? mem_not_in_use->prev_node : NULL;
+	Node *tmp_node;
 
-				}
+	while (mem_not_in_use && mem_not_in_use->start_addr < node->start_addr) {
+		prev_node = mem_not_in_use;
+		mem_not_in_use = mem_not_in_use->next_node;
+	}
 
-				break;
-			}
+	// prev_node와 mem_not_in_use 사이에 node 삽입
+	node->prev_node = prev_node;
+	node->next_node = mem_not_in_use;
+	if (prev_node) {
+		prev_node->next_node = node;
+	} else {
+		memLinkedLists[i].mem_not_in_use_head = node;
+	}
+	if (mem_not_in_use) {
+		mem_not_in_use->prev_node = node;
+	}
 
-			prev_node = mem_not_in_use;
-			mem_not_in_use = mem_not_in_use->next_node;
+	// 뒤쪽 노드와 합칠 수 있는지 확인
+	if (node->next_node && node->start_addr + node->size == node->next_node->start_addr) {
+		tmp_node = node->next_node;
+		node->size += tmp_node->size;
+		node->next_node = tmp_node->next_node;
+		if (node->next_node) {
+			node->next_node->prev_node = node;
 		}
 
-		if (!mem_not_in_use) {
-			// mem_not_in_use list의 맨 끝에 삽입해야 하는 경우
-			prev_node->next_node = node;
-			node->prev_node = prev_node;
-			node->next_node = NULL;
-
-			// 앞쪽 노드와 합칠 수 있는지 확인
-			if (node->prev_node) {
-				if (node->prev_node->start_addr + node->prev_node->size == node->start_addr) {
-					node->prev_node->next_node = node->next_node;
-					node->prev_node->size += node->size;
-
-					// 필요 없어진 노드 제거
-					removeNode(node);
-				}
+		// 필요 없어진 노드 제거
+		removeNode(tmp_node);
+	}
 
-			}
+	// 앞쪽 노드와 합칠 수 있는지 확인
+	if (node->prev_node && node->prev_node->start_addr + node->prev_node->size == node->start_addr) {
+		tmp_node = node->prev_node;
+		tmp_node->next_node = node->next_node;
+		if (node->next_node) {
+			node->next_node->prev_node = tmp_node;
 		}
-	}
+		tmp_node->size += node->size;
 
+		// 필요 없어진 노드 제거
+		removeNode(node);
+		node = tmp_node;
+	}
 
-	return;
+	return node;
 }
 
 Node *getNewNode() {
-	while (management_mem->is_valid) {
-		management_mem += 1;
+	int i;
+
+	for (i = 0; i < MAX_NODE_COUNT; ++i) {
+		if (!node_cursor->is_valid) {
+			node_cursor->is_valid = 1;
+			return node_cursor;
+		}
+
+		node_cursor += 1;
+		if (node_cursor == management_mem + MAX_NODE_COUNT) { // 관리 영역의 끝에 도달하면 처음부터 다시 확인
+			node_cursor = management_mem;
+		}
 	}
-	management_mem->is_valid = 1;
 
-	return management_mem;
+	return NULL; // 남은 노드가 없음
 }
 
 void removeNode(Node *node) {
@@ -3,6 +3,7 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include "heapprof.h"
 
 //granularity of memory to mmap from OS
 #define PAGESIZE 4096 
@@ -15,3 +16,46 @@ void init_alloc(void);
 char *alloc(int);
 void dealloc(char *);
 void cleanup(void);
+
+// size class bins: chunks of at most ALLOC_BIN_MAX bytes are not merged on dealloc()
+// but pushed onto the bin of their size, and the next alloc() of that size pops them back.
+// the first sizeof(char *) bytes of a binned chunk hold the next chunk of the bin and the next
+// sizeof(char *) bytes hold ALLOC_BIN_KEY. dealloc() searches the bin only for a chunk carrying the key,
+// so a repeated dealloc() of a binned chunk is found and ignored without a search on every call.
+#define ALLOC_BIN_MAX 1024
+#define ALLOC_NUM_BINS (ALLOC_BIN_MAX / MINALLOC)
+#define ALLOC_SIZE_TO_BIN(size) ((size) / MINALLOC - 1)
+#define ALLOC_BIN_KEY ((char *)alloc_bins)
+
+extern char *alloc_bins[ALLOC_NUM_BINS];
+extern int ealloc_telemetry_enabled;
+
+// fast path for compile-time constant sizes: the size checks and the bin index fold away,
+// leaving a pop from the bin. the generic alloc() runs only when the bin is empty,
+// the heap profiler is sampling, a profile dump was requested or telemetry is being published.
+static inline char *alloc_const(int size)
+{
+	char *ptr;
+
+	if (size <= 0 || size % MINALLOC || size > ALLOC_BIN_MAX || heapprof_sampling || heapprof_dump_requested || ealloc_telemetry_enabled)
+		return (alloc)(size);
+
+	ptr = alloc_bins[ALLOC_SIZE_TO_BIN(size)];
+	if (!ptr)
+		return (alloc)(size);
+	alloc_bins[ALLOC_SIZE_TO_BIN(size)] = *(char **)ptr;
+	((char **)ptr)[1] = NULL;
+
+	return ptr;
+}
+
+#define alloc(size) (__builtin_constant_p(size) ? alloc_const(size) : (alloc)(size))
+
+// batch allocation: n chunks of the same size in one free list pass
+// dealloc_bulk() sorts ptrs by address in place, so the caller's array is reordered.
+int alloc_bulk(int size, int n, char **out);
+void dealloc_bulk(char **ptrs, int n);
+
+// live telemetry: publish allocator counters into the shm segment /name (see ealloc_telemetry.h)
+int ealloc_telemetry_open(const char *name);
+void ealloc_telemetry_close(void);
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "ealloc_telemetry.h"
+
+/*
+	ealloc_telemetry_open()으로 공개된 ealloc의 카운터를 읽기 전용으로 mmap하여 주기적으로 출력한다.
+	usage: ealloc_monitor <shm name> [interval(ms)] [count]
+*/
+
+void print_telemetry(struct ealloc_telemetry *t) { // 스냅샷 하나를 출력하는 함수
+	printf("\033[H\033[J"); // 화면 지우기
+	printf("ealloc telemetry - pid %d\n", t->pid);
+	printf("pages mapped: %d, in use: %ld bytes, binned: %ld bytes\n", t->pages_mapped, t->bytes_in_use, t->binned_bytes);
+	printf("allocs: %ld, deallocs: %ld, alloc rate: %.0f/s\n\n", t->alloc_count, t->dealloc_count, t->alloc_rate);
+
+	printf("%4s %6s %9s %10s %12s\n", "PAGE", "MAPPED", "FREELIST", "FREE(B)", "LARGEST(B)");
+	for (int i = 0; i < t->page_count && i < EALLOC_TELEMETRY_MAX_PAGES; i++) {
+		printf("%4d %6s %9d %10d %12d\n", i, t->pages[i].mapped ? "yes" : "no",
+				t->pages[i].free_list_len, t->pages[i].free_bytes, t->pages[i].largest_free);
+	}
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	struct ealloc_telemetry *shared;
+	struct ealloc_telemetry snapshot;
+	int interval = 1000;
+	int count = -1;
+	int fd;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <shm name> [interval(ms)] [count]\n", argv[0]);
+		exit(1);
+	}
+	if (argc > 2)
+		interval = atoi(argv[2]);
+	if (argc > 3)
+		count = atoi(argv[3]);
+
+	if ((fd = shm_open(argv[1], O_RDONLY, 0)) == -1) {
+		perror("shm_open");
+		exit(1);
+	}
+	shared = mmap(NULL, sizeof(struct ealloc_telemetry), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (shared == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	if (shared->magic != EALLOC_TELEMETRY_MAGIC) {
+		fprintf(stderr, "%s: not an ealloc telemetry segment\n", argv[1]);
+		exit(1);
+	}
+
+	while (count--) {
+		if (ealloc_telemetry_read(shared, &snapshot) == 0) // 쓰는 쪽이 창 안에서 멈춰 있으면 이번 주기는 건너뛴다
+			print_telemetry(&snapshot);
+		else
+			fprintf(stderr, "%s: no consistent snapshot, writer is stalled or gone\n", argv[1]);
+		if (count)
+			usleep(interval * 1000);
+	}
+
+	munmap(shared, sizeof(struct ealloc_telemetry));
+	return 0;
+}
@@ -0,0 +1,71 @@
+// live counters that ealloc publishes into a POSIX shared memory segment.
+// the allocator is the only writer; monitors map the segment read-only.
+// updates follow a seqlock: seq is odd while the allocator is writing, so a reader
+// copies the whole struct and retries if seq was odd or changed during the copy.
+
+#define EALLOC_TELEMETRY_MAGIC 0x45544c4d // "ETLM"
+#define EALLOC_TELEMETRY_MAX_PAGES 16
+
+struct ealloc_page_telemetry
+{
+	int mapped; // 1 once the page has been mmap'ed
+	int free_list_len; // nodes in the page's free list
+	int free_bytes; // bytes in the page's free list
+	int largest_free; // largest free block in the page
+};
+
+struct ealloc_telemetry
+{
+	unsigned int magic;
+	unsigned int seq; // seqlock sequence number
+	int pid; // process publishing the counters
+	int page_count; // valid entries in pages[]
+	int pages_mapped;
+	long bytes_in_use; // bytes handed out by alloc() and not yet dealloc()'ed
+	long binned_bytes; // freed bytes cached in size class bins (not in any free list)
+	long alloc_count; // total alloc() calls that succeeded
+	long dealloc_count; // total dealloc() calls
+	double alloc_rate; // allocations per second, measured over the last EALLOC_RATE_WINDOW allocs
+	long update_nanos; // CLOCK_MONOTONIC time of the last update
+	struct ealloc_page_telemetry pages[EALLOC_TELEMETRY_MAX_PAGES];
+};
+
+#define EALLOC_RATE_WINDOW 1024
+
+// a writer that dies inside its window leaves seq odd for good, so readers give up
+// after this many attempts instead of spinning forever
+#define EALLOC_TELEMETRY_READ_RETRIES 100000
+
+static inline void ealloc_telemetry_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+// reader side: copy a consistent snapshot of *src into *dst.
+// returns 0 on success, -1 if no consistent copy was seen within EALLOC_TELEMETRY_READ_RETRIES attempts
+static inline int ealloc_telemetry_read(const struct ealloc_telemetry *src, struct ealloc_telemetry *dst)
+{
+	unsigned int seq;
+	int tries;
+
+	for (tries = 0; tries < EALLOC_TELEMETRY_READ_RETRIES; tries++) {
+		seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1) {
+			ealloc_telemetry_relax();
+			continue;
+		}
+
+		__builtin_memcpy(dst, (const void *)src, sizeof(*dst));
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) == seq)
+			return 0;
+		ealloc_telemetry_relax();
+	}
+
+	return -1;
+}
@@ -0,0 +1,281 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include <execinfo.h>
+#include "heapprof.h"
+
+#define SAMPLE_HASH_SIZE 1024 // 샘플 해시 테이블 버킷 개수
+#define SKIP_FRAMES 2 // backtrace에서 건너뛸 프레임 수 (heapprof_record_alloc, alloc() 또는 alloc_bulk())
+
+typedef struct sample { // 아직 해제되지 않은 샘플
+	char *ptr; // 샘플링된 메모리 주소 (NULL이면 빈 엔트리)
+	long weight; // 이 샘플이 대표하는 바이트 수 추정치
+	int site; // 할당한 call site의 인덱스
+	int next; // 같은 버킷의 다음 샘플 인덱스 (빈 엔트리일 때는 다음 빈 엔트리)
+} Sample;
+
+typedef struct site { // 같은 call stack에서 발생한 샘플들의 합계
+	unsigned long hash;
+	int depth;
+	void *frames[HEAPPROF_MAX_DEPTH];
+	long live_bytes; // 해제되지 않은 바이트 수 추정치
+	long alloc_bytes; // 지금까지 할당된 바이트 수 추정치
+} Site;
+
+int heapprof_sampling;
+long heapprof_bytes_until_sample;
+int heapprof_live_samples;
+
+long sample_period; // 평균 샘플링 간격(바이트)
+unsigned long rng_state; // 샘플링 간격을 뽑는 난수 상태
+struct timespec start_time; // 샘플링 시작 시간 (할당 속도 계산용)
+
+Sample samples[HEAPPROF_MAX_SAMPLES];
+int sample_buckets[SAMPLE_HASH_SIZE]; // 버킷별 첫 샘플 인덱스 (-1이면 없음)
+int free_sample; // 빈 샘플 엔트리 리스트의 헤드
+
+Site sites[HEAPPROF_MAX_SITES];
+int site_count;
+
+volatile sig_atomic_t heapprof_dump_requested;
+char dump_path_prefix[256]; // 시그널로 요청된 dump를 저장할 파일 이름 앞부분
+
+long nextSampleInterval();
+int findSite(void **frames, int depth);
+void handleDumpSignal(int signo);
+
+int heapprof_start(long period) {
+	/*
+		평균 period 바이트마다 한번씩 샘플링을 시작한다.
+	*/
+	if (period <= 0) return -1;
+
+	heapprof_reset();
+	sample_period = period;
+	rng_state = (unsigned long)time(NULL) | 1;
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	heapprof_bytes_until_sample = nextSampleInterval();
+	heapprof_sampling = 1;
+
+	return 0;
+}
+
+void heapprof_stop(void) {
+	/*
+		새로운 샘플링을 멈춘다. 이미 기록된 샘플은 해제될 때까지 계속 추적한다.
+	*/
+	heapprof_sampling = 0;
+}
+
+void heapprof_reset(void) {
+	/*
+		기록된 샘플과 call site 정보를 모두 지운다.
+	*/
+	int i;
+
+	for (i = 0; i < HEAPPROF_MAX_SAMPLES; ++i) {
+		samples[i].ptr = NULL;
+		samples[i].next = i + 1 < HEAPPROF_MAX_SAMPLES ? i + 1 : -1;
+	}
+	free_sample = 0;
+	for (i = 0; i < SAMPLE_HASH_SIZE; ++i) {
+		sample_buckets[i] = -1;
+	}
+	site_count = 0;
+	heapprof_live_samples = 0;
+}
+
+void heapprof_record_alloc(char *ptr, int size) {
+	/*
+		ptr에 할당된 size 바이트를 샘플로 기록한다.
+		HEAPPROF_ALLOC() 매크로에서 샘플링 간격이 다 찼을 때만 호출된다.
+	*/
+	void *frames[HEAPPROF_MAX_DEPTH + SKIP_FRAMES];
+	int depth;
+	int site;
+	int index;
+	int bucket;
+	long weight;
+
+	heapprof_bytes_until_sample = nextSampleInterval();
+	heapprof_dump_if_requested();
+
+	// 평균 간격 P로 샘플링할 때 size 바이트짜리 할당이 샘플링될 확률은 1 - exp(-size / P)이므로
+	// 그 역수를 곱해 이 샘플이 대표하는 바이트 수를 추정한다
+	weight = (long)(size / (1 - exp(-(double)size / sample_period)));
+
+	depth = backtrace(frames, HEAPPROF_MAX_DEPTH + SKIP_FRAMES) - SKIP_FRAMES;
+	if (depth < 0) depth = 0;
+	if ((site = findSite(frames + SKIP_FRAMES, depth)) == -1) return; // call site 테이블이 가득 참
+
+	sites[site].alloc_bytes += weight;
+
+	if ((index = free_sample) == -1) return; // 샘플 테이블이 가득 차면 할당량만 집계한다
+	free_sample = samples[index].next;
+
+	bucket = ((unsigned long)ptr >> 3) % SAMPLE_HASH_SIZE;
+	samples[index].ptr = ptr;
+	samples[index].weight = weight;
+	samples[index].site = site;
+	samples[index].next = sample_buckets[bucket];
+	sample_buckets[bucket] = index;
+
+	sites[site].live_bytes += weight;
+	heapprof_live_samples++;
+}
+
+void heapprof_record_free(char *ptr) {
+	/*
+		ptr이 샘플링된 메모리였다면 추적을 끝낸다.
+	*/
+	int bucket = ((unsigned long)ptr >> 3) % SAMPLE_HASH_SIZE;
+	int *link = &sample_buckets[bucket];
+	int index;
+
+	heapprof_dump_if_requested();
+
+	while ((index = *link) != -1) {
+		if (samples[index].ptr == ptr) {
+			*link = samples[index].next;
+			sites[samples[index].site].live_bytes -= samples[index].weight;
+
+			samples[index].ptr = NULL;
+			samples[index].next = free_sample;
+			free_sample = index;
+			heapprof_live_samples--;
+			return;
+		}
+		link = &samples[index].next;
+	}
+}
+
+void heapprof_dump(FILE *fp, int type) {
+	/*
+		call site별 live heap 크기(HEAPPROF_INUSE_SPACE) 또는 초당 할당량(HEAPPROF_ALLOC_RATE)을
+		folded stack 형식으로 fp에 출력한다. (flamegraph.pl 등에 바로 넣을 수 있음)
+	*/
+	struct timespec now;
+	double elapsed;
+	long value;
+	char **symbols;
+	char *name, *end;
+	int i, j;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed = (now.tv_sec - start_time.tv_sec) + (now.tv_nsec - start_time.tv_nsec) / 1e9;
+	if (elapsed <= 0) elapsed = 1e-9;
+
+	for (i = 0; i < site_count; ++i) {
+		value = type == HEAPPROF_ALLOC_RATE ? (long)(sites[i].alloc_bytes / elapsed) : sites[i].live_bytes;
+		if (value <= 0) continue;
+
+		symbols = backtrace_symbols(sites[i].frames, sites[i].depth);
+		// 바깥쪽 프레임부터 ';'로 이어서 출력한다
+		for (j = sites[i].depth - 1; j >= 0; --j) {
+			// "binary(function+0x1f) [0x4005d2]" 형식에서 함수 이름만 뽑아내고, 없으면 주소를 출력한다
+			name = symbols ? strchr(symbols[j], '(') : NULL;
+			if (name && name[1] != '+' && name[1] != ')' && (end = strpbrk(name + 1, "+)"))) {
+				fprintf(fp, "%.*s", (int)(end - name - 1), name + 1);
+			} else {
+				fprintf(fp, "%p", sites[i].frames[j]);
+			}
+			fprintf(fp, "%s", j ? ";" : " ");
+		}
+		fprintf(fp, "%ld\n", value);
+		free(symbols);
+	}
+	fflush(fp);
+}
+
+int heapprof_dump_on_signal(int signo, const char *path_prefix) {
+	/*
+		signo 시그널을 받으면 <path_prefix>.inuse.folded와 <path_prefix>.alloc.folded에 프로파일을 저장한다.
+		시그널 핸들러 안에서는 표시만 해두고, 실제 저장은 다음 alloc/dealloc 시점에 한다.
+		(샘플링 중이 아니거나 추적 중인 샘플이 없어도 HEAPPROF_ALLOC(), HEAPPROF_FREE() 매크로가 표시를 확인한다)
+	*/
+	struct sigaction sa;
+
+	strncpy(dump_path_prefix, path_prefix, sizeof(dump_path_prefix) - 1);
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = handleDumpSignal;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+
+	return sigaction(signo, &sa, NULL);
+}
+
+void handleDumpSignal(int signo) {
+	(void)signo;
+	heapprof_dump_requested = 1;
+}
+
+void heapprof_dump_if_requested(void) {
+	/*
+		시그널로 dump가 요청되었으면 프로파일을 파일로 저장한다.
+	*/
+	char path[sizeof(dump_path_prefix) + 16];
+	FILE *fp;
+
+	if (!heapprof_dump_requested) return;
+	heapprof_dump_requested = 0;
+
+	snprintf(path, sizeof(path), "%s.inuse.folded", dump_path_prefix);
+	if ((fp = fopen(path, "w"))) {
+		heapprof_dump(fp, HEAPPROF_INUSE_SPACE);
+		fclose(fp);
+	}
+
+	snprintf(path, sizeof(path), "%s.alloc.folded", dump_path_prefix);
+	if ((fp = fopen(path, "w"))) {
+		heapprof_dump(fp, HEAPPROF_ALLOC_RATE);
+		fclose(fp);
+	}
+}
+
+long nextSampleInterval() {
+	/*
+		평균이 sample_period인 지수분포에서 다음 샘플까지의 바이트 수를 뽑는다.
+		(샘플링 지점들이 poisson process를 이루므로 할당 패턴과 상관없이 편향되지 않는다)
+	*/
+	double u;
+
+	// xorshift64
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+
+	u = ((rng_state >> 11) + 1) / 9007199254740993.0; // (0, 1) 구간의 실수
+
+	return (long)(-log(u) * sample_period) + 1;
+}
+
+int findSite(void **frames, int depth) {
+	/*
+		frames와 같은 call stack을 가진 site의 인덱스를 리턴한다. 없으면 새로 만든다.
+	*/
+	unsigned long hash = depth;
+	int i;
+
+	for (i = 0; i < depth; ++i) {
+		hash = hash * 31 + (unsigned long)frames[i];
+	}
+
+	for (i = 0; i < site_count; ++i) {
+		if (sites[i].hash == hash && sites[i].depth == depth && !memcmp(sites[i].frames, frames, depth * sizeof(void *))) {
+			return i;
+		}
+	}
+
+	if (site_count == HEAPPROF_MAX_SITES) return -1;
+
+	sites[site_count].hash = hash;
+	sites[site_count].depth = depth;
+	memcpy(sites[site_count].frames, frames, depth * sizeof(void *));
+	sites[site_count].live_bytes = 0;
+	sites[site_count].alloc_bytes = 0;
+
+	return site_count++;
+}
@@ -0,0 +1,54 @@
+#ifndef HEAPPROF_H
+#define HEAPPROF_H
+
+#include <stdio.h>
+#include <signal.h>
+
+// sampling heap profiler for alloc()/ealloc()
+// about one in every sample_period allocated bytes is sampled (poisson process):
+// the allocation's backtrace is recorded and tracked until the chunk is deallocated.
+// profiles are written in folded stack format ("root;...;leaf value" per line).
+// link the program with -rdynamic so frames resolve to function names.
+// the recorded stack starts at the caller of the allocator's public entry (alloc(), alloc_bulk()),
+// so the allocators record samples only from those entries and never from their internal helpers.
+
+#define HEAPPROF_MAX_DEPTH 16 // frames recorded per sample
+#define HEAPPROF_MAX_SAMPLES 4096 // live samples tracked at once
+#define HEAPPROF_MAX_SITES 1024 // distinct call stacks
+
+#define HEAPPROF_INUSE_SPACE 0 // estimated live bytes per call site
+#define HEAPPROF_ALLOC_RATE 1 // estimated allocated bytes per second per call site
+
+// hot path state, checked inline by the allocators
+extern int heapprof_sampling; // 1 while sampling is on
+extern long heapprof_bytes_until_sample; // bytes left until the next sample
+extern int heapprof_live_samples; // samples not yet freed
+extern volatile sig_atomic_t heapprof_dump_requested; // set by the dump signal, polled on every alloc/free
+
+int heapprof_start(long sample_period);
+void heapprof_stop(void);
+void heapprof_reset(void);
+void heapprof_dump(FILE *fp, int type);
+int heapprof_dump_on_signal(int signo, const char *path_prefix);
+
+void heapprof_record_alloc(char *ptr, int size);
+void heapprof_record_free(char *ptr);
+void heapprof_dump_if_requested(void);
+
+#define HEAPPROF_ALLOC(ptr, size) \
+	do { \
+		if (heapprof_sampling && (heapprof_bytes_until_sample -= (size)) < 0) \
+			heapprof_record_alloc((ptr), (size)); \
+		else if (heapprof_dump_requested) \
+			heapprof_dump_if_requested(); \
+	} while (0)
+
+#define HEAPPROF_FREE(ptr) \
+	do { \
+		if (heapprof_live_samples) \
+			heapprof_record_free(ptr); \
+		else if (heapprof_dump_requested) \
+			heapprof_dump_if_requested(); \
+	} while (0)
+
+#endif
@@ -179,6 +179,47 @@ int main()
 	printvsz("should not change: ");
 	printf("\n");
 
+	//test 6: size bins; a freed small chunk is handed back to the next alloc() of its size
+	
+	dealloc(strX);
+	char *p = alloc(128);
+	dealloc(p);
+	dealloc(p);	//repeated dealloc of a binned chunk must be ignored
+	char *q = alloc(128);
+	char *r = alloc(128);
+	if (p != NULL && q == p && r != NULL && r != p)
+		printf("Test 6 passed: bin reuse worked\n");
+	else
+		printf("Test 6 failed: p: %p, q: %p, r: %p\n", p, q, r);
+	dealloc(q);
+	dealloc(r);
+
+	printvsz("should not change: ");
+	printf("\n");
+
+	//test 7: bulk alloc/dealloc; n chunks at once, all space returned by dealloc_bulk
+	
+	char *bulk[4];
+	int bulk_ok = (alloc_bulk(256, 4, bulk) == 0);
+	for (int i = 0; bulk_ok && i < 4; i++)
+		memset(bulk[i], 'e' + i, 256);
+	for (int i = 0; bulk_ok && i < 4; i++)
+		for (int j = 0; j < 256; j++)
+			if (bulk[i][j] != 'e' + i)
+				bulk_ok = 0;
+	if (bulk_ok)
+		dealloc_bulk(bulk, 4);
+	if (alloc_bulk(1024, 8, bulk) == 0)	//more than the page holds, must fail as a whole
+		bulk_ok = 0;
+	strX = alloc(2048);	//the 2048 bytes freed above must be whole again
+	if (bulk_ok && strX != NULL)
+		printf("Test 7 passed: bulk alloc and dealloc worked\n");
+	else
+		printf("Test 7 failed\n");
+
+	printvsz("should not change: ");
+	printf("\n");
+
 	///////////////////////////
 
 //	system("ps u");
@@ -14,6 +14,17 @@ void printvsz(char *hint) {
   //getchar();
 }
 
+unsigned long getvsz() { // printvsz()가 출력하는 VSZ 값을 직접 읽어온다
+  unsigned long vsz = 0;
+  FILE *fp = fopen("/proc/self/stat", "r");
+
+  if (fp) {
+    fscanf(fp, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %*u %lu", &vsz);
+    fclose(fp);
+  }
+  return vsz;
+}
+
 int main()
 {
   
@@ -138,6 +149,104 @@ int main()
   printvsz("should not change:");
   printf("Test3: complete\n\n");
 
+  printf("Test4: checking reuse of binned chunks; free 16 X 256B chunks, then allocate 4KB\n");
+
+  //start over with an empty heap so that only page 0 is mapped
+  cleanup();
+  init_alloc();
+
+  char *d[16];
+  for(int i=0; i < 16; i++)
+    d[i] = alloc(256);
+  unsigned long vsz = getvsz();
+  printvsz("start test 4:");
+
+  //the freed chunks sit in the 256B bin; the 4KB request must flush them
+  //back into page 0 instead of mapping a new page
+  for(int i=0; i < 16; i++)
+    dealloc(d[i]);
+
+  char *e = alloc(4096);
+  printvsz("should not change:");
+
+  if(!e || getvsz() != vsz) {
+    printf("ERROR: New page mapped while binned chunks were free\n");
+    exit(1);
+  }
+
+  for(int j=0; j < 4096; j++)
+    *(e+j) = 'e';
+  dealloc(e);
+
+  printf("Test4: complete\n\n");
+
+  printf("Test5: checking size bins; a freed 512B chunk must be reused by the next 512B request\n");
+  printvsz("start test 5:");
+
+  char *p = alloc(512);
+  dealloc(p);
+  dealloc(p);  //repeated dealloc of a binned chunk must be ignored
+  char *q = alloc(512);
+  char *r = alloc(512);
+
+  if(!p || q != p || !r || r == p) {
+    printf("ERROR: Binned chunk was not reused exactly once\n");
+    exit(1);
+  }
+
+  dealloc(q);
+  dealloc(r);
+
+  printvsz("should not change:");
+  printf("Test5: complete\n\n");
+
+  printf("Test6: checking bulk allocation; allocate 8 X 1KB chunks at once\n");
+  vsz = getvsz();
+  printvsz("start test 6:");
+
+  char *f[8];
+  if(alloc_bulk(1024, 8, f)) {
+    printf("ERROR: alloc_bulk failed\n");
+    exit(1);
+  }
+  printvsz("should increase by 4KB:");
+
+  if(getvsz() != vsz + 4096) {
+    printf("ERROR: alloc_bulk mapped more pages than needed\n");
+    exit(1);
+  }
+
+  for(int i=0; i < 8; i++)
+    memset(f[i], 'f' + i, 1024);
+
+  mismatch = 0;
+  for(int i=0; i < 8; i++)
+    for(int j=0; j < 1024; j++)
+      if(f[i][j] != 'f' + i)
+        mismatch = 1;
+
+  if(mismatch) {
+    printf("ERROR: Chunk contents did not match\n");
+    exit(1);
+  }
+
+  dealloc_bulk(f, 8);
+
+  //all 4 pages fit 4 X 4KB but not 5; a failed request must leave nothing allocated
+  if(alloc_bulk(4096, 5, f) == 0 || alloc_bulk(4096, 4, f)) {
+    printf("ERROR: alloc_bulk did not fail as a whole\n");
+    exit(1);
+  }
+  printvsz("should increase by 8KB:");
+
+  if(getvsz() != vsz + 3 * 4096) {
+    printf("ERROR: alloc_bulk mapped more pages than needed\n");
+    exit(1);
+  }
+
+  dealloc_bulk(f, 4);
+  printf("Test6: complete\n\n");
+
     
   cleanup();
   printf("All tests complete\n");
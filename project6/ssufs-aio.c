@@ -0,0 +1,418 @@
+#include "ssufs-aio.h"
+
+extern int DISK_FD;
+extern char *DISK_MAP;
+
+int AIO_BACKEND = -1; // 사용중인 backend (-1이면 아직 ssufs_aioInit()을 하지 않음)
+int AIO_DEPTH; // 완료를 가져가지 않은 요청의 최대 개수
+int AIO_OUTSTANDING; // 제출했지만 아직 완료를 가져가지 않은 요청 수 (제출하는 thread만 사용)
+pthread_mutex_t AIO_LOCK = PTHREAD_MUTEX_INITIALIZER; // 작업 큐와 완료 목록을 보호한다
+pthread_cond_t AIO_WORK_COND = PTHREAD_COND_INITIALIZER; // 작업 큐에 segment가 들어왔을 때
+pthread_cond_t AIO_DONE_COND = PTHREAD_COND_INITIALIZER; // 완료 목록에 요청이 들어왔을 때
+struct aio_segment_t *AIO_QUEUE_HEAD, *AIO_QUEUE_TAIL; // worker thread들이 처리할 segment 큐
+struct aio_request_t *AIO_DONE_HEAD, *AIO_DONE_TAIL; // 완료된 요청 목록
+int AIO_DONE_COUNT;
+pthread_t *AIO_THREADS;
+int AIO_NTHREADS;
+int AIO_STOP; // 1이면 worker thread들이 끝난다
+#ifdef SSUFS_HAVE_IO_URING
+struct uring_t URING;
+#endif
+
+void pushDone(struct aio_request_t *request) { // 요청을 완료 목록에 넣는 함수 (AIO_LOCK을 잡은 상태에서 부른다)
+	request->next = NULL;
+	if (AIO_DONE_TAIL == NULL) {
+		AIO_DONE_HEAD = request;
+	} else {
+		AIO_DONE_TAIL->next = request;
+	}
+	AIO_DONE_TAIL = request;
+	AIO_DONE_COUNT++;
+	pthread_cond_signal(&AIO_DONE_COND);
+}
+
+void finishSegment(struct aio_segment_t *segment, int ok) { // segment가 끝났음을 요청에 알리는 함수 (AIO_LOCK을 잡은 상태에서 부른다)
+	struct aio_request_t *request = segment->request;
+
+	if (!ok) {
+		request->error = 1;
+	}
+	if (--request->pending == 0) {
+		pushDone(request);
+	}
+}
+
+int segmentIo(struct aio_segment_t *segment) { // segment를 읽거나 쓰고 성공했는지 반환하는 함수 (worker thread에서 부른다)
+	ssize_t ret;
+
+	if (DISK_MAP != NULL) {
+		if (segment->write) {
+			memcpy(DISK_MAP + segment->offset, segment->iov.iov_base, segment->iov.iov_len);
+		} else {
+			memcpy(segment->iov.iov_base, DISK_MAP + segment->offset, segment->iov.iov_len);
+		}
+		return 1;
+	}
+	int op = segment->write ? SSUFS_OP_BLOCK_WRITE : SSUFS_OP_BLOCK_READ;
+	unsigned long stat = ssufs_statBegin(op);
+	if (segment->write) {
+		ret = pwrite(DISK_FD, segment->iov.iov_base, segment->iov.iov_len, segment->offset);
+	} else {
+		ret = pread(DISK_FD, segment->iov.iov_base, segment->iov.iov_len, segment->offset);
+	}
+	COUNT_SYSCALL();
+	ssufs_statEnd(op, stat, ret > 0 ? ret : 0, ret != (ssize_t)segment->iov.iov_len);
+	return ret == (ssize_t)segment->iov.iov_len;
+}
+
+void *aioWorker(void *arg) { // 작업 큐에서 segment를 꺼내 처리하는 worker thread
+	(void)arg;
+	pthread_mutex_lock(&AIO_LOCK);
+	for (;;) {
+		struct aio_segment_t *segment;
+		int ok;
+
+		while (AIO_QUEUE_HEAD == NULL && !AIO_STOP) {
+			pthread_cond_wait(&AIO_WORK_COND, &AIO_LOCK);
+		}
+		if (AIO_QUEUE_HEAD == NULL) {
+			break;
+		}
+		segment = AIO_QUEUE_HEAD;
+		AIO_QUEUE_HEAD = segment->next;
+		if (AIO_QUEUE_HEAD == NULL) {
+			AIO_QUEUE_TAIL = NULL;
+		}
+		pthread_mutex_unlock(&AIO_LOCK);
+
+		ok = segmentIo(segment);
+
+		pthread_mutex_lock(&AIO_LOCK);
+		finishSegment(segment, ok);
+	}
+	pthread_mutex_unlock(&AIO_LOCK);
+	return NULL;
+}
+
+#ifdef SSUFS_HAVE_IO_URING
+int uringSetup(int entries) { // io_uring을 만들고 queue들을 매핑하는 함수 (실패하면 -1)
+	struct io_uring_params params;
+
+	memset(&params, 0, sizeof(params));
+	memset(&URING, 0, sizeof(URING));
+	URING.fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (URING.fd < 0) {
+		return -1;
+	}
+
+	URING.sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	URING.cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) { // submission queue와 completion queue를 한번에 매핑한다
+		if (URING.cq_ring_size > URING.sq_ring_size) {
+			URING.sq_ring_size = URING.cq_ring_size;
+		}
+		URING.cq_ring_size = URING.sq_ring_size;
+	}
+	URING.sq_ring = mmap(NULL, URING.sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, URING.fd, IORING_OFF_SQ_RING);
+	URING.cq_ring = URING.sq_ring;
+	if (URING.sq_ring != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+		URING.cq_ring = mmap(NULL, URING.cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, URING.fd, IORING_OFF_CQ_RING);
+	}
+	URING.sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, URING.fd, IORING_OFF_SQES);
+	if (URING.sq_ring == MAP_FAILED || URING.cq_ring == MAP_FAILED || URING.sqes == MAP_FAILED) {
+		close(URING.fd);
+		return -1;
+	}
+
+	URING.sq_head = (unsigned *)((char *)URING.sq_ring + params.sq_off.head);
+	URING.sq_tail = (unsigned *)((char *)URING.sq_ring + params.sq_off.tail);
+	URING.sq_mask = (unsigned *)((char *)URING.sq_ring + params.sq_off.ring_mask);
+	URING.sq_array = (unsigned *)((char *)URING.sq_ring + params.sq_off.array);
+	URING.cq_head = (unsigned *)((char *)URING.cq_ring + params.cq_off.head);
+	URING.cq_tail = (unsigned *)((char *)URING.cq_ring + params.cq_off.tail);
+	URING.cq_mask = (unsigned *)((char *)URING.cq_ring + params.cq_off.ring_mask);
+	URING.cqes = (struct io_uring_cqe *)((char *)URING.cq_ring + params.cq_off.cqes);
+	URING.sq_entries = params.sq_entries;
+	URING.cq_entries = params.cq_entries;
+	return 0;
+}
+
+void uringDestroy() {
+	munmap(URING.sqes, URING.sq_entries * sizeof(struct io_uring_sqe));
+	if (URING.cq_ring != URING.sq_ring) {
+		munmap(URING.cq_ring, URING.cq_ring_size);
+	}
+	munmap(URING.sq_ring, URING.sq_ring_size);
+	close(URING.fd);
+}
+
+void uringReap() { // completion queue에 들어온 완료들을 모두 처리하는 함수
+	unsigned head = *URING.cq_head;
+	unsigned tail = __atomic_load_n(URING.cq_tail, __ATOMIC_ACQUIRE);
+
+	pthread_mutex_lock(&AIO_LOCK);
+	while (head != tail) {
+		struct io_uring_cqe *cqe = &URING.cqes[head & *URING.cq_mask];
+		struct aio_segment_t *segment = (struct aio_segment_t *)(uintptr_t)cqe->user_data;
+
+		finishSegment(segment, cqe->res == (int)segment->iov.iov_len);
+		URING.inflight--;
+		head++;
+	}
+	pthread_mutex_unlock(&AIO_LOCK);
+	__atomic_store_n(URING.cq_head, head, __ATOMIC_RELEASE);
+}
+
+void uringEnter(unsigned wait) {
+	/*
+		submission queue에 모아둔 segment들을 커널에 넘기고, wait가 0이 아니면 완료가 wait개 이상 들어올 때까지 기다린다.
+		시스템콜은 한번이고, 들어온 완료들은 바로 처리한다.
+	*/
+	int ret = syscall(__NR_io_uring_enter, URING.fd, URING.to_submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+
+	COUNT_SYSCALL();
+	if (ret >= 0) {
+		URING.to_submit -= ret;
+		URING.inflight += ret;
+	} else {
+		assert(errno == EINTR || errno == EAGAIN || errno == EBUSY); // 커널이 바쁘면 완료를 처리한 뒤 다시 넘긴다
+	}
+	uringReap();
+}
+
+void uringQueue(struct aio_segment_t *segment) { // segment를 submission queue에 넣는 함수 (가득 차 있으면 먼저 커널에 넘긴다)
+	unsigned tail = *URING.sq_tail;
+	struct io_uring_sqe *sqe;
+
+	while (tail - __atomic_load_n(URING.sq_head, __ATOMIC_ACQUIRE) == URING.sq_entries) {
+		uringEnter(URING.inflight >= URING.cq_entries - URING.sq_entries ? 1 : 0); // completion queue가 넘치지 않도록 기다리면서 넘긴다
+	}
+
+	sqe = &URING.sqes[tail & *URING.sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = segment->write ? IORING_OP_WRITEV : IORING_OP_READV;
+	sqe->fd = DISK_FD;
+	sqe->off = segment->offset;
+	sqe->addr = (uintptr_t)&segment->iov;
+	sqe->len = 1;
+	sqe->user_data = (uintptr_t)segment;
+	URING.sq_array[tail & *URING.sq_mask] = tail & *URING.sq_mask;
+	__atomic_store_n(URING.sq_tail, tail + 1, __ATOMIC_RELEASE);
+	URING.to_submit++;
+}
+#endif
+
+int ssufs_aioInit(int backend, int nthreads, int depth){
+	/*
+		비동기 I/O backend를 정하고 시작한다. 기존 backend는 남은 요청을 모두 끝낸 뒤 정리한다.
+		SSUFS_AIO_THREADS: nthreads개의 worker thread가 segment를 pread/pwrite로 처리한다.
+		SSUFS_AIO_URING: io_uring에 segment들을 모아서 넘긴다. 빌드 환경이나 커널이 지원하지 않으면 -1을 반환한다.
+		depth는 완료를 가져가지 않은 요청의 최대 개수이다.
+	*/
+	ssufs_aioShutdown();
+	AIO_DEPTH = depth < 1 ? 1 : depth;
+	AIO_STOP = 0;
+
+	if (backend == SSUFS_AIO_URING) {
+#ifdef SSUFS_HAVE_IO_URING
+		if (uringSetup(AIO_DEPTH) == -1) {
+			return -1;
+		}
+		AIO_BACKEND = SSUFS_AIO_URING;
+		return 0;
+#else
+		return -1;
+#endif
+	}
+
+	AIO_NTHREADS = nthreads < 1 ? 1 : nthreads;
+	AIO_THREADS = (pthread_t *)malloc(AIO_NTHREADS * sizeof(pthread_t));
+	assert(AIO_THREADS != NULL);
+	for (int i = 0; i < AIO_NTHREADS; i++) {
+		int ret = pthread_create(&AIO_THREADS[i], NULL, aioWorker, NULL);
+		assert(ret == 0);
+	}
+	AIO_BACKEND = SSUFS_AIO_THREADS;
+	return 0;
+}
+
+void ssufs_aioShutdown(){
+	/*
+		남은 요청이 모두 끝나기를 기다린 뒤 (완료는 버린다) backend를 정리한다.
+	*/
+	struct ssufs_completion_t completions[16];
+
+	if (AIO_BACKEND == -1) {
+		return;
+	}
+	while (AIO_OUTSTANDING > 0) {
+		ssufs_poll_completions(completions, 16, 1);
+	}
+
+	if (AIO_BACKEND == SSUFS_AIO_THREADS) {
+		pthread_mutex_lock(&AIO_LOCK);
+		AIO_STOP = 1;
+		pthread_cond_broadcast(&AIO_WORK_COND);
+		pthread_mutex_unlock(&AIO_LOCK);
+		for (int i = 0; i < AIO_NTHREADS; i++) {
+			pthread_join(AIO_THREADS[i], NULL);
+		}
+		free(AIO_THREADS);
+		AIO_THREADS = NULL;
+		AIO_NTHREADS = 0;
+	}
+#ifdef SSUFS_HAVE_IO_URING
+	if (AIO_BACKEND == SSUFS_AIO_URING) {
+		uringDestroy();
+	}
+#endif
+	AIO_BACKEND = -1;
+}
+
+int ssufs_aioFull(){
+	/*
+		완료를 가져가지 않은 요청이 queue depth만큼 있어서 더 제출할 수 없는지 확인한다.
+		아직 backend를 시작하지 않았으면 기본 설정(worker thread)으로 시작한다.
+	*/
+	if (AIO_BACKEND == -1) {
+		ssufs_aioInit(SSUFS_AIO_THREADS, DEFAULT_AIO_THREADS, DEFAULT_AIO_DEPTH);
+	}
+	return AIO_OUTSTANDING >= AIO_DEPTH;
+}
+
+int ssufs_aioOutstanding(){ // 제출했지만 아직 완료를 가져가지 않은 요청 수
+	return AIO_OUTSTANDING;
+}
+
+struct aio_request_t *ssufs_aioNewRequest(void *data, int nbytes){
+	/*
+		segment가 없는 요청을 새로 만든다. ssufs_aioAddSegment()로 segment들을 더한 뒤 ssufs_aioStart()로 시작한다.
+		먼저 ssufs_aioFull()로 더 제출할 수 있는지 확인해야 한다.
+	*/
+	struct aio_request_t *request = (struct aio_request_t *)calloc(1, sizeof(struct aio_request_t));
+
+	assert(request != NULL);
+	request->data = data;
+	request->nbytes = nbytes;
+	AIO_OUTSTANDING++;
+	return request;
+}
+
+void ssufs_aioAddSegment(struct aio_request_t *request, off_t offset, int write, struct iovec *iov){
+	/*
+		ssufs 파일의 offset 위치에서 iov를 읽거나(write가 0) 쓰는 segment를 요청에 더한다.
+	*/
+	struct aio_segment_t *segment = (struct aio_segment_t *)malloc(sizeof(struct aio_segment_t));
+
+	assert(segment != NULL);
+	segment->request = request;
+	segment->offset = offset;
+	segment->write = write;
+	segment->iov = *iov;
+	segment->next = NULL;
+	segment->request_next = request->segments;
+	request->segments = segment;
+	request->pending++;
+}
+
+void ssufs_aioCancel(struct aio_request_t *request){
+	/*
+		아직 시작하지 않았고 segment가 없는 요청을 버린다. (제출이 실패했을 때)
+	*/
+	assert(request->pending == 0);
+	free(request);
+	AIO_OUTSTANDING--;
+}
+
+void ssufs_aioStart(struct aio_request_t *request){
+	/*
+		요청의 segment들을 backend에 넘긴다. segment가 없으면 (buffer cache에서 이미 처리했으면) 바로 완료 목록에 들어간다.
+	*/
+	if (request->pending == 0) {
+		pthread_mutex_lock(&AIO_LOCK);
+		pushDone(request);
+		pthread_mutex_unlock(&AIO_LOCK);
+		return;
+	}
+
+#ifdef SSUFS_HAVE_IO_URING
+	if (AIO_BACKEND == SSUFS_AIO_URING) { // 커널에는 ssufs_poll_completions()나 queue가 가득 찼을 때 모아서 넘긴다
+		for (struct aio_segment_t *segment = request->segments; segment != NULL; segment = segment->request_next) {
+			uringQueue(segment);
+		}
+		return;
+	}
+#endif
+
+	pthread_mutex_lock(&AIO_LOCK);
+	for (struct aio_segment_t *segment = request->segments; segment != NULL; segment = segment->request_next) {
+		if (AIO_QUEUE_TAIL == NULL) {
+			AIO_QUEUE_HEAD = segment;
+		} else {
+			AIO_QUEUE_TAIL->next = segment;
+		}
+		AIO_QUEUE_TAIL = segment;
+	}
+	if (request->pending == 1) {
+		pthread_cond_signal(&AIO_WORK_COND);
+	} else {
+		pthread_cond_broadcast(&AIO_WORK_COND);
+	}
+	pthread_mutex_unlock(&AIO_LOCK);
+}
+
+int ssufs_poll_completions(struct ssufs_completion_t *completions, int max, int min){
+	/*
+		완료된 요청을 최대 max개 completions에 채우고 그 개수를 반환한다.
+		완료된 요청이 min개가 될 때까지 기다린다. (min은 max와 남은 요청 수를 넘지 않도록 줄인다, 0이면 기다리지 않는다)
+		io_uring backend에서는 submission queue에 모아둔 segment들도 이때 커널에 넘긴다.
+	*/
+	int count = 0;
+
+	if (AIO_BACKEND == -1) {
+		return 0;
+	}
+	if (min > max) {
+		min = max;
+	}
+	if (min > AIO_OUTSTANDING) {
+		min = AIO_OUTSTANDING;
+	}
+
+#ifdef SSUFS_HAVE_IO_URING
+	if (AIO_BACKEND == SSUFS_AIO_URING) {
+		uringReap();
+		while (URING.to_submit > 0 || AIO_DONE_COUNT < min) {
+			uringEnter(AIO_DONE_COUNT < min ? 1 : 0);
+		}
+	}
+#endif
+
+	pthread_mutex_lock(&AIO_LOCK);
+	while (AIO_DONE_COUNT < min) {
+		pthread_cond_wait(&AIO_DONE_COND, &AIO_LOCK);
+	}
+	while (count < max && AIO_DONE_HEAD != NULL) {
+		struct aio_request_t *request = AIO_DONE_HEAD;
+
+		AIO_DONE_HEAD = request->next;
+		if (AIO_DONE_HEAD == NULL) {
+			AIO_DONE_TAIL = NULL;
+		}
+		AIO_DONE_COUNT--;
+
+		completions[count].data = request->data;
+		completions[count].result = request->error ? -1 : request->nbytes;
+		count++;
+		while (request->segments != NULL) {
+			struct aio_segment_t *segment = request->segments;
+			request->segments = segment->request_next;
+			free(segment);
+		}
+		free(request);
+	}
+	pthread_mutex_unlock(&AIO_LOCK);
+
+	AIO_OUTSTANDING -= count;
+	return count;
+}
@@ -0,0 +1,79 @@
+#ifndef SSUFS_AIO_H
+#define SSUFS_AIO_H
+
+#include <pthread.h>
+#include <errno.h>
+#include "ssufs-disk.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SSUFS_HAVE_IO_URING // io_uring backend를 빌드한다 (liburing 없이 시스템콜을 직접 사용)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#define SSUFS_AIO_THREADS 0 // worker thread들이 pread/pwrite로 처리한다
+#define SSUFS_AIO_URING 1 // io_uring으로 처리한다 (커널이 지원하지 않으면 ssufs_aioInit()이 실패한다)
+#define DEFAULT_AIO_THREADS 4 // 기본 worker thread 수
+#define DEFAULT_AIO_DEPTH 64 // 기본 queue depth (완료를 가져가지 않은 요청의 최대 개수)
+
+// 비동기 I/O: ssufs_submit_read()/ssufs_submit_write()는 파일의 블록 매핑과 할당을 호출한 thread에서 바로 처리하고,
+// 블록 전체를 읽거나 쓰는 부분만 디스크에서 연속된 구간(segment)으로 나눠 backend에 넘긴다.
+// 요청의 모든 segment가 끝나면 완료 목록에 들어가고 ssufs_poll_completions()로 가져간다.
+
+struct aio_request_t;
+
+struct aio_segment_t // 요청 중에서 디스크에서 연속된 부분 (pread/pwrite 한번)
+{
+	struct aio_request_t *request;
+	off_t offset; // ssufs 파일에서의 위치
+	int write;
+	struct iovec iov;
+	struct aio_segment_t *next; // 작업 큐에서 다음 segment
+	struct aio_segment_t *request_next; // 같은 요청의 다음 segment
+};
+
+struct aio_request_t
+{
+	void *data; // 완료될 때 그대로 돌려줄 값
+	int nbytes; // 성공하면 결과로 돌려줄 바이트 수
+	int pending; // 아직 끝나지 않은 segment 수
+	int error; // 실패한 segment가 있는지
+	struct aio_segment_t *segments; // 이 요청의 segment 목록
+	struct aio_request_t *next; // 완료 목록에서 다음 요청
+};
+
+struct ssufs_completion_t
+{
+	void *data; // ssufs_submit_read()/ssufs_submit_write()에 넘긴 값
+	int result; // 성공하면 읽거나 쓴 바이트 수, 실패하면 -1
+};
+
+#ifdef SSUFS_HAVE_IO_URING
+struct uring_t // io_uring의 submission/completion queue를 매핑한 것
+{
+	int fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	unsigned sq_entries, cq_entries;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_ring_size, cq_ring_size;
+	unsigned to_submit; // submission queue에 넣고 아직 커널에 넘기지 않은 segment 수
+	unsigned inflight; // 커널에 넘기고 아직 완료를 가져오지 않은 segment 수
+};
+#endif
+
+int ssufs_aioInit(int backend, int nthreads, int depth);
+void ssufs_aioShutdown();
+int ssufs_aioFull();
+int ssufs_aioOutstanding();
+struct aio_request_t *ssufs_aioNewRequest(void *data, int nbytes);
+void ssufs_aioAddSegment(struct aio_request_t *request, off_t offset, int write, struct iovec *iov);
+void ssufs_aioCancel(struct aio_request_t *request);
+void ssufs_aioStart(struct aio_request_t *request);
+int ssufs_poll_completions(struct ssufs_completion_t *completions, int max, int min);
+
+#endif
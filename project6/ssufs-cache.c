@@ -0,0 +1,430 @@
+#include "ssufs-cache.h"
+
+int CACHE_SIZE = DEFAULT_CACHE_SIZE; // 다음 format/mount 때 만들 buffer 개수
+struct buffer_t *BUFFERS; // buffer 배열
+int BUFFER_COUNT; // BUFFERS의 buffer 개수
+int BUFFER_SIZE; // buffer 하나의 크기 (디스크의 블록 크기)
+char *BUFFER_DATA; // buffer들의 데이터 영역 (BUFFER_COUNT * BUFFER_SIZE 바이트)
+struct buffer_t **BUFFER_HASH; // 블록 번호로 buffer를 찾는 해시 테이블 (체이닝)
+int BUFFER_HASH_SIZE; // 해시 테이블 버킷 개수 (2의 거듭제곱)
+struct buffer_t LRU_HEAD; // LRU 리스트의 더미 헤드 (head 쪽이 가장 최근에 사용한 buffer)
+struct cache_stats_t CACHE_STATS;
+pthread_mutex_t CACHE_LOCK = PTHREAD_MUTEX_INITIALIZER; // cache 전체(해시 테이블, LRU 리스트, buffer 상태)를 보호한다
+pthread_cond_t CACHE_COND = PTHREAD_COND_INITIALIZER; // buffer를 다 읽었거나 고정이 풀렸을 때
+unsigned CACHE_GENERATION; // ssufs_initCache()마다 증가한다 (이전 cache의 buffer를 고정한 채로 남은 thread를 알아본다)
+__thread struct buffer_t *PINNED; // 이 thread가 마지막으로 받아서 고정해둔 buffer
+__thread unsigned PINNED_GENERATION;
+struct readahead_t *RA_HEAD, *RA_TAIL; // readahead thread가 읽어올 작업 큐 (CACHE_LOCK이 보호한다)
+int RA_BUSY; // readahead thread가 큐에서 꺼내서 읽고 있는 작업 수
+pthread_cond_t RA_COND = PTHREAD_COND_INITIALIZER; // 작업 큐에 작업이 들어왔을 때
+int RA_STARTED; // readahead thread를 만들었는지 (처음 미리 읽기를 요청할 때 만든다)
+
+int hashBlock(int blocknum) {
+	return blocknum & (BUFFER_HASH_SIZE - 1);
+}
+
+void lruRemove(struct buffer_t *buffer) {
+	buffer->lru_prev->lru_next = buffer->lru_next;
+	buffer->lru_next->lru_prev = buffer->lru_prev;
+}
+
+void lruPushFront(struct buffer_t *buffer) {
+	buffer->lru_next = LRU_HEAD.lru_next;
+	buffer->lru_prev = &LRU_HEAD;
+	LRU_HEAD.lru_next->lru_prev = buffer;
+	LRU_HEAD.lru_next = buffer;
+}
+
+void hashRemove(struct buffer_t *buffer) {
+	struct buffer_t **link = &BUFFER_HASH[hashBlock(buffer->blocknum)];
+
+	while (*link != buffer) {
+		link = &(*link)->hash_next;
+	}
+	*link = buffer->hash_next;
+	buffer->hash_next = NULL;
+}
+
+struct buffer_t *hashLookup(int blocknum) {
+	struct buffer_t *buffer = BUFFER_HASH[hashBlock(blocknum)];
+
+	while (buffer != NULL && buffer->blocknum != blocknum) {
+		buffer = buffer->hash_next;
+	}
+	return buffer;
+}
+
+void unpin() { // 이 thread가 고정해둔 buffer를 푸는 함수 (CACHE_LOCK을 잡은 상태에서 부른다)
+	if (PINNED != NULL && PINNED_GENERATION == CACHE_GENERATION) {
+		if (--PINNED->pins == 0) {
+			pthread_cond_broadcast(&CACHE_COND);
+		}
+	}
+	PINNED = NULL;
+}
+
+int pinnedByOthers(struct buffer_t *buffer) { // 다른 thread가 고정해둔 buffer인지 (그 thread가 아직 쓰고 있을 수 있다)
+	return buffer->pins > (buffer == PINNED && PINNED_GENERATION == CACHE_GENERATION ? 1 : 0);
+}
+
+void writeBack(struct buffer_t *buffer) { // dirty buffer를 디스크에 기록하는 함수
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_BLOCK_WRITE);
+	ssufs_diskWrite((off_t)buffer->blocknum * BUFFER_SIZE, buffer->data, BUFFER_SIZE);
+	ssufs_statEnd(SSUFS_OP_BLOCK_WRITE, stat, BUFFER_SIZE, 0);
+	buffer->dirty = 0;
+	CACHE_STATS.writebacks++;
+}
+
+struct buffer_t *findVictim(int keep_prefetched) { // 내보낼 buffer를 LRU 리스트의 뒤쪽부터 찾는 함수 (없으면 NULL)
+	struct buffer_t *buffer = LRU_HEAD.lru_prev;
+
+	while (buffer != &LRU_HEAD && (buffer->pins > 0 || buffer->loading || (keep_prefetched && buffer->prefetched))) {
+		buffer = buffer->lru_prev;
+	}
+	return buffer == &LRU_HEAD ? NULL : buffer;
+}
+
+void assignBuffer(struct buffer_t *buffer, int blocknum) { // buffer를 내보내고 blocknum의 buffer로 만드는 함수 (내용은 채우지 않는다)
+	if (buffer->blocknum != -1) {
+		if (buffer->dirty) {
+			writeBack(buffer);
+		}
+		hashRemove(buffer);
+		CACHE_STATS.evictions++;
+	}
+
+	buffer->blocknum = blocknum;
+	buffer->dirty = 0;
+	buffer->prefetched = 0;
+	buffer->hash_next = BUFFER_HASH[hashBlock(blocknum)];
+	BUFFER_HASH[hashBlock(blocknum)] = buffer;
+	lruRemove(buffer);
+	lruPushFront(buffer);
+}
+
+struct readahead_t *takeReadahead(int blocknum) { // 작업 큐에서 blocknum을 읽을 작업을 꺼내는 함수 (-1이면 맨 앞의 작업, 없으면 NULL)
+	struct readahead_t **link = &RA_HEAD, *prev = NULL;
+
+	while (*link != NULL && blocknum != -1 && (blocknum < (*link)->blocknum || blocknum >= (*link)->blocknum + (*link)->count)) {
+		prev = *link;
+		link = &(*link)->next;
+	}
+	struct readahead_t *job = *link;
+	if (job != NULL) {
+		*link = job->next;
+		if (RA_TAIL == job) {
+			RA_TAIL = prev;
+		}
+	}
+	return job;
+}
+
+void runReadahead(struct readahead_t *job) { // 연속된 블록들을 preadv 한번으로 buffer들에 읽어오는 함수 (CACHE_LOCK을 잡은 상태에서 부르고, 읽는 동안은 풀어둔다)
+	RA_BUSY++;
+	pthread_mutex_unlock(&CACHE_LOCK);
+
+	struct iovec *iov = (struct iovec *)malloc(job->count * sizeof(struct iovec));
+	for (int i = 0; i < job->count; i++) {
+		iov[i].iov_base = job->buffers[i]->data;
+		iov[i].iov_len = BUFFER_SIZE;
+	}
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_BLOCK_READ);
+	ssufs_diskReadv((off_t)job->blocknum * BUFFER_SIZE, iov, job->count);
+	ssufs_statEnd(SSUFS_OP_BLOCK_READ, stat, (long)job->count * BUFFER_SIZE, 0);
+	free(iov);
+
+	pthread_mutex_lock(&CACHE_LOCK);
+	for (int i = 0; i < job->count; i++) {
+		job->buffers[i]->loading = 0;
+		job->buffers[i]->prefetched = 1;
+	}
+	CACHE_STATS.readahead += job->count;
+	RA_BUSY--;
+	pthread_cond_broadcast(&CACHE_COND);
+	free(job->buffers);
+	free(job);
+}
+
+void *readaheadWorker(void *arg) { // 작업 큐에서 작업을 꺼내 읽어오는 thread
+	pthread_mutex_lock(&CACHE_LOCK);
+	for (;;) {
+		struct readahead_t *job;
+		while ((job = takeReadahead(-1)) == NULL) {
+			pthread_cond_wait(&RA_COND, &CACHE_LOCK);
+		}
+		runReadahead(job);
+	}
+	return arg;
+}
+
+void queueReadahead(struct readahead_t *job) { // 작업을 readahead thread에 넘기는 함수 (CACHE_LOCK을 잡은 상태에서 부른다)
+	if (job == NULL) {
+		return;
+	}
+	if (!RA_STARTED) {
+		pthread_t thread;
+		int ret = pthread_create(&thread, NULL, readaheadWorker, NULL);
+		assert(ret == 0);
+		pthread_detach(thread);
+		RA_STARTED = 1;
+	}
+	job->next = NULL;
+	if (RA_TAIL != NULL) {
+		RA_TAIL->next = job;
+	} else {
+		RA_HEAD = job;
+	}
+	RA_TAIL = job;
+	pthread_cond_signal(&RA_COND);
+}
+
+void ssufs_setCacheSize(int nbufs){
+	/*
+		buffer cache의 크기(buffer 개수)를 정한다. 다음 ssufs_formatDisk()/ssufs_mountDisk()부터 적용된다.
+	*/
+	CACHE_SIZE = nbufs < 1 ? 1 : nbufs;
+}
+
+void ssufs_initCache(int block_size){
+	/*
+		크기가 block_size인 빈 buffer CACHE_SIZE개로 cache를 새로 만든다. 기존 cache의 내용은 버린다.
+	*/
+	ssufs_destroyCache();
+
+	BUFFER_HASH_SIZE = 1;
+	while (BUFFER_HASH_SIZE < CACHE_SIZE * 2) {
+		BUFFER_HASH_SIZE <<= 1;
+	}
+	BUFFERS = (struct buffer_t *)calloc(CACHE_SIZE, sizeof(struct buffer_t));
+	BUFFER_HASH = (struct buffer_t **)calloc(BUFFER_HASH_SIZE, sizeof(struct buffer_t *));
+	BUFFER_DATA = (char *)malloc((size_t)CACHE_SIZE * block_size);
+	assert(BUFFERS != NULL && BUFFER_HASH != NULL && BUFFER_DATA != NULL);
+	BUFFER_COUNT = CACHE_SIZE;
+	BUFFER_SIZE = block_size;
+
+	LRU_HEAD.lru_next = LRU_HEAD.lru_prev = &LRU_HEAD;
+	for (int i = 0; i < CACHE_SIZE; i++) {
+		BUFFERS[i].blocknum = -1;
+		BUFFERS[i].data = BUFFER_DATA + (size_t)i * block_size;
+		lruPushFront(&BUFFERS[i]);
+	}
+	memset(&CACHE_STATS, 0, sizeof(CACHE_STATS));
+	CACHE_GENERATION++;
+}
+
+void ssufs_destroyCache(){
+	/*
+		cache를 해제한다. dirty buffer는 기록하지 않으므로 필요하면 먼저 ssufs_flushCache()를 호출해야 한다.
+		다른 thread가 cache를 사용하고 있지 않을 때만 불러야 한다. 진행중인 미리 읽기는 끝날 때까지 기다린다.
+	*/
+	ssufs_waitReadahead();
+	free(BUFFERS);
+	free(BUFFER_HASH);
+	free(BUFFER_DATA);
+	BUFFERS = NULL;
+	BUFFER_HASH = NULL;
+	BUFFER_DATA = NULL;
+	BUFFER_COUNT = 0;
+}
+
+struct buffer_t *ssufs_getBuffer(int blocknum, int read){
+	/*
+		디스크 블록 blocknum의 buffer를 반환한다. cache에 없으면 가장 오래 사용하지 않은 buffer를 재사용하며,
+		read가 0이 아니면 디스크에서 내용을 읽어온다. (블록 전체를 덮어쓸 때는 read를 0으로 주면 된다)
+		반환된 buffer는 이 thread가 다음 buffer를 받기 전까지만 유효하다. 그동안은 고정되어 다른 thread가 내보내지 않는다.
+		디스크에서 읽는 동안은 lock을 풀어두므로 다른 블록에 대한 읽기는 동시에 진행된다.
+	*/
+	struct buffer_t *buffer;
+
+	pthread_mutex_lock(&CACHE_LOCK);
+	unpin();
+	for (;;) {
+		buffer = hashLookup(blocknum);
+		if (buffer != NULL) {
+			if (buffer->loading) { // 다른 thread가 읽어오는 중이면 기다렸다가 다시 찾는다
+				struct readahead_t *job = takeReadahead(blocknum);
+				if (job != NULL) { // 미리 읽기가 아직 시작되지 않았으면 기다리지 않고 직접 읽는다
+					runReadahead(job);
+				} else {
+					pthread_cond_wait(&CACHE_COND, &CACHE_LOCK);
+				}
+				continue;
+			}
+			CACHE_STATS.hits++;
+			if (buffer->prefetched) {
+				buffer->prefetched = 0;
+				CACHE_STATS.readahead_hits++;
+			}
+			lruRemove(buffer);
+			lruPushFront(buffer);
+			break;
+		}
+
+		// LRU 리스트의 뒤쪽부터 고정되지 않은 buffer를 찾아 내보낸다 (모두 고정되어 있으면 풀릴 때까지 기다린다)
+		if ((buffer = findVictim(1)) == NULL && (buffer = findVictim(0)) == NULL) { // 미리 읽어두고 아직 쓰지 않은 buffer는 마지막에 내보낸다
+			pthread_cond_wait(&CACHE_COND, &CACHE_LOCK);
+			continue;
+		}
+		CACHE_STATS.misses++;
+		assignBuffer(buffer, blocknum);
+
+		if (read) {
+			buffer->loading = 1;
+			buffer->pins++;
+			pthread_mutex_unlock(&CACHE_LOCK);
+			unsigned long stat = ssufs_statBegin(SSUFS_OP_BLOCK_READ);
+			ssufs_diskRead((off_t)blocknum * BUFFER_SIZE, buffer->data, BUFFER_SIZE);
+			ssufs_statEnd(SSUFS_OP_BLOCK_READ, stat, BUFFER_SIZE, 0);
+			pthread_mutex_lock(&CACHE_LOCK);
+			buffer->loading = 0;
+			buffer->pins--;
+			pthread_cond_broadcast(&CACHE_COND);
+		}
+		break;
+	}
+	buffer->pins++;
+	PINNED = buffer;
+	PINNED_GENERATION = CACHE_GENERATION;
+	pthread_mutex_unlock(&CACHE_LOCK);
+	return buffer;
+}
+
+void ssufs_releaseBuffer(){
+	/*
+		이 thread가 ssufs_getBuffer()로 받아서 고정해둔 buffer를 푼다. (연산이 끝날 때 불러서 다른 thread가 내보낼 수 있게 한다)
+	*/
+	if (PINNED == NULL) {
+		return;
+	}
+	pthread_mutex_lock(&CACHE_LOCK);
+	unpin();
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+void ssufs_markBufferDirty(struct buffer_t *buffer){
+	pthread_mutex_lock(&CACHE_LOCK);
+	buffer->dirty = 1;
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+void ssufs_flushBuffer(int blocknum, int pinned){
+	/*
+		blocknum의 buffer가 cache에 있고 변경되었으면 디스크에 기록한다.
+		다른 thread가 고정해둔 buffer는 그 thread가 아직 쓰고 있을 수 있으므로 기록하지 않는다.
+		pinned가 1이면 고정된 buffer도 기록한다. 디스크에서 바로 읽기 직전에 부르는 경우로,
+		호출한 쪽이 그 블록에 쓰는 thread가 없음을 보장해야 한다. (inode의 읽기 lock을 잡고 있으면 쓰는 thread는 없다)
+	*/
+	struct buffer_t *buffer;
+
+	pthread_mutex_lock(&CACHE_LOCK);
+	buffer = hashLookup(blocknum);
+	if (buffer != NULL && buffer->dirty && (pinned || !pinnedByOthers(buffer))) {
+		writeBack(buffer);
+	}
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+void ssufs_invalidateBuffer(int blocknum){
+	/*
+		blocknum의 buffer를 기록하지 않고 cache에서 버린다. (해제된 블록에 사용)
+	*/
+	struct buffer_t *buffer;
+
+	pthread_mutex_lock(&CACHE_LOCK);
+	while ((buffer = hashLookup(blocknum)) != NULL && buffer->loading) { // 미리 읽어오는 중이면 끝날 때까지 기다린다
+		struct readahead_t *job = takeReadahead(blocknum);
+		if (job != NULL) {
+			runReadahead(job);
+		} else {
+			pthread_cond_wait(&CACHE_COND, &CACHE_LOCK);
+		}
+	}
+	if (buffer == NULL) {
+		pthread_mutex_unlock(&CACHE_LOCK);
+		return;
+	}
+	hashRemove(buffer);
+	buffer->blocknum = -1;
+	buffer->dirty = 0;
+	buffer->prefetched = 0;
+	lruRemove(buffer); // 빈 buffer는 가장 먼저 재사용되도록 맨 뒤로 보낸다
+	buffer->lru_prev = LRU_HEAD.lru_prev;
+	buffer->lru_next = &LRU_HEAD;
+	LRU_HEAD.lru_prev->lru_next = buffer;
+	LRU_HEAD.lru_prev = buffer;
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+void ssufs_flushCache(){
+	/*
+		변경된 buffer를 모두 디스크에 기록한다. (다른 thread가 고정해둔 buffer는 빼고)
+	*/
+	pthread_mutex_lock(&CACHE_LOCK);
+	for (int i = 0; i < BUFFER_COUNT; i++) {
+		if (BUFFERS[i].blocknum != -1 && BUFFERS[i].dirty && !pinnedByOthers(&BUFFERS[i])) {
+			writeBack(&BUFFERS[i]);
+		}
+	}
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+int ssufs_prefetchBuffers(int blocknum, int count){
+	/*
+		디스크 블록 blocknum부터 count개를 readahead thread가 읽어오게 하고 기다리지 않고 반환한다.
+		이미 cache에 있는 블록은 건너뛰고, indirect block 같은 다른 블록들이 밀려나지 않도록 한번에 cache 크기의 1/4까지만 잡는다.
+		내보낼 수 있는 buffer가 없으면 거기서 멈추며, 앞에서부터 몇 개의 블록을 처리했는지(이미 cache에 있던 블록 포함) 반환한다.
+	*/
+	struct readahead_t *job = NULL;
+	int done;
+
+	if (count > BUFFER_COUNT / 4) {
+		count = BUFFER_COUNT / 4;
+	}
+	pthread_mutex_lock(&CACHE_LOCK);
+	for (done = 0; done < count; done++) {
+		struct buffer_t *buffer = hashLookup(blocknum + done);
+		if (buffer != NULL) { // 디스크에서 연속된 구간은 여기서 끊긴다
+			queueReadahead(job);
+			job = NULL;
+			continue;
+		}
+		if ((buffer = findVictim(1)) == NULL) {
+			break;
+		}
+		assignBuffer(buffer, blocknum + done);
+		buffer->loading = 1;
+		if (job == NULL) {
+			job = (struct readahead_t *)malloc(sizeof(struct readahead_t));
+			job->buffers = (struct buffer_t **)malloc(count * sizeof(struct buffer_t *));
+			job->blocknum = blocknum + done;
+			job->count = 0;
+		}
+		job->buffers[job->count++] = buffer;
+	}
+	queueReadahead(job);
+	pthread_mutex_unlock(&CACHE_LOCK);
+	return done;
+}
+
+void ssufs_waitReadahead(){
+	/*
+		readahead thread에 넘긴 미리 읽기가 모두 끝날 때까지 기다린다. (디스크를 닫거나 cache를 해제하기 전에 부른다)
+	*/
+	pthread_mutex_lock(&CACHE_LOCK);
+	while (RA_HEAD != NULL || RA_BUSY > 0) {
+		pthread_cond_wait(&CACHE_COND, &CACHE_LOCK);
+	}
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+void ssufs_getCacheStats(struct cache_stats_t *stats){
+	pthread_mutex_lock(&CACHE_LOCK);
+	memcpy(stats, &CACHE_STATS, sizeof(struct cache_stats_t));
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
+
+void ssufs_resetCacheStats(){
+	pthread_mutex_lock(&CACHE_LOCK);
+	memset(&CACHE_STATS, 0, sizeof(CACHE_STATS));
+	pthread_mutex_unlock(&CACHE_LOCK);
+}
@@ -0,0 +1,61 @@
+#ifndef SSUFS_CACHE_H
+#define SSUFS_CACHE_H
+
+#include <pthread.h>
+#include "ssufs-disk.h"
+
+#define DEFAULT_CACHE_SIZE 16 // 기본 buffer 개수
+
+// buffer cache: 디스크 블록 번호로 찾고, 가득 차면 가장 오래 사용하지 않은 buffer를 내보낸다(LRU).
+// 변경된 buffer는 내보낼 때나 flush할 때 디스크에 기록된다.
+// 여러 thread에서 사용할 수 있다. ssufs_getBuffer()가 반환한 buffer는 그 thread가 다음 buffer를 받거나
+// ssufs_releaseBuffer()를 부를 때까지 고정(pin)되어 내보내지지 않고, 다른 thread의 flush도 기록하지 않는다.
+// ssufs_prefetchBuffers()는 블록들의 buffer를 바로 잡아두고 읽기는 readahead thread에 맡긴다.
+// 읽기가 끝나기 전에 그 블록을 찾는 thread는 끝날 때까지 기다린다.
+
+struct buffer_t
+{
+	int blocknum; // 디스크 블록 번호 (-1이면 빈 buffer)
+	int dirty;
+	int pins; // 이 buffer를 사용중인 thread 수 (0이 아니면 내보내지 않는다)
+	int loading; // 디스크에서 읽어오는 중이면 1 (다른 thread는 끝날 때까지 기다린다)
+	int prefetched; // 미리 읽어온 뒤 아직 사용되지 않았으면 1
+	char *data; // 블록 크기만큼의 데이터
+	struct buffer_t *hash_next;
+	struct buffer_t *lru_prev;
+	struct buffer_t *lru_next;
+};
+
+struct cache_stats_t
+{
+	long hits;
+	long misses;
+	long evictions;
+	long writebacks; // 디스크에 기록한 dirty buffer 수
+	long readahead; // 미리 읽기로 디스크에서 읽어온 블록 수
+	long readahead_hits; // 미리 읽어온 블록 중 실제로 사용된 블록 수
+};
+
+struct readahead_t // readahead thread가 한번에 읽어올 디스크에서 연속된 블록들
+{
+	int blocknum; // 첫 디스크 블록 번호
+	int count;
+	struct buffer_t **buffers; // 블록마다 채울 buffer (loading이 1로 잡혀있다)
+	struct readahead_t *next;
+};
+
+void ssufs_setCacheSize(int nbufs);
+void ssufs_initCache(int block_size);
+void ssufs_destroyCache();
+struct buffer_t *ssufs_getBuffer(int blocknum, int read);
+void ssufs_releaseBuffer();
+void ssufs_markBufferDirty(struct buffer_t *buffer);
+void ssufs_flushBuffer(int blocknum, int pinned);
+void ssufs_invalidateBuffer(int blocknum);
+void ssufs_flushCache();
+int ssufs_prefetchBuffers(int blocknum, int count);
+void ssufs_waitReadahead();
+void ssufs_getCacheStats(struct cache_stats_t *stats);
+void ssufs_resetCacheStats();
+
+#endif
@@ -1,251 +1,1777 @@
-#include "ssufs-disk.h"
+#include "ssufs-cache.h"
 
+FILE *DISK_FP; // ssufs 파일
+char DISK_PATH[PATH_MAX] = DEFAULT_DISK_PATH; // 다음 format/mount 때 열 ssufs 파일의 경로
 int DISK_FD;   // ssufs을 가리키는 파일 디스크립터
-struct filehandle_t file_handle_array[MAX_OPEN_FILES]; // 열린 파일의 목록을 관리한다.
+struct superblock_t SUPERBLOCK; // 메모리에 올려둔 superblock, 변경되면 sync할 때 디스크에 기록한다
+int SUPERBLOCK_DIRTY; // SUPERBLOCK이 디스크의 내용과 달라졌는지
+uint64_t *BITMAPS; // 메모리에 올려둔 inode bitmap과 data block bitmap (디스크에서 superblock 바로 뒤에 이어서 기록된다)
+uint64_t *INODE_BITMAP; // 1이면 사용중
+uint64_t *DATABLOCK_BITMAP;
+int BITMAP_DIRTY_FROM, BITMAP_DIRTY_TO; // BITMAPS에서 디스크에 기록해야 할 word의 범위 [FROM, TO)
+struct filehandle_t *HANDLE_TABLE[MAX_OPEN_FILES / HANDLE_CHUNK]; // 열린 파일의 목록을 관리한다. (slot이 모자랄 때 HANDLE_CHUNK개씩 만든다)
+int HANDLE_SLOTS; // HANDLE_TABLE에 만들어둔 slot 수
+int FREE_HANDLE = -1; // 비어있는 slot들의 free list의 처음 (-1이면 새 slot들을 만들어야 한다)
+pthread_mutex_t HANDLE_LOCK = PTHREAD_MUTEX_INITIALIZER; // handle table에서 slot을 할당하고 반납할 때 잡는다
+struct inode_cache_t *INODE_CACHE; // 열린 파일들의 inode를 메모리에 올려둔다. (inode 번호로 접근)
+int INODE_CACHE_COUNT; // INODE_CACHE의 항목 수
+long SSUFS_SYSCALLS; // 디스크 접근에 사용한 시스템 콜 수 (비동기 I/O worker도 세므로 COUNT_SYSCALL()로 증가시킨다)
+int INODE_HINT; // inode bitmap에서 이 word 앞쪽은 모두 사용중이다
+int DATABLOCK_HINT; // data block bitmap에서 이 word 앞쪽은 모두 사용중이다
+int DISK_MODE = SSUFS_MODE_PREAD; // 다음 format/mount 때 사용할 디스크 접근 방식
+char *DISK_MAP; // mmap 모드일 때 ssufs 파일 전체를 매핑한 주소 (pread 모드면 NULL)
+int FORMAT_FLAGS; // 다음 format 때 superblock에 기록할 옵션
+int *NAME_HASH; // (디렉토리, 이름)의 해시값으로 inode 번호를 찾는 해시 테이블 (체이닝, -1이면 빈 버킷)
+int NAME_HASH_SIZE; // 해시 테이블 버킷 개수 (2의 거듭제곱)
+struct dentry_t *DENTRIES; // 사용중인 inode들의 이름과 디렉토리 (inode 번호로 접근)
+int PATH_CACHE_SIZE = DEFAULT_PATH_CACHE_SIZE; // 다음 format/mount 때 만들 경로 캐시 항목 수 (2의 거듭제곱, 0이면 사용하지 않음)
+struct path_cache_t *PATH_CACHE; // 디렉토리 경로 -> inode 번호 캐시 (direct-mapped)
+unsigned PATH_GENERATION = 1; // 디렉토리가 지워지면 증가시켜 경로 캐시 전체를 무효로 만든다
+pthread_mutex_t INODE_LOCK = PTHREAD_MUTEX_INITIALIZER; // INODE_CACHE의 refcount와 dirty를 보호한다 (inode 내용은 각 inode의 lock이 보호한다)
+pthread_mutex_t SYNC_LOCK = PTHREAD_MUTEX_INITIALIZER; // ssufs_sync()와 flusher thread의 기록을 한번에 하나씩만 하도록 한다 (메모리를 새로 만들 때도 잡는다)
+int DELAYED_ALLOC = 1; // 다음 format/mount 때 delayed allocation을 쓸지
+int DELAYED_ACTIVE; // 지금의 ssufs에서 delayed allocation을 쓰는지
+int DIRTY_LIMIT = DEFAULT_DIRTY_LIMIT; // delayed 블록으로 모아둘 데이터의 최대 크기 (바이트)
+int FREE_DATA_BLOCKS; // 비어있는 data block 수 (atomic 연산으로 바꾼다)
+int RESERVED_BLOCKS; // delayed 블록들을 위해 예약된 data block 수 (FREE_DATA_BLOCKS를 넘지 않는다)
+int DELAYED_BLOCKS; // 모든 파일의 delayed 블록 수
+pthread_mutex_t FLUSH_LOCK = PTHREAD_MUTEX_INITIALIZER; // FLUSH_COND와 함께 쓴다
+pthread_cond_t FLUSH_COND = PTHREAD_COND_INITIALIZER; // delayed 블록이 DIRTY_LIMIT의 절반을 넘었을 때 flusher thread를 깨운다
+int FLUSH_WANTED; // flusher thread가 주기를 기다리지 않고 기록해야 하는지
+int FLUSHER_STARTED; // flusher thread를 만들었는지 (처음 delayed 블록을 만들 때 만든다)
+extern int DUMP_STATS;
+
+off_t diskSize() { // ssufs 파일 전체의 크기
+	return (off_t)SUPERBLOCK.num_blocks * SUPERBLOCK.block_size;
+}
+
+off_t inodeOffset(int inodenum) { // inode가 기록된 위치 (inode들은 블록 경계와 상관없이 연속해서 기록된다)
+	return (off_t)SUPERBLOCK.inode_start * SUPERBLOCK.block_size + (off_t)inodenum * sizeof(struct inode_t);
+}
+
+void readInodes(int inodenum, void *buf, int count) { // inodenum부터 연속된 inode count개를 디스크에서 읽는 함수
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_INODE_READ);
+	ssufs_diskRead(inodeOffset(inodenum), buf, count * sizeof(struct inode_t));
+	ssufs_statEnd(SSUFS_OP_INODE_READ, stat, count * sizeof(struct inode_t), 0);
+}
+
+void writeInodes(int inodenum, void *buf, int count) { // inodenum부터 연속된 inode count개를 디스크에 기록하는 함수
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_INODE_WRITE);
+	ssufs_diskWrite(inodeOffset(inodenum), buf, count * sizeof(struct inode_t));
+	ssufs_statEnd(SSUFS_OP_INODE_WRITE, stat, count * sizeof(struct inode_t), 0);
+}
+
+int dataBlockToDisk(int blocknum) { // data block 번호를 디스크 전체에서의 블록 번호로 바꾸는 함수
+	return SUPERBLOCK.data_start + blocknum;
+}
+
+int mapDisk() { // mmap 모드면 ssufs 파일 전체를 메모리에 매핑하는 함수
+	DISK_MAP = NULL;
+	if (DISK_MODE != SSUFS_MODE_MMAP)
+		return 0;
+
+	// 아직 기록되지 않은 블록까지 매핑할 수 있도록 파일 크기를 디스크 크기로 맞춘다
+	struct stat st;
+	if (fstat(DISK_FD, &st) == -1)
+		return -1;
+	if (st.st_size < diskSize() && ftruncate(DISK_FD, diskSize()) == -1)
+		return -1;
+
+	void *map = mmap(NULL, diskSize(), PROT_READ | PROT_WRITE, MAP_SHARED, DISK_FD, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	DISK_MAP = map;
+	return 0;
+}
+
+int bitmapTest(uint64_t *bitmap, int index) { // bitmap에서 index번째 비트가 1(사용중)인지 확인하는 함수
+	return (__atomic_load_n(&bitmap[index / 64], __ATOMIC_RELAXED) >> (index % 64)) & 1;
+}
+
+void markBitmapDirty(uint64_t *word) { // BITMAPS의 word가 변경되었음을 표시하는 함수 (여러 thread에서 불러도 된다)
+	int index = word - BITMAPS;
+	int from = __atomic_load_n(&BITMAP_DIRTY_FROM, __ATOMIC_RELAXED);
+	int to = __atomic_load_n(&BITMAP_DIRTY_TO, __ATOMIC_RELAXED);
+
+	while (index < from && !__atomic_compare_exchange_n(&BITMAP_DIRTY_FROM, &from, index, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	while (index + 1 > to && !__atomic_compare_exchange_n(&BITMAP_DIRTY_TO, &to, index + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+	__atomic_store_n(&SUPERBLOCK_DIRTY, 1, __ATOMIC_RELEASE);
+}
+
+void bitmapClear(uint64_t *bitmap, int index, int *hint) {
+	int hint_word = __atomic_load_n(hint, __ATOMIC_RELAXED);
+
+	__atomic_fetch_and(&bitmap[index / 64], ~((uint64_t)1 << (index % 64)), __ATOMIC_RELEASE);
+	markBitmapDirty(&bitmap[index / 64]);
+	while (index / 64 < hint_word && !__atomic_compare_exchange_n(hint, &hint_word, index / 64, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+int bitmapClaimRange(uint64_t *bitmap, int index, int count) {
+	/*
+		bitmap의 index번째부터 count개의 비트를 차례로 1로 바꾸고 바꾼 비트 수를 반환한다.
+		다른 thread가 먼저 1로 바꾼 비트를 만나면 그 앞에서 멈춘다. (word 단위의 atomic 연산이라 lock이 필요 없다)
+	*/
+	int claimed = 0;
+
+	while (claimed < count) {
+		int i = index + claimed;
+		int shift = i % 64;
+		int n = 64 - shift < count - claimed ? 64 - shift : count - claimed;
+		uint64_t mask = (n == 64 ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1)) << shift;
+		uint64_t old = __atomic_fetch_or(&bitmap[i / 64], mask, __ATOMIC_ACQ_REL);
+
+		markBitmapDirty(&bitmap[i / 64]);
+		if (old & mask) { // 첫 충돌 앞까지만 갖고, 그 뒤에서 새로 1로 바꾼 비트는 되돌린다
+			int got = __builtin_ctzll((old & mask) >> shift);
+			uint64_t keep = (got == 0 ? 0 : (((uint64_t)1 << got) - 1)) << shift;
+			__atomic_fetch_and(&bitmap[i / 64], ~(mask & ~old & ~keep), __ATOMIC_RELEASE);
+			return claimed + got;
+		}
+		claimed += n;
+	}
+	return claimed;
+}
+
+int bitmapFindRun(uint64_t *bitmap, int nbits, int from, int want, int *length) {
+	/*
+		bitmap의 from번째 비트부터 0인 비트가 want개 이상 연속된 첫 구간을 찾아 시작 인덱스를 반환하고 *length에 want를 넣는다.
+		그런 구간이 없으면 가장 긴 구간의 시작 인덱스와 길이를 주고, 0인 비트가 하나도 없으면 -1을 반환한다.
+		비트는 바꾸지 않으므로 찾은 구간은 bitmapClaimRange()로 가져가야 한다. (그 사이에 다른 thread가 일부를 가져갈 수 있다)
+	*/
+	int best = -1, best_length = 0;
+	int i = from;
+
+	while (i < nbits) {
+		// i부터 처음 나오는 0인 비트 (빈 구간의 시작)
+		uint64_t word = ~__atomic_load_n(&bitmap[i / 64], __ATOMIC_RELAXED) & (~(uint64_t)0 << (i % 64));
+		if (word == 0) {
+			i = (i / 64 + 1) * 64;
+			continue;
+		}
+		int start = (i / 64) * 64 + __builtin_ctzll(word);
+		if (start >= nbits)
+			break;
+
+		// start부터 처음 나오는 1인 비트 (빈 구간의 끝)
+		int end = start;
+		while (end < nbits) {
+			word = __atomic_load_n(&bitmap[end / 64], __ATOMIC_RELAXED) & (~(uint64_t)0 << (end % 64));
+			if (word != 0) {
+				end = (end / 64) * 64 + __builtin_ctzll(word);
+				break;
+			}
+			end = (end / 64 + 1) * 64;
+		}
+		if (end > nbits)
+			end = nbits;
+
+		if (end - start >= want) {
+			*length = want;
+			return start;
+		}
+		if (end - start > best_length) {
+			best = start;
+			best_length = end - start;
+		}
+		i = end;
+	}
+	*length = best_length;
+	return best;
+}
+
+int bitmapAlloc(uint64_t *bitmap, int nbits, int *hint) {
+	/*
+		bitmap에서 0인 첫 비트를 찾아 1로 바꾸고 그 인덱스를 반환한다. 없으면 -1을 반환한다.
+		64비트씩 검사하며, hint 앞쪽의 word들은 모두 차 있으므로 건너뛴다.
+		비트는 compare-and-swap으로 바꾸므로 여러 thread가 동시에 할당해도 같은 비트를 받지 않는다.
+	*/
+	int nwords = BITMAP_WORDS(nbits);
+
+	for (int pass = 0; pass < 2; pass++) {
+		// hint를 옮기는 사이에 앞쪽이 해제될 수 있으므로 hint부터 찾지 못하면 처음부터 한번 더 찾는다
+		for (int w = pass == 0 ? __atomic_load_n(hint, __ATOMIC_RELAXED) : 0; w < nwords; w++) {
+			uint64_t word = __atomic_load_n(&bitmap[w], __ATOMIC_RELAXED);
+			if (word == ~(uint64_t)0) {
+				int expected = w;
+				__atomic_compare_exchange_n(hint, &expected, w + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+				continue;
+			}
+			int index = w * 64 + __builtin_ctzll(~word);
+			if (index >= nbits) {
+				break;
+			}
+			if (!__atomic_compare_exchange_n(&bitmap[w], &word, word | ((uint64_t)1 << (index % 64)), 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+				w--; // 다른 thread가 먼저 바꿨으면 같은 word를 다시 본다
+				continue;
+			}
+			markBitmapDirty(&bitmap[w]);
+			return index;
+		}
+	}
+	return -1;
+}
+
+void ssufs_setDiskPath(char *path){
+	/*
+		ssufs 파일의 경로를 정한다. 다음 ssufs_formatDisk()/ssufs_mountDisk()부터 적용된다. (기본은 현재 디렉토리의 "ssufs")
+	*/
+	snprintf(DISK_PATH, sizeof(DISK_PATH), "%s", path);
+}
+
+void ssufs_setDiskMode(int mode){
+	/*
+		디스크 접근 방식을 정한다. 다음 ssufs_formatDisk()/ssufs_mountDisk()부터 적용된다.
+		SSUFS_MODE_PREAD: pread/pwrite로 접근하고 data block은 buffer cache를 거친다.
+		SSUFS_MODE_MMAP: 파일 전체를 mmap(MAP_SHARED)으로 매핑해서 메모리처럼 접근하고, sync할 때 msync한다.
+	*/
+	DISK_MODE = mode;
+}
+
+void ssufs_setDelayedAllocation(int on){
+	/*
+		delayed allocation을 쓸지 정한다. 다음 ssufs_formatDisk()/ssufs_mountDisk()부터 적용된다. (기본은 사용)
+		쓰면 파일 끝에 새로 붙는 블록은 메모리에만 만들고, data block은 flush(close, sync, flusher thread)할 때 한꺼번에 할당해서 기록한다.
+	*/
+	DELAYED_ALLOC = on;
+}
+
+void ssufs_setDirtyLimit(int bytes){
+	/*
+		delayed 블록으로 메모리에 모아둘 데이터의 최대 크기를 정한다. 절반을 넘으면 flusher thread가 바로 기록을 시작하고,
+		다 차면 쓰는 thread가 자기 파일의 delayed 블록을 직접 기록한 뒤에 쓴다.
+	*/
+	DIRTY_LIMIT = bytes < 0 ? 0 : bytes;
+}
+
+void ssufs_setFormatFlags(int flags){
+	/*
+		다음 ssufs_formatDisk()/ssufs_formatDiskGeometry()로 만드는 ssufs의 옵션을 정한다. 옵션은 superblock에 기록된다.
+		SSUFS_FLAG_EXTENTS: 파일의 블록들을 (시작 블록, 길이) extent로 관리하고, 가능하면 연속된 블록을 할당한다.
+		SSUFS_FLAG_INLINE: INLINE_DATA_SIZE 이하의 파일은 inode 안에 저장해서 data block을 쓰지 않는다. (커지면 data block으로 옮긴다)
+	*/
+	FORMAT_FLAGS = flags;
+}
+
+void ssufs_diskRead(off_t offset, void *buf, int size){
+	/*
+		ssufs 파일의 offset 위치에서 size 바이트를 buf로 읽어온다.
+		파일 오프셋을 바꾸지 않는 pread를 사용하므로 시스템콜은 한번이다. (mmap 모드면 시스템콜 없이 복사만 한다)
+	*/
+	if (DISK_MAP != NULL) {
+		memcpy(buf, DISK_MAP + offset, size);
+		return;
+	}
+	int ret = pread(DISK_FD, buf, size, offset);
+	assert(ret == size);
+	COUNT_SYSCALL();
+}
+
+void ssufs_diskWrite(off_t offset, void *buf, int size){
+	/*
+		ssufs 파일의 offset 위치에 buf의 size 바이트를 기록한다.
+	*/
+	if (DISK_MAP != NULL) {
+		memcpy(DISK_MAP + offset, buf, size);
+		return;
+	}
+	int ret = pwrite(DISK_FD, buf, size, offset);
+	assert(ret == size);
+	COUNT_SYSCALL();
+}
+
+void ssufs_diskReadv(off_t offset, struct iovec *iov, int iovcnt){
+	/*
+		ssufs 파일의 offset 위치부터 연속된 내용을 iov들에 차례로 읽어온다.
+		iov가 IOV_MAX개 이하면 preadv 한번으로 읽는다. (mmap 모드면 iov마다 복사만 한다)
+	*/
+	while (iovcnt > 0) {
+		int n = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+		size_t size = 0;
+		for (int i = 0; i < n; i++)
+			size += iov[i].iov_len;
+
+		if (DISK_MAP != NULL) {
+			char *src = DISK_MAP + offset;
+			for (int i = 0; i < n; i++) {
+				memcpy(iov[i].iov_base, src, iov[i].iov_len);
+				src += iov[i].iov_len;
+			}
+		} else {
+			ssize_t ret = preadv(DISK_FD, iov, n, offset);
+			assert(ret == (ssize_t)size);
+			COUNT_SYSCALL();
+		}
+		offset += size;
+		iov += n;
+		iovcnt -= n;
+	}
+}
+
+void ssufs_diskWritev(off_t offset, struct iovec *iov, int iovcnt){
+	/*
+		iov들의 내용을 차례로 이어서 ssufs 파일의 offset 위치에 기록한다.
+	*/
+	while (iovcnt > 0) {
+		int n = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+		size_t size = 0;
+		for (int i = 0; i < n; i++)
+			size += iov[i].iov_len;
+
+		if (DISK_MAP != NULL) {
+			char *dst = DISK_MAP + offset;
+			for (int i = 0; i < n; i++) {
+				memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+				dst += iov[i].iov_len;
+			}
+		} else {
+			ssize_t ret = pwritev(DISK_FD, iov, n, offset);
+			assert(ret == (ssize_t)size);
+			COUNT_SYSCALL();
+		}
+		offset += size;
+		iov += n;
+		iovcnt -= n;
+	}
+}
 
 void ssufs_readSuperBlock(struct superblock_t *superblock){
 	/*
 		ssufs에서 superblock_t 구조체를 읽어오는 함수
 	*/
-	char tempBuf[BLOCKSIZE];
-	lseek(DISK_FD, 0, SEEK_SET);
-	int ret = read(DISK_FD ,tempBuf, BLOCKSIZE);
-	assert(ret == BLOCKSIZE);
-	memcpy(superblock, tempBuf, sizeof(struct superblock_t));
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_SUPERBLOCK_READ);
+	ssufs_diskRead(0, superblock, sizeof(struct superblock_t));
+	ssufs_statEnd(SSUFS_OP_SUPERBLOCK_READ, stat, sizeof(struct superblock_t), 0);
 }
 
 void ssufs_writeSuperBlock(struct superblock_t *superblock){
 	/*
-		ssufs에 superblock_t 구조체를 작성하는 함수
+		ssufs에 superblock_t 구조체와 bitmap 중 변경된 부분을 작성하는 함수
 	*/
-	char tempBuf[BLOCKSIZE];
-	memcpy(tempBuf, superblock, sizeof(struct superblock_t));
-	lseek(DISK_FD, 0, SEEK_SET);
-	int ret = write(DISK_FD ,tempBuf, BLOCKSIZE);
-	assert(ret == BLOCKSIZE);
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_SUPERBLOCK_WRITE);
+	// 기록하는 동안 바뀐 word는 범위에 다시 표시되어 다음에 기록된다
+	int from = __atomic_exchange_n(&BITMAP_DIRTY_FROM, INT_MAX, __ATOMIC_ACQ_REL);
+	int to = __atomic_exchange_n(&BITMAP_DIRTY_TO, 0, __ATOMIC_ACQ_REL);
+
+	ssufs_diskWrite(0, superblock, sizeof(struct superblock_t));
+	if (from < to) { // 다른 thread가 바꾸는 중일 수 있으므로 word 단위로 복사해서 기록한다
+		uint64_t *words = (uint64_t *)malloc((to - from) * sizeof(uint64_t));
+		assert(words != NULL);
+		for (int i = from; i < to; i++)
+			words[i - from] = __atomic_load_n(&BITMAPS[i], __ATOMIC_ACQUIRE);
+		ssufs_diskWrite(sizeof(struct superblock_t) + from * sizeof(uint64_t), words, (to - from) * sizeof(uint64_t));
+		free(words);
+	}
+	ssufs_statEnd(SSUFS_OP_SUPERBLOCK_WRITE, stat, sizeof(struct superblock_t) + (from < to ? (to - from) * sizeof(uint64_t) : 0), 0);
+}
+
+int bitmapWords() { // inode bitmap과 data block bitmap의 word 수의 합
+	return BITMAP_WORDS(SUPERBLOCK.num_inodes) + BITMAP_WORDS(SUPERBLOCK.num_data_blocks);
+}
+
+int computeGeometry(struct superblock_t *superblock, int block_size, int num_blocks, int num_inodes, int flags) {
+	/*
+		주어진 geometry로 디스크의 배치를 계산해 superblock에 채운다. 불가능한 geometry면 -1을 반환한다.
+		[superblock + bitmap 블록들][inode 블록들][data block들]
+	*/
+	if (block_size < 64 || (block_size & (block_size - 1)) || num_inodes < 1 || num_blocks < 3 || (flags & ~(SSUFS_FLAG_EXTENTS | SSUFS_FLAG_INLINE)))
+		return -1;
+
+	int inode_blocks = (int)(((long)num_inodes * sizeof(struct inode_t) + block_size - 1) / block_size);
+	int super_blocks = 1;
+	int num_data_blocks;
+
+	// bitmap 크기가 data block 수에 따라 달라지므로 superblock 영역의 크기가 변하지 않을 때까지 다시 계산한다
+	while (1) {
+		num_data_blocks = num_blocks - super_blocks - inode_blocks;
+		if (num_data_blocks < 1)
+			return -1;
+		long bytes = sizeof(struct superblock_t) + (BITMAP_WORDS(num_inodes) + BITMAP_WORDS(num_data_blocks)) * sizeof(uint64_t);
+		int need = (int)((bytes + block_size - 1) / block_size);
+		if (need <= super_blocks)
+			break;
+		super_blocks = need;
+	}
+
+	memset(superblock, 0, sizeof(struct superblock_t));
+	memcpy(superblock->name, "ssufs", sizeof("ssufs"));
+	superblock->block_size = block_size;
+	superblock->num_blocks = num_blocks;
+	superblock->num_inodes = num_inodes;
+	superblock->num_data_blocks = num_data_blocks;
+	superblock->inode_start = super_blocks;
+	superblock->data_start = super_blocks + inode_blocks;
+	superblock->flags = flags;
+	return 0;
+}
+
+uint32_t hashString(char *str, int len) { // 문자열 앞쪽 len 글자의 해시값 (FNV-1a)
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < len && str[i] != '\0'; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+int hashName(int dir, char *name) { // 디렉토리 dir 안의 이름 name이 들어갈 버킷
+	return (hashString(name, MAX_NAME_STRLEN) ^ ((uint32_t)dir * 2654435761u)) & (NAME_HASH_SIZE - 1);
+}
+
+void releaseMemory() { // 메모리에 올려둔 것들을 모두 해제하는 함수 (SYNC_LOCK을 잡은 상태에서 부른다)
+	for (int i = 0; INODE_CACHE != NULL && i < INODE_CACHE_COUNT; i++) {
+		for (int j = 0; j < INODE_CACHE[i].delayed_count; j++) {
+			free(INODE_CACHE[i].delayed[j]);
+		}
+		free(INODE_CACHE[i].delayed);
+	}
+	free(BITMAPS);
+	for (int i = 0; INODE_CACHE != NULL && i < INODE_CACHE_COUNT; i++) {
+		pthread_rwlock_destroy(&INODE_CACHE[i].lock);
+	}
+	free(INODE_CACHE);
+	free(NAME_HASH);
+	free(DENTRIES);
+	free(PATH_CACHE);
+	BITMAPS = INODE_BITMAP = DATABLOCK_BITMAP = NULL;
+	INODE_CACHE = NULL;
+	INODE_CACHE_COUNT = 0;
+	NAME_HASH = NULL;
+	DENTRIES = NULL;
+	PATH_CACHE = NULL;
+	ssufs_destroyCache();
+}
+
+void freeMemory() {
+	pthread_mutex_lock(&SYNC_LOCK); // flusher thread가 기록하는 중이 아닐 때 해제한다
+	releaseMemory();
+	pthread_mutex_unlock(&SYNC_LOCK);
+}
+
+void resetHandles() { // 열려있던 handle을 모두 닫힌 것으로 만들고 free list를 slot 번호 순서로 다시 만드는 함수
+	pthread_mutex_lock(&HANDLE_LOCK);
+	FREE_HANDLE = -1;
+	for (int i = HANDLE_SLOTS - 1; i >= 0; i--) {
+		struct filehandle_t *handle = &HANDLE_TABLE[i / HANDLE_CHUNK][i % HANDLE_CHUNK];
+		if (handle->inode_number != -1) { // 이전 ssufs에서 열려있던 handle 번호는 더 이상 쓸 수 없다
+			__atomic_store_n(&handle->generation, handle->generation + 1, __ATOMIC_RELAXED);
+			handle->inode_number = -1;
+		}
+		handle->offset = 0;
+		handle->next_free = FREE_HANDLE;
+		FREE_HANDLE = i;
+	}
+	pthread_mutex_unlock(&HANDLE_LOCK);
+}
+
+void setupMemory() { // superblock의 geometry에 맞춰 bitmap, inode cache, 이름 해시 테이블, buffer cache를 만드는 함수
+	pthread_mutex_lock(&SYNC_LOCK);
+	releaseMemory();
+	BITMAPS = (uint64_t *)calloc(bitmapWords(), sizeof(uint64_t));
+	INODE_CACHE = (struct inode_cache_t *)calloc(SUPERBLOCK.num_inodes, sizeof(struct inode_cache_t));
+	for (int i = 0; INODE_CACHE != NULL && i < SUPERBLOCK.num_inodes; i++) {
+		pthread_rwlock_init(&INODE_CACHE[i].lock, NULL);
+	}
+	INODE_CACHE_COUNT = SUPERBLOCK.num_inodes;
+	NAME_HASH_SIZE = 1;
+	while (NAME_HASH_SIZE < SUPERBLOCK.num_inodes) {
+		NAME_HASH_SIZE <<= 1;
+	}
+	NAME_HASH = (int *)malloc(NAME_HASH_SIZE * sizeof(int));
+	DENTRIES = (struct dentry_t *)calloc(SUPERBLOCK.num_inodes, sizeof(struct dentry_t));
+	PATH_CACHE = (struct path_cache_t *)calloc(PATH_CACHE_SIZE > 0 ? PATH_CACHE_SIZE : 1, sizeof(struct path_cache_t)); // generation 0은 항상 무효
+	assert(BITMAPS != NULL && INODE_CACHE != NULL && NAME_HASH != NULL && DENTRIES != NULL && PATH_CACHE != NULL);
+	memset(NAME_HASH, 0xff, NAME_HASH_SIZE * sizeof(int));
+	INODE_BITMAP = BITMAPS;
+	DATABLOCK_BITMAP = BITMAPS + BITMAP_WORDS(SUPERBLOCK.num_inodes);
+	BITMAP_DIRTY_FROM = INT_MAX;
+	BITMAP_DIRTY_TO = 0;
+	INODE_HINT = DATABLOCK_HINT = 0;
+	FREE_DATA_BLOCKS = SUPERBLOCK.num_data_blocks; // mount면 bitmap을 읽은 뒤에 다시 센다
+	RESERVED_BLOCKS = 0;
+	DELAYED_BLOCKS = 0;
+	DELAYED_ACTIVE = DELAYED_ALLOC;
+	ssufs_initCache(SUPERBLOCK.block_size);
+
+	resetHandles();
+	pthread_mutex_unlock(&SYNC_LOCK);
 }
 
 void ssufs_formatDisk(){
 	/*
-		ssufs를 초기화하는 함수
+		ssufs를 기본 geometry로 초기화하는 함수
 	*/
+	int ret = ssufs_formatDiskGeometry(BLOCKSIZE, NUM_BLOCKS, NUM_INODES);
+	assert(ret == 0);
+}
 
-	FILE* fp;
-	fp = fopen("ssufs", "w+");
-	DISK_FD = fileno(fp);
+void initMapping(struct inode_t *inode) { // inode의 블록 매핑을 블록이 하나도 없는 상태로 만드는 함수
+	if (SUPERBLOCK.flags & SSUFS_FLAG_EXTENTS) {
+		inode->extent_block = -1;
+		inode->num_extents = 0;
+	} else {
+		for (int j = 0; j < NUM_DIRECT_BLOCKS; j++)
+			inode->direct_blocks[j] = -1;
+		inode->indirect_block = -1;
+		inode->double_indirect_block = -1;
+	}
+}
+
+int ssufs_formatDiskGeometry(int block_size, int num_blocks, int num_inodes){
+	/*
+		블록 크기가 block_size(2의 거듭제곱, 64 이상)이고 전체 블록 수가 num_blocks, inode 수가 num_inodes인 ssufs를 만든다.
+		geometry는 superblock에 기록되어 mount할 때 그대로 사용된다. 불가능한 geometry면 -1을 반환한다.
+	*/
+	struct superblock_t superblock;
+	if (computeGeometry(&superblock, block_size, num_blocks, num_inodes, FORMAT_FLAGS) == -1)
+		return -1;
+
+	ssufs_waitReadahead(); // 이전 디스크에서 미리 읽는 중인 블록이 없도록 한다
+	if ((DISK_FP = fopen(DISK_PATH, "w+")) == NULL)
+		return -1;
+	DISK_FD = fileno(DISK_FP);
 
 	// superblock 초기화
-	struct superblock_t *superblock = (struct superblock_t *)malloc(sizeof(struct superblock_t));
-	memcpy(superblock->name, "ssufs", 8);
-	for(int i=0; i<NUM_INODES; i++)
-		superblock->inode_freelist[i] = INODE_FREE;
-	for(int i=0; i<NUM_DATA_BLOCKS; i++){
-		superblock->datablock_freelist[i] = DATA_BLOCK_FREE;
-	}
-	ssufs_writeSuperBlock(superblock);
-	free(superblock);
-	
-	// inode 초기화
-	struct inode_t *inode = (struct inode_t *)malloc(sizeof(struct inode_t));
-	memcpy(inode->name, "", 1);
-	inode->status = INODE_FREE;
-	inode->file_size = 0;
-	for(int i=0; i<MAX_FILE_SIZE; i++)
-		inode->direct_blocks[i] = -1;
-	for(int i=0; i<NUM_INODES; i++)
-		ssufs_writeInode(i, inode);
-	free(inode);
+	memcpy(&SUPERBLOCK, &superblock, sizeof(SUPERBLOCK));
+	setupMemory();
+	if (ftruncate(DISK_FD, diskSize()) == -1 || mapDisk() == -1) {
+		fclose(DISK_FP);
+		return -1;
+	}
+	BITMAP_DIRTY_FROM = 0;
+	BITMAP_DIRTY_TO = bitmapWords();
+	ssufs_writeSuperBlock(&SUPERBLOCK);
+	SUPERBLOCK_DIRTY = 0;
 
-	// file_handle_array 초기화
-	for(int i=0; i<MAX_OPEN_FILES; i++){
-		file_handle_array[i].inode_number = -1;
-		file_handle_array[i].offset = 0;
+	// inode 초기화 (여러 개씩 모아서 기록한다)
+	int chunk = SUPERBLOCK.num_inodes < 256 ? SUPERBLOCK.num_inodes : 256;
+	struct inode_t *inodes = (struct inode_t *)calloc(chunk, sizeof(struct inode_t));
+	for (int i = 0; i < chunk; i++) {
+		inodes[i].status = INODE_FREE;
+		inodes[i].parent = -1;
+		initMapping(&inodes[i]);
 	}
+	for (int i = 0; i < SUPERBLOCK.num_inodes; i += chunk) {
+		int n = SUPERBLOCK.num_inodes - i < chunk ? SUPERBLOCK.num_inodes - i : chunk;
+		writeInodes(i, inodes, n);
+	}
+	free(inodes);
+	return 0;
 }
 
-int open_namei(char *filename) {
+int ssufs_mountDisk(){
 	/*
-		ssufs에서 filename을 이름으로 갖는 파일의 inodenum을 반환한다.
+		이미 포맷된 ssufs를 열고 superblock과 bitmap을 메모리에 올린다. 실패하면 -1을 반환한다.
 	*/
-	struct superblock_t *superblock = (struct superblock_t *) malloc(sizeof(struct superblock_t));
-	struct inode_t *tmp = (struct inode_t *) malloc(sizeof(struct inode_t));
+	ssufs_waitReadahead();
+	if ((DISK_FP = fopen(DISK_PATH, "r+")) == NULL)
+		return -1;
+	DISK_FD = fileno(DISK_FP);
+	DISK_MAP = NULL;
 
-	if (strlen(filename) > MAX_NAME_STRLEN) {
+	ssufs_readSuperBlock(&SUPERBLOCK);
+	struct superblock_t expected;
+	if (computeGeometry(&expected, SUPERBLOCK.block_size, SUPERBLOCK.num_blocks, SUPERBLOCK.num_inodes, SUPERBLOCK.flags) == -1
+			|| memcmp(&expected, &SUPERBLOCK, sizeof(expected)) != 0) { // ssufs가 아니거나 superblock이 깨진 경우
+		fclose(DISK_FP);
 		return -1;
 	}
+	SUPERBLOCK_DIRTY = 0;
+	setupMemory();
+	if (mapDisk() == -1) {
+		freeMemory();
+		fclose(DISK_FP);
+		return -1;
+	}
+	ssufs_diskRead(sizeof(struct superblock_t), BITMAPS, bitmapWords() * sizeof(uint64_t));
+	for (int i = 0; i < SUPERBLOCK.num_data_blocks; i += 64) { // 비어있는 data block 수를 센다
+		uint64_t used = DATABLOCK_BITMAP[i / 64];
+		if (SUPERBLOCK.num_data_blocks - i < 64)
+			used &= ((uint64_t)1 << (SUPERBLOCK.num_data_blocks - i)) - 1; // bitmap 끝을 넘는 비트는 없는 블록이므로 세지 않는다
+		FREE_DATA_BLOCKS -= __builtin_popcountll(used);
+	}
 
-	ssufs_readSuperBlock(superblock);
+	// 사용중인 inode들의 디렉토리와 이름으로 해시 테이블을 만든다 (inode들을 여러 개씩 모아서 읽는다)
+	int chunk = SUPERBLOCK.num_inodes < 256 ? SUPERBLOCK.num_inodes : 256;
+	struct inode_t *inodes = (struct inode_t *)malloc(chunk * sizeof(struct inode_t));
+	for (int i = 0; i < SUPERBLOCK.num_inodes; i += chunk) {
+		int n = SUPERBLOCK.num_inodes - i < chunk ? SUPERBLOCK.num_inodes - i : chunk;
+		readInodes(i, inodes, n);
+		for (int j = 0; j < n; j++) {
+			if (bitmapTest(INODE_BITMAP, i + j))
+				ssufs_addName(i + j, inodes[j].parent, inodes[j].name, inodes[j].status == INODE_DIR);
+		}
+	}
+	free(inodes);
+	return 0;
+}
 
-	for (int i = 0; i < NUM_INODES; i++) {
-		if (superblock->inode_freelist[i] == INODE_IN_USE) {
-			ssufs_readInode(i, tmp);
-			if (strcmp(tmp->name, filename) == 0) {
-				free(tmp);
-				free(superblock);
-				return i;
-			}
+void flushAllDelayed() { // cache에 올라와 있는 모든 파일의 delayed 블록을 할당해서 기록하는 함수 (SYNC_LOCK을 잡은 상태에서 부른다)
+	for (int i = 0; i < INODE_CACHE_COUNT; i++) {
+		if (__atomic_load_n(&INODE_CACHE[i].delayed_count, __ATOMIC_RELAXED) == 0) {
+			continue;
+		}
+		pthread_mutex_lock(&INODE_LOCK);
+		if (INODE_CACHE[i].refcount == 0) {
+			pthread_mutex_unlock(&INODE_LOCK);
+			continue;
 		}
+		INODE_CACHE[i].refcount++; // 기록하는 동안 cache에서 빠지지 않도록 한다
+		pthread_mutex_unlock(&INODE_LOCK);
+
+		ssufs_lockInode(i, 1);
+		ssufs_flushDelayed(i);
+		ssufs_unlockInode(i);
+		ssufs_putInode(i);
 	}
-	free(superblock);
+}
 
-	return -1;
+void *flusherThread(void *arg) { // FLUSH_INTERVAL_MS마다, 또는 delayed 블록이 DIRTY_LIMIT의 절반을 넘으면 delayed 블록들을 기록하는 thread
+	pthread_mutex_lock(&FLUSH_LOCK);
+	for (;;) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += FLUSH_INTERVAL_MS / 1000;
+		deadline.tv_nsec += (FLUSH_INTERVAL_MS % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		while (!__atomic_load_n(&FLUSH_WANTED, __ATOMIC_ACQUIRE) && pthread_cond_timedwait(&FLUSH_COND, &FLUSH_LOCK, &deadline) != ETIMEDOUT)
+			;
+		__atomic_store_n(&FLUSH_WANTED, 0, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&FLUSH_LOCK);
+
+		pthread_mutex_lock(&SYNC_LOCK);
+		flushAllDelayed();
+		pthread_mutex_unlock(&SYNC_LOCK);
+		pthread_mutex_lock(&FLUSH_LOCK);
+	}
+	return arg;
 }
 
-int ssufs_allocInode(){
+void ssufs_sync(){
+	/*
+		메모리에서 변경된 superblock, inode, data block들을 디스크에 기록한다.
+		다른 thread가 읽고 쓰는 중에 불러도 되며, 그때 진행중인 쓰기는 다음 sync에 기록될 수 있다.
+	*/
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_SYNC);
+	pthread_mutex_lock(&SYNC_LOCK);
+	flushAllDelayed(); // delayed 블록들을 먼저 할당해서 기록한다 (bitmap과 inode가 바뀐다)
+	ssufs_flushCache();
+	if (__atomic_exchange_n(&SUPERBLOCK_DIRTY, 0, __ATOMIC_ACQ_REL)) {
+		ssufs_writeSuperBlock(&SUPERBLOCK);
+	}
+	for (int i = 0; i < SUPERBLOCK.num_inodes; i++) {
+		struct inode_t copy;
+
+		pthread_mutex_lock(&INODE_LOCK);
+		if (INODE_CACHE[i].refcount == 0 || !INODE_CACHE[i].dirty) {
+			pthread_mutex_unlock(&INODE_LOCK);
+			continue;
+		}
+		INODE_CACHE[i].refcount++; // 기록하는 동안 cache에서 빠지지 않도록 한다
+		pthread_mutex_unlock(&INODE_LOCK);
+
+		// 쓰는 thread가 없을 때 복사한다 (쓰는 thread는 inode의 write lock을 잡고 dirty로 표시한다)
+		ssufs_lockInode(i, 0);
+		pthread_mutex_lock(&INODE_LOCK);
+		INODE_CACHE[i].dirty = 0;
+		memcpy(&copy, &INODE_CACHE[i].inode, sizeof(struct inode_t));
+		pthread_mutex_unlock(&INODE_LOCK);
+		ssufs_unlockInode(i);
+
+		writeInodes(i, &copy, 1);
+		ssufs_putInode(i);
+	}
+	if (DISK_MAP != NULL) {
+		msync(DISK_MAP, diskSize(), MS_SYNC);
+		COUNT_SYSCALL();
+	}
+	pthread_mutex_unlock(&SYNC_LOCK);
+	ssufs_statEnd(SSUFS_OP_SYNC, stat, 0, 0);
+}
+
+void ssufs_unmountDisk(){
+	/*
+		변경된 내용을 모두 디스크에 기록하고 ssufs를 닫는다.
+	*/
+	ssufs_sync();
+	if (DISK_MAP != NULL) {
+		munmap(DISK_MAP, diskSize());
+		DISK_MAP = NULL;
+	}
+	freeMemory();
+	fclose(DISK_FP);
+	DISK_FP = NULL;
+	DISK_FD = -1;
+}
+
+void ssufs_setPathCacheSize(int nentries){
 	/*
-		inode_freelist에서 비어있는 첫 노드의 인덱스를 반환한다.
+		경로 캐시의 항목 수를 정한다. (2의 거듭제곱으로 내림하며, 0이면 경로 캐시를 쓰지 않는다)
+		다음 ssufs_formatDisk()/ssufs_mountDisk()부터 적용된다.
 	*/
-	struct superblock_t *superblock = (struct superblock_t *)malloc(sizeof(struct superblock_t));
-	ssufs_readSuperBlock(superblock);
-	for(int i=0; i<NUM_INODES; i++){
-		if(superblock->inode_freelist[i] == INODE_FREE){
-			superblock->inode_freelist[i] = INODE_IN_USE;
-			ssufs_writeSuperBlock(superblock);
-			free(superblock);
+	PATH_CACHE_SIZE = 0;
+	if (nentries > 0) {
+		PATH_CACHE_SIZE = 1;
+		while (PATH_CACHE_SIZE * 2 <= nentries) {
+			PATH_CACHE_SIZE <<= 1;
+		}
+	}
+}
+
+int ssufs_lookup(int dir, char *name){
+	/*
+		디렉토리 dir 안에서 name을 이름으로 갖는 파일이나 디렉토리의 inode 번호를 반환한다. 없으면 -1을 반환한다.
+		디스크의 inode를 읽지 않고 메모리의 이름 해시 테이블에서 찾으므로 디렉토리 크기와 상관없이 일정한 시간이 걸린다.
+	*/
+	for (int i = NAME_HASH[hashName(dir, name)]; i != -1; i = DENTRIES[i].next) {
+		if (DENTRIES[i].parent == dir && strncmp(DENTRIES[i].name, name, MAX_NAME_STRLEN) == 0) {
 			return i;
 		}
 	}
-	free(superblock);
 	return -1;
 }
 
+int walkDir(char *path, int len) {
+	/*
+		path의 앞쪽 len 글자가 가리키는 디렉토리의 inode 번호를 반환한다. 없거나 디렉토리가 아니면 -1을 반환한다.
+		찾은 디렉토리는 경로 캐시에 넣어두고, 캐시에 없으면 한 단계 위의 디렉토리부터 다시 찾으므로
+		공통된 앞부분을 가진 경로들은 앞부분을 매번 다시 따라가지 않는다.
+	*/
+	while (len > 0 && path[len - 1] == '/') // 끝의 '/'는 무시한다
+		len--;
+	if (len == 0)
+		return SSUFS_ROOT_DIR;
+
+	struct path_cache_t *entry = NULL;
+	if (PATH_CACHE_SIZE > 0 && len <= MAX_PATH_STRLEN) {
+		entry = &PATH_CACHE[hashString(path, len) & (PATH_CACHE_SIZE - 1)];
+		if (entry->generation == PATH_GENERATION && strncmp(entry->path, path, len) == 0 && entry->path[len] == '\0')
+			return entry->inodenum;
+	}
+
+	int slash = len - 1; // 마지막 이름 앞의 '/'
+	while (slash >= 0 && path[slash] != '/')
+		slash--;
+	char name[MAX_NAME_STRLEN + 1];
+	if (len - slash - 1 > MAX_NAME_STRLEN)
+		return -1;
+	memcpy(name, path + slash + 1, len - slash - 1);
+	name[len - slash - 1] = '\0';
+
+	int dir = slash < 0 ? SSUFS_ROOT_DIR : walkDir(path, slash);
+	if (dir == -1)
+		return -1;
+	int inodenum = ssufs_lookup(dir, name);
+	if (inodenum == -1 || !DENTRIES[inodenum].is_dir)
+		return -1;
+
+	if (entry != NULL) {
+		memcpy(entry->path, path, len);
+		entry->path[len] = '\0';
+		entry->inodenum = inodenum;
+		entry->generation = PATH_GENERATION;
+	}
+	return inodenum;
+}
+
+int ssufs_resolvePath(char *path, int *dir, char *name){
+	/*
+		path("a/b/c" 또는 "/a/b/c")의 마지막 이름이 들어갈 디렉토리의 inode 번호를 *dir에, 마지막 이름을 name에 넣는다.
+		name은 MAX_NAME_STRLEN + 1 바이트 이상이어야 한다. 중간의 디렉토리가 없거나 이름이 너무 길면 -1을 반환한다.
+	*/
+	while (*path == '/')
+		path++;
+	int len = strlen(path);
+	while (len > 0 && path[len - 1] == '/')
+		len--;
+
+	int slash = len - 1;
+	while (slash >= 0 && path[slash] != '/')
+		slash--;
+	if (len - slash - 1 == 0 || len - slash - 1 > MAX_NAME_STRLEN)
+		return -1;
+	memcpy(name, path + slash + 1, len - slash - 1);
+	name[len - slash - 1] = '\0';
+
+	*dir = slash < 0 ? SSUFS_ROOT_DIR : walkDir(path, slash);
+	return *dir == -1 ? -1 : 0;
+}
+
+int open_namei(char *filename) {
+	/*
+		ssufs에서 경로 filename이 가리키는 파일이나 디렉토리의 inodenum을 반환한다. 없으면 -1을 반환한다.
+	*/
+	int dir;
+	char name[MAX_NAME_STRLEN + 1];
+
+	if (ssufs_resolvePath(filename, &dir, name) == -1) {
+		return -1;
+	}
+	return ssufs_lookup(dir, name);
+}
+
+int ssufs_isDir(int inodenum){
+	return inodenum >= 0 && DENTRIES[inodenum].is_dir;
+}
+
+int ssufs_dirEntries(int inodenum){ // 디렉토리 안에 있는 파일과 디렉토리 수
+	return DENTRIES[inodenum].entries;
+}
+
+void ssufs_addName(int inodenum, int dir, char *name, int is_dir){
+	/*
+		이름 해시 테이블에 디렉토리 dir 안의 name으로 inodenum을 추가한다. (파일이나 디렉토리를 만들 때 호출한다)
+	*/
+	int bucket = hashName(dir, name);
+	struct dentry_t *dentry = &DENTRIES[inodenum];
+	size_t len = strnlen(name, MAX_NAME_STRLEN); // inode에서 읽은 이름은 '\0' 없이 MAX_NAME_STRLEN 글자일 수 있다
+
+	assert(inodenum >= 0 && inodenum < SUPERBLOCK.num_inodes);
+	memcpy(dentry->name, name, len);
+	dentry->name[len] = '\0';
+	dentry->parent = dir;
+	dentry->is_dir = is_dir;
+	dentry->next = NAME_HASH[bucket];
+	NAME_HASH[bucket] = inodenum;
+	if (dir != SSUFS_ROOT_DIR)
+		DENTRIES[dir].entries++;
+}
+
+void ssufs_removeName(int inodenum){
+	/*
+		이름 해시 테이블에서 inodenum을 뺀다. (파일이나 디렉토리를 지울 때 호출한다)
+		디렉토리를 지우면 그 디렉토리를 거치는 경로가 경로 캐시에 남아있을 수 있으므로 경로 캐시 전체를 무효로 만든다.
+	*/
+	struct dentry_t *dentry = &DENTRIES[inodenum];
+	int *link = &NAME_HASH[hashName(dentry->parent, dentry->name)];
+
+	while (*link != inodenum) {
+		assert(*link != -1);
+		link = &DENTRIES[*link].next;
+	}
+	*link = dentry->next;
+	if (dentry->parent != SSUFS_ROOT_DIR)
+		DENTRIES[dentry->parent].entries--;
+	if (dentry->is_dir)
+		PATH_GENERATION++;
+	memset(dentry, 0, sizeof(struct dentry_t));
+}
+
+int reserveBlocks(int count) { // delayed 블록을 위해 data block count개를 예약하는 함수 (음수면 예약을 돌려준다, 남은 블록이 모자라면 -1)
+	int reserved = __atomic_load_n(&RESERVED_BLOCKS, __ATOMIC_RELAXED);
+
+	do {
+		if (count > 0 && __atomic_load_n(&FREE_DATA_BLOCKS, __ATOMIC_RELAXED) - reserved < count)
+			return -1;
+	} while (!__atomic_compare_exchange_n(&RESERVED_BLOCKS, &reserved, reserved + count, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+	return 0;
+}
+
+void discardDelayed(struct inode_cache_t *entry) { // 파일의 delayed 블록들을 기록하지 않고 버리는 함수 (inode의 write lock을 잡았거나 마지막 참조일 때 부른다)
+	if (entry->delayed_count == 0)
+		return;
+	for (int i = 0; i < entry->delayed_count; i++)
+		free(entry->delayed[i]);
+	__atomic_fetch_sub(&DELAYED_BLOCKS, entry->delayed_count, __ATOMIC_RELAXED);
+	reserveBlocks(-entry->reserved);
+	entry->reserved = 0;
+	__atomic_store_n(&entry->delayed_count, 0, __ATOMIC_RELAXED);
+}
+
+int ssufs_allocInode(){
+	/*
+		inode bitmap에서 비어있는 첫 inode의 번호를 반환한다.
+	*/
+	return bitmapAlloc(INODE_BITMAP, SUPERBLOCK.num_inodes, &INODE_HINT);
+}
+
 void ssufs_freeInode(int inodenum){
 	/*
 		inodenum에 해당하는 inode를 free한다.
 	*/
-	assert(inodenum < NUM_INODES);
-	struct superblock_t *superblock = (struct superblock_t *)malloc(sizeof(struct superblock_t));
+	assert(inodenum < SUPERBLOCK.num_inodes);
 	struct inode_t *inode = (struct inode_t *)malloc(sizeof(struct inode_t));
-	ssufs_readSuperBlock(superblock);
+	ssufs_lockInode(inodenum, 1); // 열려있는 파일이면 delayed 블록은 기록하지 않고 버린다
+	discardDelayed(&INODE_CACHE[inodenum]);
+	ssufs_unlockInode(inodenum);
 	ssufs_readInode(inodenum, inode);
-	assert(superblock->inode_freelist[inodenum] == INODE_IN_USE);
-	superblock->inode_freelist[inodenum] = INODE_FREE;
+	assert(bitmapTest(INODE_BITMAP, inodenum));
+	bitmapClear(INODE_BITMAP, inodenum, &INODE_HINT);
 	inode->status = INODE_FREE;
+	if (ssufs_isInline(inode))
+		initMapping(inode); // inline 데이터를 지우고 다음 파일이 쓸 빈 블록 매핑으로 되돌린다
+	else
+		ssufs_freeFileBlocks(inode, 0);
 	inode->file_size = 0;
-	for (int i = 0; i < MAX_FILE_SIZE; i++) {
-		if (inode->direct_blocks[i] != -1) {
-			ssufs_writeSuperBlock(superblock);
-			ssufs_freeDataBlock(inode->direct_blocks[i]);
-			ssufs_readSuperBlock(superblock);
-		}
-		inode->direct_blocks[i] = -1;
-	}
-	ssufs_writeSuperBlock(superblock);
 	ssufs_writeInode(inodenum, inode);
 	free(inode);
-	free(superblock);
+	ssufs_releaseBuffer(); // 블록을 해제하면서 고정한 buffer를 풀어준다
 }
 
 void ssufs_readInode(int inodenum, struct inode_t *inodeptr){
 	/*
 		inodenum에 해당하는 inode_t의 정보를 inodeptr에 읽어온다.
+		inode cache에 올라와 있으면 디스크 대신 cache에서 읽는다.
 	*/
-	assert(inodenum < NUM_INODES);
-	char tempBuf[BLOCKSIZE / NUM_INODES_PER_BLOCK];
-	lseek(DISK_FD, BLOCKSIZE + inodenum * sizeof(struct inode_t), SEEK_SET);
-	int ret = read(DISK_FD, tempBuf, sizeof(struct inode_t));
-	assert(ret == sizeof(struct inode_t));
-	memcpy(inodeptr, tempBuf, sizeof(struct inode_t));
+	assert(inodenum < SUPERBLOCK.num_inodes);
+	pthread_mutex_lock(&INODE_LOCK);
+	if (INODE_CACHE[inodenum].refcount > 0) {
+		memcpy(inodeptr, &INODE_CACHE[inodenum].inode, sizeof(struct inode_t));
+	} else {
+		readInodes(inodenum, inodeptr, 1);
+	}
+	pthread_mutex_unlock(&INODE_LOCK);
 }
 
 void ssufs_writeInode(int inodenum, struct inode_t *inodeptr){
 	/*
 		inodeptr이 가리키는 inode_t의 정보를 inodenum에 작성한다.
+		inode cache에 올라와 있으면 cache만 갱신하고 나중에 write back 한다.
+	*/
+	assert(inodenum < SUPERBLOCK.num_inodes);
+	pthread_mutex_lock(&INODE_LOCK);
+	if (INODE_CACHE[inodenum].refcount > 0) {
+		memcpy(&INODE_CACHE[inodenum].inode, inodeptr, sizeof(struct inode_t));
+		INODE_CACHE[inodenum].dirty = 1;
+	} else {
+		writeInodes(inodenum, inodeptr, 1);
+	}
+	pthread_mutex_unlock(&INODE_LOCK);
+}
+
+struct inode_t *ssufs_getInode(int inodenum){
+	/*
+		inodenum에 해당하는 inode를 inode cache에 올리고(이미 있으면 참조 수만 늘리고) cache의 주소를 반환한다.
+		사용이 끝나면 ssufs_putInode()로 반납해야 한다. 내용을 읽거나 바꿀 때는 ssufs_lockInode()로 inode의 lock을 잡는다.
 	*/
-	assert(inodenum < NUM_INODES);
-	char tempBuf[BLOCKSIZE / NUM_INODES_PER_BLOCK];
-	memcpy(tempBuf, inodeptr, sizeof(struct inode_t));
-	lseek(DISK_FD, BLOCKSIZE + inodenum * sizeof(struct inode_t), SEEK_SET);
-	int ret = write(DISK_FD, tempBuf, sizeof(struct inode_t));
-	assert(ret == sizeof(struct inode_t));
+	assert(inodenum >= 0 && inodenum < SUPERBLOCK.num_inodes);
+	struct inode_cache_t *entry = &INODE_CACHE[inodenum];
+	pthread_mutex_lock(&INODE_LOCK);
+	if (entry->refcount == 0) {
+		readInodes(inodenum, &entry->inode, 1);
+		entry->dirty = 0;
+	}
+	entry->refcount++;
+	pthread_mutex_unlock(&INODE_LOCK);
+	return &entry->inode;
+}
+
+void ssufs_putInode(int inodenum){
+	/*
+		ssufs_getInode()로 얻은 inode를 반납한다. 마지막 참조가 사라질 때 변경된 내용을 디스크에 기록한다.
+	*/
+	assert(inodenum >= 0 && inodenum < SUPERBLOCK.num_inodes);
+	struct inode_cache_t *entry = &INODE_CACHE[inodenum];
+	pthread_mutex_lock(&INODE_LOCK);
+	assert(entry->refcount > 0);
+	assert(entry->refcount > 1 || entry->delayed_count == 0); // 마지막 참조를 반납하기 전에 close가 delayed 블록을 기록한다
+	if (--entry->refcount == 0 && entry->dirty) {
+		writeInodes(inodenum, &entry->inode, 1);
+		entry->dirty = 0;
+	}
+	pthread_mutex_unlock(&INODE_LOCK);
+}
+
+void ssufs_markInodeDirty(int inodenum){
+	/*
+		cache에 올라와 있는 inode가 변경되었음을 표시한다.
+	*/
+	pthread_mutex_lock(&INODE_LOCK);
+	assert(INODE_CACHE[inodenum].refcount > 0);
+	INODE_CACHE[inodenum].dirty = 1;
+	pthread_mutex_unlock(&INODE_LOCK);
+}
+
+void ssufs_lockInode(int inodenum, int write){
+	/*
+		cache에 올라와 있는 inode의 reader-writer lock을 잡는다. write가 0이면 여러 thread가 같이 잡을 수 있다. (읽기)
+		write가 0이 아니면 혼자 잡는다. (파일 크기나 블록 매핑을 바꾸는 쓰기)
+	*/
+	if (write) {
+		pthread_rwlock_wrlock(&INODE_CACHE[inodenum].lock);
+	} else {
+		pthread_rwlock_rdlock(&INODE_CACHE[inodenum].lock);
+	}
+}
+
+void ssufs_unlockInode(int inodenum){
+	/*
+		ssufs_lockInode()로 잡은 lock을 푼다. 그동안 고정해둔 buffer도 함께 풀어준다.
+	*/
+	ssufs_releaseBuffer();
+	pthread_rwlock_unlock(&INODE_CACHE[inodenum].lock);
 }
 
 int ssufs_allocDataBlock(){
 	/*
-		datablock_freelist에서 비어있는 첫 노드의 인덱스를 반환한다.
+		data block bitmap에서 비어있는 첫 블록의 번호를 반환한다.
 	*/
-	struct superblock_t *superblock = (struct superblock_t *)malloc(sizeof(struct superblock_t));
-	ssufs_readSuperBlock(superblock);
-	for (int i = 0; i < NUM_DATA_BLOCKS; i++){
-		if (superblock->datablock_freelist[i] == DATA_BLOCK_FREE){
-			superblock->datablock_freelist[i] = DATA_BLOCK_USED;
-			ssufs_writeSuperBlock(superblock);
-			free(superblock);
-			return i;
-		}
+	int blocknum = bitmapAlloc(DATABLOCK_BITMAP, SUPERBLOCK.num_data_blocks, &DATABLOCK_HINT);
+	if (blocknum != -1) {
+		__atomic_fetch_sub(&FREE_DATA_BLOCKS, 1, __ATOMIC_RELAXED);
 	}
-	free(superblock);
-	return -1;
+	return blocknum;
 }
 
 void ssufs_freeDataBlock(int blocknum){
 	/*
 	 	blocknum에 해당하는 DataBlock을 free한다.
 	*/
-	struct superblock_t *superblock = (struct superblock_t *)malloc(sizeof(struct superblock_t));
-	ssufs_readSuperBlock(superblock);
-	assert(superblock->datablock_freelist[blocknum] == DATA_BLOCK_USED);
-	superblock->datablock_freelist[blocknum] = DATA_BLOCK_FREE;
-	ssufs_writeSuperBlock(superblock);
-	free(superblock);
+	assert(bitmapTest(DATABLOCK_BITMAP, blocknum));
+	bitmapClear(DATABLOCK_BITMAP, blocknum, &DATABLOCK_HINT);
+	__atomic_fetch_add(&FREE_DATA_BLOCKS, 1, __ATOMIC_RELAXED);
+	ssufs_invalidateBuffer(dataBlockToDisk(blocknum)); // 해제된 블록의 내용은 디스크에 기록할 필요가 없다
+}
+
+char *ssufs_getDataBlock(int blocknum){
+	/*
+		blocknum에 해당하는 DataBlock의 내용이 들어있는 buffer cache의 주소를 반환한다.
+		반환된 주소는 다음 디스크 함수 호출 전까지만 유효하다. (mmap 모드면 매핑된 블록의 주소를 바로 반환한다)
+	*/
+	assert(blocknum >= 0 && blocknum < SUPERBLOCK.num_data_blocks);
+	if (DISK_MAP != NULL)
+		return DISK_MAP + (off_t)SUPERBLOCK.block_size * dataBlockToDisk(blocknum);
+	return ssufs_getBuffer(dataBlockToDisk(blocknum), 1)->data;
+}
+
+char *ssufs_getDataBlockForWrite(int blocknum, int overwrite){
+	/*
+		blocknum에 해당하는 DataBlock을 수정하기 위해 buffer cache의 주소를 반환한다. buffer는 dirty로 표시된다.
+		overwrite가 0이 아니면 (새로 할당된 블록이거나 블록 전체를 덮어쓸 때) 디스크에서 읽지 않고 0으로 채워서 준다.
+	*/
+	assert(blocknum >= 0 && blocknum < SUPERBLOCK.num_data_blocks);
+	if (DISK_MAP != NULL) {
+		char *block = DISK_MAP + (off_t)SUPERBLOCK.block_size * dataBlockToDisk(blocknum);
+		if (overwrite)
+			memset(block, 0, SUPERBLOCK.block_size);
+		return block;
+	}
+	struct buffer_t *buffer = ssufs_getBuffer(dataBlockToDisk(blocknum), !overwrite);
+	if (overwrite) {
+		memset(buffer->data, 0, SUPERBLOCK.block_size);
+	}
+	ssufs_markBufferDirty(buffer);
+	return buffer->data;
 }
 
 void ssufs_readDataBlock(int blocknum, char *buf){
 	/*
-		buf 배열에 blocknum에 해당하는 DataBlock의 데이터를 읽어온다.
+		buf 배열에 blocknum에 해당하는 DataBlock의 데이터를 읽어온다. (buffer cache를 거친다)
 	*/
-	assert(blocknum < NUM_DATA_BLOCKS);
-	char tempBuf[BLOCKSIZE];
-	lseek(DISK_FD, BLOCKSIZE*(5 + blocknum), SEEK_SET);
-	int ret = read(DISK_FD, tempBuf, BLOCKSIZE);
-	assert(ret == BLOCKSIZE);
-	memcpy(buf, tempBuf, BLOCKSIZE);
+	memcpy(buf, ssufs_getDataBlock(blocknum), SUPERBLOCK.block_size);
 }
 
 void ssufs_writeDataBlock(int blocknum, char *buf){
 	/*
 		blocknum에 해당하는 DataBlock에 buf 배열의 데이터를 작성한다.
+		buffer cache에만 기록하고, 디스크에는 buffer가 내보내지거나 flush될 때 기록된다.
+	*/
+	memcpy(ssufs_getDataBlockForWrite(blocknum, 1), buf, SUPERBLOCK.block_size);
+}
+
+void ssufs_flushDataBlock(int blocknum){
+	/*
+		blocknum에 해당하는 DataBlock이 buffer cache에서 변경되었으면 디스크에 기록한다.
+	*/
+	assert(blocknum < SUPERBLOCK.num_data_blocks);
+	ssufs_flushBuffer(dataBlockToDisk(blocknum), 0);
+}
+
+off_t ssufs_prepareDataBlocks(int blocknum, int count, int write){
+	/*
+		blocknum부터 연속된 DataBlock count개를 buffer cache를 거치지 않고 읽거나(write가 0) 덮어쓸 수 있게 하고, 디스크에서의 위치를 반환한다.
+		읽을 때는 buffer cache에서 변경된 블록을 먼저 디스크에 기록하고, 덮어쓸 때는 그 블록들의 buffer를 버린다.
+		읽을 때는 다른 thread가 고정해둔 buffer도 기록한다. 같은 inode를 읽는 다른 thread가 고정하고 있을 수 있는데,
+		건너뛰면 디스크의 예전 내용을 읽게 된다. (쓰는 thread는 inode lock을 배타적으로 잡으므로 그동안 buffer가 바뀌지 않는다)
+	*/
+	assert(blocknum >= 0 && blocknum + count <= SUPERBLOCK.num_data_blocks);
+	if (DISK_MAP == NULL) {
+		for (int i = 0; i < count; i++) {
+			if (write) {
+				ssufs_invalidateBuffer(dataBlockToDisk(blocknum + i));
+			} else {
+				ssufs_flushBuffer(dataBlockToDisk(blocknum + i), 1);
+			}
+		}
+	}
+	return (off_t)dataBlockToDisk(blocknum) * SUPERBLOCK.block_size;
+}
+
+void ssufs_readDataBlocks(int blocknum, int count, struct iovec *iov, int iovcnt){
+	/*
+		blocknum부터 연속된 DataBlock count개를 buffer cache를 거치지 않고 한번에 iov들로 읽어온다.
+		iov들의 길이의 합은 count개 블록의 크기와 같아야 한다. buffer cache에서 변경된 블록은 먼저 디스크에 기록한다.
+	*/
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_BLOCK_READ);
+	ssufs_diskReadv(ssufs_prepareDataBlocks(blocknum, count, 0), iov, iovcnt);
+	ssufs_statEnd(SSUFS_OP_BLOCK_READ, stat, (long)count * SUPERBLOCK.block_size, 0);
+}
+
+void ssufs_writeDataBlocks(int blocknum, int count, struct iovec *iov, int iovcnt){
+	/*
+		blocknum부터 연속된 DataBlock count개에 iov들의 내용을 buffer cache를 거치지 않고 한번에 기록한다.
+		덮어쓴 블록의 buffer는 cache에서 버린다.
+	*/
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_BLOCK_WRITE);
+	ssufs_diskWritev(ssufs_prepareDataBlocks(blocknum, count, 1), iov, iovcnt);
+	ssufs_statEnd(SSUFS_OP_BLOCK_WRITE, stat, (long)count * SUPERBLOCK.block_size, 0);
+}
+
+int ssufs_prefetchDataBlocks(int blocknum, int count){
+	/*
+		blocknum부터 연속된 DataBlock count개를 미리 읽어오도록 요청하고 기다리지 않고 반환한다. 요청한 블록 수를 반환한다.
+		pread 모드면 readahead thread가 buffer cache로 읽어오고, mmap 모드면 매핑된 구간을 커널이 미리 읽어두도록 알린다. (madvise)
+	*/
+	assert(blocknum >= 0 && blocknum + count <= SUPERBLOCK.num_data_blocks);
+	if (DISK_MAP != NULL) {
+		off_t start = (off_t)dataBlockToDisk(blocknum) * SUPERBLOCK.block_size;
+		off_t aligned = start & ~((off_t)sysconf(_SC_PAGESIZE) - 1); // madvise의 주소는 page 경계여야 한다
+		madvise(DISK_MAP + aligned, start - aligned + (off_t)count * SUPERBLOCK.block_size, MADV_WILLNEED);
+		COUNT_SYSCALL();
+		return count;
+	}
+	return ssufs_prefetchBuffers(dataBlockToDisk(blocknum), count);
+}
+
+int pointersPerBlock() { // indirect block 하나에 들어가는 블록 번호의 개수
+	return SUPERBLOCK.block_size / sizeof(int);
+}
+
+void initIndirectBlock(int blocknum) { // 새로 할당한 indirect block의 모든 블록 번호를 -1로 채우는 함수
+	memset(ssufs_getDataBlockForWrite(blocknum, 1), 0xff, SUPERBLOCK.block_size);
+}
+
+int getIndirectEntry(int *slot, int index, int alloc, int entry_is_indirect) {
+	/*
+		*slot이 가리키는 indirect block의 index번째 블록 번호를 반환한다.
+		alloc이 0이 아니면 indirect block이나 그 항목이 비어있을 때 새로 할당하며,
+		entry_is_indirect면 새로 할당한 항목도 indirect block으로 초기화한다. 블록이 없거나 할당에 실패하면 -1을 반환한다.
+		indirect block은 buffer cache(mmap 모드면 매핑)를 통해 읽으므로 순차 접근할 때 매번 디스크에서 읽지 않는다.
+	*/
+	if (*slot == -1) {
+		if (!alloc || (*slot = ssufs_allocDataBlock()) == -1)
+			return -1;
+		initIndirectBlock(*slot);
+	}
+
+	int blocknum = ((int *)ssufs_getDataBlock(*slot))[index];
+	if (blocknum == -1 && alloc) {
+		if ((blocknum = ssufs_allocDataBlock()) == -1)
+			return -1;
+		if (entry_is_indirect)
+			initIndirectBlock(blocknum);
+		((int *)ssufs_getDataBlockForWrite(*slot, 0))[index] = blocknum;
+	}
+	return blocknum;
+}
+
+int usesExtents() { // 현재 ssufs가 extent 매핑을 사용하는지
+	return SUPERBLOCK.flags & SSUFS_FLAG_EXTENTS;
+}
+
+#define EXTENT_GAP 8 // 새 extent를 찾을 때 마지막 extent 뒤로 최소한 띄울 블록 수
+
+int maxExtents() { // 파일 하나가 가질 수 있는 extent 수 (inode에 있는 것 + extent block 하나)
+	return NUM_INLINE_EXTENTS + SUPERBLOCK.block_size / sizeof(struct extent_t);
+}
+
+struct extent_t *getExtent(struct inode_t *inode, int i, int write) {
+	/*
+		inode의 i번째 extent의 주소를 반환한다. extent block에 있는 extent면 buffer cache(mmap 모드면 매핑)의 주소이므로
+		다음 디스크 함수 호출 전까지만 유효하다. write가 0이 아니면 extent block을 dirty로 표시한다.
+	*/
+	if (i < NUM_INLINE_EXTENTS)
+		return &inode->extents[i];
+	char *block = write ? ssufs_getDataBlockForWrite(inode->extent_block, 0) : ssufs_getDataBlock(inode->extent_block);
+	return (struct extent_t *)block + (i - NUM_INLINE_EXTENTS);
+}
+
+int extentBlocks(struct inode_t *inode) { // extent들이 가리키는 블록 수의 합
+	int nblocks = 0;
+	for (int i = 0; i < inode->num_extents; i++)
+		nblocks += getExtent(inode, i, 0)->length;
+	return nblocks;
+}
+
+int extentFind(struct inode_t *inode, int index, int *count) {
+	/*
+		파일의 index번째 블록이 저장된 data block 번호를 반환하고, *count에 그 블록부터 extent 끝까지 연속된 블록 수를 넣는다.
+	*/
+	for (int i = 0; i < inode->num_extents; i++) {
+		struct extent_t *extent = getExtent(inode, i, 0);
+		if (index < extent->length) {
+			*count = extent->length - index;
+			return extent->start + index;
+		}
+		index -= extent->length;
+	}
+	return -1;
+}
+
+int growExtents(struct inode_t *inode, int nblocks) {
+	/*
+		파일 끝에 data block nblocks개를 할당한다. 마지막 extent 바로 뒤의 블록들이 비어있으면 그 extent를 늘리고,
+		아니면 남은 블록 수만큼 연속으로 비어있는 구간(없으면 가장 긴 구간)을 찾아 새 extent로 붙인다.
+		새 extent는 마지막 extent 뒤로 지금까지의 파일 블록 수(최소 EXTENT_GAP)만큼 떨어진 곳부터 찾는다. 마지막 extent 뒤를
+		차지한 다른 파일이 계속 커질 자리를 남겨두어, 여러 파일에 번갈아 쓸 때 extent가 블록 몇 개씩 쪼개지지 않도록 한다.
+		공간이나 extent 자리가 부족하면 -1을 반환한다. 이미 할당한 블록은 ssufs_freeFileBlocks()로 정리한다.
 	*/
-	assert(blocknum < NUM_DATA_BLOCKS);
-	char tempBuf[BLOCKSIZE];
-	lseek(DISK_FD, BLOCKSIZE * (5 + blocknum), SEEK_SET);
-	memcpy(tempBuf, buf, BLOCKSIZE); 
-	int ret = write(DISK_FD, tempBuf, BLOCKSIZE);
-	assert(ret == BLOCKSIZE);
+	while (nblocks > 0) {
+		int start, length = 0;
+		int goal = __atomic_load_n(&DATABLOCK_HINT, __ATOMIC_RELAXED) * 64; // 새 extent를 찾기 시작할 위치
+
+		if (inode->num_extents > 0) {
+			struct extent_t *last = getExtent(inode, inode->num_extents - 1, 0);
+			start = last->start + last->length;
+			while (length < nblocks && start + length < SUPERBLOCK.num_data_blocks && !bitmapTest(DATABLOCK_BITMAP, start + length))
+				length++;
+			if (length > 0 && (length = bitmapClaimRange(DATABLOCK_BITMAP, start, length)) > 0) {
+				__atomic_fetch_sub(&FREE_DATA_BLOCKS, length, __ATOMIC_RELAXED);
+				getExtent(inode, inode->num_extents - 1, 1)->length += length;
+				nblocks -= length;
+				continue;
+			}
+		}
+
+		if (inode->num_extents > 0) {
+			int gap = extentBlocks(inode);
+			struct extent_t *last = getExtent(inode, inode->num_extents - 1, 0);
+			goal = last->start + last->length + (gap > EXTENT_GAP ? gap : EXTENT_GAP);
+		}
+
+		// 새 extent가 들어갈 자리를 먼저 마련한다 (extent block도 data block에서 할당된다)
+		if (inode->num_extents == maxExtents())
+			return -1;
+		if (inode->num_extents == NUM_INLINE_EXTENTS && inode->extent_block == -1) {
+			if ((inode->extent_block = ssufs_allocDataBlock()) == -1)
+				return -1;
+			ssufs_getDataBlockForWrite(inode->extent_block, 1);
+		}
+
+		start = goal < SUPERBLOCK.num_data_blocks ? bitmapFindRun(DATABLOCK_BITMAP, SUPERBLOCK.num_data_blocks, goal, nblocks, &length) : -1;
+		if (start == -1 || length < nblocks) { // goal 뒤에 충분한 구간이 없으면 처음부터 다시 찾는다
+			int first_length;
+			int first = bitmapFindRun(DATABLOCK_BITMAP, SUPERBLOCK.num_data_blocks, __atomic_load_n(&DATABLOCK_HINT, __ATOMIC_RELAXED) * 64, nblocks, &first_length);
+			if (first_length > length || start == -1) {
+				start = first;
+				length = first_length;
+			}
+		}
+		if (start == -1)
+			return -1;
+		if ((length = bitmapClaimRange(DATABLOCK_BITMAP, start, length)) == 0) // 다른 thread가 먼저 가져갔으면 다시 찾는다
+			continue;
+		__atomic_fetch_sub(&FREE_DATA_BLOCKS, length, __ATOMIC_RELAXED);
+		struct extent_t *extent = getExtent(inode, inode->num_extents, 1);
+		extent->start = start;
+		extent->length = length;
+		inode->num_extents++;
+		nblocks -= length;
+	}
+	return 0;
+}
+
+void freeExtentsFrom(struct inode_t *inode, int first) {
+	/*
+		extent 매핑 파일의 first번째 블록부터 끝까지를 해제한다. extent가 inode에 모두 들어가게 되면 extent block도 해제한다.
+	*/
+	int base = 0; // 지금 보고있는 extent의 첫 블록이 파일에서 몇번째 블록인지
+	int kept = 0; // 남는 extent 수
+
+	for (int i = 0; i < inode->num_extents; i++) {
+		struct extent_t extent = *getExtent(inode, i, 0);
+		int keep = first - base > 0 ? first - base : 0; // 이 extent에서 남길 블록 수
+
+		base += extent.length;
+		if (keep >= extent.length) {
+			kept = i + 1;
+			continue;
+		}
+		for (int j = keep; j < extent.length; j++)
+			ssufs_freeDataBlock(extent.start + j);
+		if (keep > 0) {
+			getExtent(inode, i, 1)->length = keep;
+			kept = i + 1;
+		}
+	}
+	inode->num_extents = kept;
+
+	if (kept <= NUM_INLINE_EXTENTS && inode->extent_block != -1) {
+		ssufs_freeDataBlock(inode->extent_block);
+		inode->extent_block = -1;
+	}
+}
+
+int ssufs_allocFileBlocks(struct inode_t *inode, int first, int nblocks){
+	/*
+		파일의 first번째부터 nblocks-1번째 블록까지 비어있는 블록을 할당한다. (first 앞의 블록들은 할당되어 있어야 한다)
+		할당에 실패하면 -1을 반환한다. (파일은 끝에서만 커지므로 새로 할당되는 블록은 항상 파일 끝에 붙는다)
+	*/
+	if (usesExtents()) {
+		int allocated = extentBlocks(inode);
+		return nblocks > allocated ? growExtents(inode, nblocks - allocated) : 0;
+	}
+	for (int i = first; i < nblocks; i++) {
+		if (ssufs_bmap(inode, i, 1) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+int ssufs_bmapRun(struct inode_t *inode, int index, int max, int *count){
+	/*
+		ssufs_bmap(inode, index, 0)과 같고, *count에 그 블록부터 디스크에서도 연속해서 놓인 파일 블록 수(max 이하)를 넣는다.
+		extent 매핑이면 extent에서 바로 구하고, 블록 매핑이면 다음 블록들의 번호가 1씩 늘어나는 동안 센다.
+	*/
+	int blocknum;
+
+	if (usesExtents()) {
+		blocknum = extentFind(inode, index, count);
+	} else {
+		blocknum = ssufs_bmap(inode, index, 0);
+		*count = 1;
+		while (blocknum != -1 && *count < max && ssufs_bmap(inode, index + *count, 0) == blocknum + *count)
+			(*count)++;
+	}
+	if (*count > max)
+		*count = max > 0 ? max : 1;
+	return blocknum;
+}
+
+int ssufs_bmap(struct inode_t *inode, int index, int alloc){
+	/*
+		파일의 index번째 블록이 저장된 data block 번호를 반환한다. (direct -> indirect -> double indirect 순서)
+		alloc이 0이 아니면 비어있는 블록(과 필요한 indirect block)을 새로 할당한다.
+		블록이 없거나 할당에 실패하면 -1을 반환한다. 할당에 실패했을 때 이미 할당된 블록은 ssufs_freeFileBlocks()로 정리한다.
+	*/
+	int per_block = pointersPerBlock();
+
+	if (usesExtents()) {
+		int count;
+		if (alloc && ssufs_allocFileBlocks(inode, index, index + 1) == -1)
+			return -1;
+		return extentFind(inode, index, &count);
+	}
+
+	if (index < NUM_DIRECT_BLOCKS) {
+		if (inode->direct_blocks[index] == -1 && alloc)
+			inode->direct_blocks[index] = ssufs_allocDataBlock();
+		return inode->direct_blocks[index];
+	}
+	index -= NUM_DIRECT_BLOCKS;
+
+	if (index < per_block)
+		return getIndirectEntry(&inode->indirect_block, index, alloc, 0);
+	index -= per_block;
+
+	if (index < per_block * per_block) {
+		int child = getIndirectEntry(&inode->double_indirect_block, index / per_block, alloc, 1);
+		if (child == -1)
+			return -1;
+		return getIndirectEntry(&child, index % per_block, alloc, 0);
+	}
+	return -1;
+}
+
+int freeIndirectFrom(int blocknum, int first) {
+	/*
+		indirect block이 가리키는 블록 중 first번째부터를 해제한다. first가 0 이하이면 indirect block 자체도 해제하고 1을 반환한다.
+	*/
+	int per_block = pointersPerBlock();
+	int *entries = (int *)ssufs_getDataBlockForWrite(blocknum, 0);
+
+	for (int i = first > 0 ? first : 0; i < per_block; i++) {
+		if (entries[i] != -1) {
+			ssufs_freeDataBlock(entries[i]);
+			entries[i] = -1;
+		}
+	}
+	if (first <= 0) {
+		ssufs_freeDataBlock(blocknum);
+		return 1;
+	}
+	return 0;
+}
+
+void ssufs_freeFileBlocks(struct inode_t *inode, int first){
+	/*
+		파일의 first번째 블록부터 끝까지의 data block을 해제한다. 비게 되는 indirect block도 함께 해제한다.
+	*/
+	int per_block = pointersPerBlock();
+
+	if (usesExtents()) {
+		freeExtentsFrom(inode, first);
+		return;
+	}
+
+	for (int i = first; i < NUM_DIRECT_BLOCKS; i++) {
+		if (inode->direct_blocks[i] != -1) {
+			ssufs_freeDataBlock(inode->direct_blocks[i]);
+			inode->direct_blocks[i] = -1;
+		}
+	}
+
+	if (inode->indirect_block != -1 && freeIndirectFrom(inode->indirect_block, first - NUM_DIRECT_BLOCKS)) {
+		inode->indirect_block = -1;
+	}
+
+	if (inode->double_indirect_block != -1) {
+		int base = NUM_DIRECT_BLOCKS + per_block; // double indirect가 가리키는 첫 블록의 index
+		for (int j = 0; j < per_block; j++) {
+			// 하위 indirect block을 처리하는 동안 buffer가 바뀔 수 있으므로 매번 다시 읽는다
+			int child = ((int *)ssufs_getDataBlock(inode->double_indirect_block))[j];
+			if (child == -1 || first >= base + (j + 1) * per_block)
+				continue;
+			if (freeIndirectFrom(child, first - (base + j * per_block)) && first > base) {
+				((int *)ssufs_getDataBlockForWrite(inode->double_indirect_block, 0))[j] = -1;
+			}
+		}
+		if (first <= base) {
+			ssufs_freeDataBlock(inode->double_indirect_block);
+			inode->double_indirect_block = -1;
+		}
+	}
+}
+
+int metadataBlocks(struct inode_t *inode, int first, int nblocks) {
+	/*
+		파일의 first번째부터 nblocks-1번째 블록까지 새로 할당할 때 함께 할당해야 할 수 있는 indirect block(extent block) 수
+		(first 앞의 블록들은 할당되어 있어야 한다)
+	*/
+	int per_block = pointersPerBlock();
+	int base = NUM_DIRECT_BLOCKS + per_block; // double indirect가 가리키는 첫 블록의 index
+	int count = 0;
+
+	if (first >= nblocks)
+		return 0;
+	if (usesExtents())
+		return inode->extent_block == -1 ? 1 : 0;
+	if (nblocks > NUM_DIRECT_BLOCKS && first < base && inode->indirect_block == -1)
+		count++;
+	if (nblocks > base) {
+		if (inode->double_indirect_block == -1)
+			count++;
+		// 첫 블록이 first 뒤에 있는 하위 indirect block들은 아직 없다
+		int first_child = first > base ? (first - base + per_block - 1) / per_block : 0;
+		int last_child = (nblocks - 1 - base) / per_block;
+		if (last_child >= first_child)
+			count += last_child - first_child + 1;
+	}
+	return count;
+}
+
+int ssufs_allocatedBlocks(int inodenum){
+	/*
+		파일 앞에서부터 data block이 할당되어 있는 블록 수 (그 뒤는 delayed 블록이다)
+	*/
+	struct inode_cache_t *entry = &INODE_CACHE[inodenum];
+
+	if (ssufs_isInline(&entry->inode))
+		return 0;
+	if (entry->delayed_count > 0)
+		return entry->delayed_start;
+	return (entry->inode.file_size + SUPERBLOCK.block_size - 1) / SUPERBLOCK.block_size;
+}
+
+char *ssufs_getDelayedBlock(int inodenum, int index){
+	/*
+		파일의 index번째 블록이 delayed 블록이면 그 내용이 있는 메모리의 주소를, 아니면 NULL을 반환한다.
+	*/
+	struct inode_cache_t *entry = &INODE_CACHE[inodenum];
+
+	if (index < entry->delayed_start || index >= entry->delayed_start + entry->delayed_count)
+		return NULL;
+	return entry->delayed[index - entry->delayed_start];
+}
+
+int ssufs_growFile(int inodenum, int nblocks){
+	/*
+		파일이 앞에서부터 nblocks개의 블록을 갖도록 한다. (inode의 write lock을 잡은 상태에서 부른다)
+		delayed allocation을 쓰면 새 블록들은 0으로 채운 메모리에만 만들고, 기록할 때 쓸 data block 수만 예약해둔다.
+		아니면 바로 data block을 할당한다. 공간이 모자라면 아무것도 바꾸지 않고 -1을 반환한다.
+	*/
+	struct inode_cache_t *entry = &INODE_CACHE[inodenum];
+	struct inode_t *inode = &entry->inode;
+	int have = (inode->file_size + SUPERBLOCK.block_size - 1) / SUPERBLOCK.block_size; // delayed 블록을 포함한 블록 수
+
+	if (nblocks <= have)
+		return 0;
+	// 빈 공간이 쪼개져 있으면 기록할 때 delayed 블록마다 새 extent가 하나씩 필요할 수 있다. 이미 성공을 반환한 쓰기가
+	// 기록 단계에서 실패하지 않도록 남은 extent 자리보다 많은 블록은 delayed로 두지 않는다.
+	// 넘치면 지금까지의 delayed 블록을 먼저 기록하고, 그래도 넘치면 바로 할당해서 실패를 지금 반환한다
+	int direct = !DELAYED_ACTIVE;
+	if (!direct && usesExtents()) {
+		int pending = nblocks - (entry->delayed_count > 0 ? entry->delayed_start : have);
+		if (pending > maxExtents() - inode->num_extents && entry->delayed_count > 0) {
+			if (ssufs_flushDelayed(inodenum) == -1)
+				return -1;
+			pending = nblocks - have;
+		}
+		direct = pending > maxExtents() - inode->num_extents;
+	}
+	if (direct && ssufs_flushDelayed(inodenum) == -1)
+		return -1;
+	if (direct) {
+		if (ssufs_allocFileBlocks(inode, have, nblocks) == -1) {
+			ssufs_freeFileBlocks(inode, have); // 앞서 새로 할당했던 블록들을 반환하여 쓰기 전 상태로 되돌린다
+			return -1;
+		}
+		return 0;
+	}
+
+	// 메모리에 모아둔 블록이 너무 많으면 이 파일의 delayed 블록부터 기록한다 (다른 파일들은 flusher thread가 기록한다)
+	int limit = DIRTY_LIMIT / SUPERBLOCK.block_size;
+	int total = __atomic_load_n(&DELAYED_BLOCKS, __ATOMIC_RELAXED) + nblocks - have;
+	if (total > limit && entry->delayed_count > 0) {
+		ssufs_flushDelayed(inodenum);
+	}
+
+	int start = entry->delayed_count > 0 ? entry->delayed_start : have;
+	int reserve = nblocks - start + metadataBlocks(inode, start, nblocks);
+	if (reserveBlocks(reserve - entry->reserved) == -1)
+		return -1;
+	entry->reserved = reserve;
+
+	if (nblocks - start > entry->delayed_capacity) {
+		int capacity = entry->delayed_capacity > 0 ? entry->delayed_capacity : 16;
+		while (capacity < nblocks - start)
+			capacity *= 2;
+		entry->delayed = (char **)realloc(entry->delayed, capacity * sizeof(char *));
+		assert(entry->delayed != NULL);
+		entry->delayed_capacity = capacity;
+	}
+	for (int i = have; i < nblocks; i++) {
+		entry->delayed[i - start] = (char *)calloc(1, SUPERBLOCK.block_size); // 새 블록은 0으로 채워져 있다
+		assert(entry->delayed[i - start] != NULL);
+	}
+	entry->delayed_start = start;
+	__atomic_store_n(&entry->delayed_count, nblocks - start, __ATOMIC_RELAXED);
+	total = __atomic_add_fetch(&DELAYED_BLOCKS, nblocks - have, __ATOMIC_RELAXED);
+
+	if (!__atomic_load_n(&FLUSHER_STARTED, __ATOMIC_ACQUIRE) || (total > limit / 2 && !__atomic_exchange_n(&FLUSH_WANTED, 1, __ATOMIC_ACQ_REL))) {
+		pthread_mutex_lock(&FLUSH_LOCK);
+		if (!FLUSHER_STARTED) {
+			pthread_t thread;
+			int ret = pthread_create(&thread, NULL, flusherThread, NULL);
+			assert(ret == 0);
+			pthread_detach(thread);
+			__atomic_store_n(&FLUSHER_STARTED, 1, __ATOMIC_RELEASE);
+		}
+		pthread_cond_signal(&FLUSH_COND);
+		pthread_mutex_unlock(&FLUSH_LOCK);
+	}
+	return 0;
+}
+
+int ssufs_isInline(struct inode_t *inode){
+	/*
+		파일의 내용이 data block 대신 inode의 inline_data에 들어있는지 확인한다.
+		SSUFS_FLAG_INLINE이면 INLINE_DATA_SIZE 이하인 파일은 항상 inline이다. (파일은 끝에서만 커지므로 한번 옮겨진 파일은 다시 작아지지 않는다)
+	*/
+	return (SUPERBLOCK.flags & SSUFS_FLAG_INLINE) && inode->file_size <= INLINE_DATA_SIZE;
+}
+
+int ssufs_moveInlineData(int inodenum, int nblocks){
+	/*
+		inline 파일이 앞에서부터 nblocks개의 블록을 갖도록 블록을 만들고 inline_data의 내용을 첫 블록으로 옮긴다.
+		(inode의 write lock을 잡은 상태에서 부른다) 블록은 ssufs_growFile()로 만드므로 delayed allocation을 쓰면 메모리에만 옮겨진다.
+		공간이 모자라면 inline 상태 그대로 두고 -1을 반환한다.
+	*/
+	struct inode_t *inode = &INODE_CACHE[inodenum].inode;
+	char data[INLINE_DATA_SIZE];
+	int size = inode->file_size;
+
+	memcpy(data, inode->inline_data, size);
+	inode->file_size = 0; // 블록이 하나도 없는 파일로 만든 뒤 늘린다
+	initMapping(inode);
+	if (ssufs_growFile(inodenum, nblocks) == -1) {
+		memcpy(inode->inline_data, data, size);
+		inode->file_size = size;
+		return -1;
+	}
+	if (size > 0) {
+		char *block = ssufs_getDelayedBlock(inodenum, 0);
+		if (block == NULL)
+			block = ssufs_getDataBlockForWrite(ssufs_bmap(inode, 0, 0), 1);
+		memcpy(block, data, size);
+	}
+	inode->file_size = size;
+	return 0;
+}
+
+int ssufs_flushDelayed(int inodenum){
+	/*
+		파일의 delayed 블록들에 data block을 한꺼번에 할당하고, 디스크에서 연속된 구간마다 pwritev 한번으로 기록한다.
+		(inode의 write lock을 잡은 상태에서 부른다) ssufs_growFile()이 delayed 블록 수를 남은 extent 자리 수로 제한하므로
+		할당은 실패하지 않지만, 실패하면 할당된 앞부분만 기록하고 나머지는 delayed 블록으로 남겨둔 채 -1을 반환한다.
+	*/
+	struct inode_cache_t *entry = &INODE_CACHE[inodenum];
+	struct inode_t *inode = &entry->inode;
+	int start = entry->delayed_start, count = entry->delayed_count;
+	int done = count; // 할당된 delayed 블록 수
+	int ret = 0;
+
+	if (count == 0)
+		return 0;
+	if (ssufs_allocFileBlocks(inode, start, start + count) == -1) {
+		done = 0;
+		while (done < count && ssufs_bmap(inode, start + done, 0) != -1)
+			done++;
+		ssufs_freeFileBlocks(inode, start + done); // 할당하다 만 블록(indirect block 포함)을 정리한다
+		ret = -1;
+	}
+
+	struct iovec *iov = (struct iovec *)malloc(count * sizeof(struct iovec));
+	for (int i = 0; i < done; ) {
+		int run;
+		int blocknum = ssufs_bmapRun(inode, start + i, done - i, &run);
+		for (int j = 0; j < run; j++) {
+			iov[j].iov_base = entry->delayed[i + j];
+			iov[j].iov_len = SUPERBLOCK.block_size;
+		}
+		ssufs_writeDataBlocks(blocknum, run, iov, run);
+		i += run;
+	}
+	free(iov);
+	if (done == count) {
+		discardDelayed(entry); // 기록했으므로 메모리와 예약을 돌려준다
+	} else if (done > 0) { // 기록한 블록들만 빼고 남은 블록의 예약을 다시 계산한다
+		for (int i = 0; i < done; i++)
+			free(entry->delayed[i]);
+		memmove(entry->delayed, entry->delayed + done, (count - done) * sizeof(char *));
+		__atomic_fetch_sub(&DELAYED_BLOCKS, done, __ATOMIC_RELAXED);
+		entry->delayed_start = start + done;
+		__atomic_store_n(&entry->delayed_count, count - done, __ATOMIC_RELAXED);
+		int reserve = count - done + metadataBlocks(inode, start + done, start + count);
+		reserveBlocks(reserve - entry->reserved); // 줄어들기만 하므로 실패하지 않는다
+		entry->reserved = reserve;
+	}
+	if (done > 0)
+		ssufs_markInodeDirty(inodenum); // 블록 매핑이 바뀌었다
+	return ret;
+}
+
+void ssufs_flushFile(struct inode_t *inode){
+	/*
+		파일의 data block과 indirect block 중 buffer cache에서 변경된 것들을 디스크에 기록한다.
+	*/
+	int nblocks = (inode->file_size + SUPERBLOCK.block_size - 1) / SUPERBLOCK.block_size;
+
+	if (DISK_MAP != NULL || ssufs_isInline(inode)) // mmap 모드는 buffer cache를 쓰지 않는다 (inline 파일은 data block이 없다)
+		return;
+	if (usesExtents()) {
+		for (int i = 0; i < inode->num_extents; i++) {
+			struct extent_t extent = *getExtent(inode, i, 0);
+			for (int j = 0; j < extent.length; j++)
+				ssufs_flushDataBlock(extent.start + j);
+		}
+		if (inode->extent_block != -1)
+			ssufs_flushDataBlock(inode->extent_block);
+		return;
+	}
+	for (int i = 0; i < nblocks; i++) {
+		int blocknum = ssufs_bmap(inode, i, 0);
+		if (blocknum != -1)
+			ssufs_flushDataBlock(blocknum);
+	}
+	if (inode->indirect_block != -1)
+		ssufs_flushDataBlock(inode->indirect_block);
+	if (inode->double_indirect_block != -1) {
+		for (int j = 0; j < pointersPerBlock(); j++) {
+			int child = ((int *)ssufs_getDataBlock(inode->double_indirect_block))[j];
+			if (child != -1)
+				ssufs_flushDataBlock(child);
+		}
+		ssufs_flushDataBlock(inode->double_indirect_block);
+	}
+}
+
+int ssufs_maxFileSize(){
+	/*
+		현재 geometry에서 파일 하나가 가질 수 있는 최대 크기(바이트)를 반환한다.
+		extent 매핑이면 extent 수가 아니라 data block 수가 한계이다. (extent가 모자라면 write가 실패할 수 있다)
+	*/
+	long per_block = pointersPerBlock();
+	long bytes = (NUM_DIRECT_BLOCKS + per_block + per_block * per_block) * SUPERBLOCK.block_size;
+	if (usesExtents())
+		bytes = (long)SUPERBLOCK.num_data_blocks * SUPERBLOCK.block_size;
+	return bytes > INT_MAX ? INT_MAX : (int)bytes;
 }
 
 void ssufs_dump(){
 	/*
-		현재 ssufs의 상태를 출력한다.
+		현재 ssufs의 상태를 출력한다. delayed 블록들은 먼저 할당해서 기록하므로 디스크에 기록될 모습대로 보인다.
 	*/
+	pthread_mutex_lock(&SYNC_LOCK);
+	flushAllDelayed();
+	pthread_mutex_unlock(&SYNC_LOCK);
 
 	printf("<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<DISK STATE>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>\n");
-	struct superblock_t *superblock = (struct superblock_t *)malloc(sizeof(struct superblock_t));
-	ssufs_readSuperBlock(superblock);
+	struct superblock_t *superblock = &SUPERBLOCK;
 	char buf[MAX_NAME_STRLEN + 1];
 	buf[MAX_NAME_STRLEN] = '\0';
 	memcpy(buf, superblock->name, sizeof(buf) - 1);
 	printf("DISK NAME: %s\nINODE FREELIST:      ", buf);
-	for(int i=0; i<NUM_INODES; i++)
-		printf("%c ", superblock->inode_freelist[i]);
+	for(int i=0; i<superblock->num_inodes; i++)
+		printf("%c ", bitmapTest(INODE_BITMAP, i) ? INODE_IN_USE : INODE_FREE);
 	printf("\nDATA BLOCK FREELIST: ");
-	for(int i=0; i<NUM_DATA_BLOCKS; i++)
-		printf("%c ", superblock->datablock_freelist[i]);
+	for(int i=0; i<superblock->num_data_blocks; i++)
+		printf("%c ", bitmapTest(DATABLOCK_BITMAP, i) ? DATA_BLOCK_USED : DATA_BLOCK_FREE);
 	printf("\n");
 
 	struct inode_t *inode = (struct inode_t *)malloc(sizeof(struct inode_t));
-	for(int i=0; i<NUM_INODES; i++){
+	char *tempBuf = (char *)malloc(superblock->block_size + 1);
+	tempBuf[superblock->block_size] = '\0';
+	for(int i=0; i<superblock->num_inodes; i++){
 		ssufs_readInode(i, inode);
+		if(inode->status == INODE_DIR){
+			printf("INODE %d\nSTATUS:\t%c\tNAME\t%.*s\t", i, inode->status, MAX_NAME_STRLEN, inode->name);
+			if (inode->parent != SSUFS_ROOT_DIR)
+				printf("PARENT\t%d\t", inode->parent);
+			printf("ENTRIES\t%d\n\n", DENTRIES[i].entries);
+		}
 		if(inode->status == INODE_IN_USE){
-			printf("INODE %d\nSTATUS:\t%c\tNAME\t%s\tSIZE\t%d\tDATABLOCK\t", i, inode->status, inode->name, inode->file_size);
-			for (int j = 0; j < MAX_FILE_SIZE; j++)
-				printf("%d ", inode->direct_blocks[j]);
-			printf("\n");
-			for (int j = 0; j < MAX_FILE_SIZE; j++){
-				if (inode->direct_blocks[j] != -1 ){
-					char tempBuf[BLOCKSIZE+1];
-					tempBuf[BLOCKSIZE] = '\0';
-					ssufs_readDataBlock(inode->direct_blocks[j], tempBuf);
+			printf("INODE %d\nSTATUS:\t%c\tNAME\t%.*s\tSIZE\t%d\t", i, inode->status, MAX_NAME_STRLEN, inode->name, inode->file_size);
+			if (inode->parent != SSUFS_ROOT_DIR)
+				printf("PARENT\t%d\t", inode->parent);
+			int first = NUM_DIRECT_BLOCKS; // 아래에서 bmap으로 찾아 출력할 첫 블록
+			if (ssufs_isInline(inode)) {
+				printf("INLINE\n");
+				if (inode->file_size > 0)
+					printf("INLINE DATA: %.*s\n", inode->file_size, inode->inline_data);
+				first = INT_MAX;
+			} else if (usesExtents()) {
+				printf("EXTENTS\t");
+				for (int j = 0; j < inode->num_extents; j++) {
+					struct extent_t *extent = getExtent(inode, j, 0);
+					printf("%d+%d ", extent->start, extent->length);
+				}
+				printf("\n");
+				first = 0;
+			} else {
+				printf("DATABLOCK\t");
+				for (int j = 0; j < NUM_DIRECT_BLOCKS; j++)
+					printf("%d ", inode->direct_blocks[j]);
+				if (inode->indirect_block != -1 || inode->double_indirect_block != -1)
+					printf("INDIRECT %d DOUBLE INDIRECT %d ", inode->indirect_block, inode->double_indirect_block);
+				printf("\n");
+				for (int j = 0; j < NUM_DIRECT_BLOCKS; j++){
+					if (inode->direct_blocks[j] != -1 ){
+						ssufs_readDataBlock(inode->direct_blocks[j], tempBuf);
+						printf("DATA BLOCK %d: %s\n", j, tempBuf);
+					}
+				}
+			}
+			int nblocks = (inode->file_size + superblock->block_size - 1) / superblock->block_size;
+			for (int j = first; j < nblocks; j++){
+				int blocknum = ssufs_bmap(inode, j, 0);
+				if (blocknum != -1){
+					ssufs_readDataBlock(blocknum, tempBuf);
 					printf("DATA BLOCK %d: %s\n", j, tempBuf);
 				}
 			}
@@ -253,6 +1779,9 @@ void ssufs_dump(){
 		}
 	}
 	free(inode);
-	free(superblock);
+	free(tempBuf);
+	if (DUMP_STATS) { // ssufs_setDumpStats(1)로 켰을 때만 연산별 통계를 함께 출력한다
+		ssufs_printStats(stdout);
+	}
 	printf("<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>\n");
 }
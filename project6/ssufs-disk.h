@@ -1,3 +1,6 @@
+#ifndef SSUFS_DISK_H
+#define SSUFS_DISK_H
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
@@ -6,53 +9,191 @@
 #include <string.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <assert.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#include "ssufs-stats.h"
 
-#define BLOCKSIZE 64
-#define NUM_BLOCKS 35
-#define NUM_DATA_BLOCKS 30
-#define NUM_INODE_BLOCKS 4
+#define BLOCKSIZE 64 // ssufs_formatDisk()가 사용하는 기본 geometry (실제 값은 superblock에 기록된다)
+#define NUM_BLOCKS 37
 #define NUM_INODES 8
-#define NUM_INODES_PER_BLOCK 2
-#define MAX_FILE_SIZE 4
+#define DEFAULT_DISK_PATH "ssufs" // ssufs 파일의 기본 경로
+#define NUM_DIRECT_BLOCKS 4 // inode에 바로 들어있는 블록 번호의 개수
+#define MAX_FILE_SIZE NUM_DIRECT_BLOCKS // 예전 이름 (direct block만으로 저장할 수 있는 블록 수)
 #define MAX_FILES 8
-#define MAX_OPEN_FILES 20
-#define MAX_NAME_STRLEN 8
+#define HANDLE_INDEX_BITS 20 // file handle 번호에서 slot 번호가 차지하는 bit 수 (그 위의 bit들은 slot의 generation)
+#define MAX_OPEN_FILES (1 << HANDLE_INDEX_BITS) // 동시에 열어둘 수 있는 file handle 수
+#define HANDLE_GENERATIONS (1 << (31 - HANDLE_INDEX_BITS)) // handle 번호에 들어가는 generation의 개수 (handle 번호가 음수가 되지 않도록)
+#define HANDLE_CHUNK 1024 // handle table을 늘릴 때 한번에 만드는 slot 수
+#define MAX_NAME_STRLEN 8 // 경로를 이루는 이름 하나의 최대 길이
+#define MAX_PATH_STRLEN 128 // 경로 캐시에 넣을 수 있는 경로의 최대 길이
+#define DEFAULT_PATH_CACHE_SIZE 64 // 기본 경로 캐시 항목 수
+#define RA_MIN_BLOCKS 4 // 순차 읽기를 알아챘을 때 처음 미리 읽는 블록 수
+#define DEFAULT_DIRTY_LIMIT (16 << 20) // delayed 블록으로 메모리에 모아둘 데이터의 기본 최대 크기 (바이트)
+#define FLUSH_INTERVAL_MS 1000 // flusher thread가 delayed 블록들을 기록하는 주기
+#define RA_MAX_BLOCKS 64 // 미리 읽는 window의 기본 최대 블록 수 (buffer cache 크기의 1/4을 넘지는 않는다)
+#define SSUFS_ROOT_DIR -2 // 루트 디렉토리의 번호 (루트는 inode 없이 메모리에만 있다)
 #define INODE_FREE 'x'
 #define INODE_IN_USE '1'
+#define INODE_DIR 'd' // 디렉토리
 #define DATA_BLOCK_FREE 'x'
 #define DATA_BLOCK_USED '1'
+#define BITMAP_WORDS(nbits) (((nbits) + 63) / 64) // nbits개의 비트를 담는데 필요한 64비트 word 수
+#ifndef IOV_MAX
+#define IOV_MAX 1024 // preadv/pwritev 한번에 넘길 수 있는 iovec 수
+#endif
+#define COUNT_SYSCALL() __atomic_fetch_add(&SSUFS_SYSCALLS, 1, __ATOMIC_RELAXED) // SSUFS_SYSCALLS를 하나 증가시킨다 (여러 thread에서 불러도 된다)
+#define SSUFS_MODE_PREAD 0
+#define SSUFS_MODE_MMAP 1
+#define SSUFS_FLAG_EXTENTS 1 // format 옵션: inode가 블록 번호 대신 extent(연속된 블록 구간)로 data block을 가리킨다
+#define NUM_INLINE_EXTENTS 2 // inode에 바로 들어있는 extent의 개수
+#define SSUFS_FLAG_INLINE 2 // format 옵션: INLINE_DATA_SIZE 이하의 작은 파일은 data block 대신 inode의 블록 매핑 자리에 내용을 저장한다
+#define INLINE_DATA_SIZE ((NUM_DIRECT_BLOCKS + 2) * 4) // inode에 저장할 수 있는 파일 크기 (블록 매핑 자리의 크기)
 
+// block 0부터 superblock, inode bitmap, data block bitmap이 차례로 기록되고 그 뒤에 inode 블록들, data block들이 온다
 struct superblock_t
 {
 	char name[MAX_NAME_STRLEN];
-	char inode_freelist[NUM_INODES];
-	char datablock_freelist[NUM_DATA_BLOCKS];
+	int block_size;
+	int num_blocks; // 디스크 전체의 블록 수
+	int num_inodes;
+	int num_data_blocks;
+	int inode_start; // 첫 inode 블록 번호
+	int data_start; // 첫 data block의 블록 번호
+	int flags; // format 때 정한 옵션 (SSUFS_FLAG_*)
+};
+
+struct extent_t
+{
+	int start; // 첫 data block 번호
+	int length; // 연속된 블록 수
 };
 
 struct inode_t
 {
 	int status;
 	char name[MAX_NAME_STRLEN];
+	int parent; // 이 파일이 들어있는 디렉토리의 inode 번호 (SSUFS_ROOT_DIR이면 루트)
 	int file_size;
-	int direct_blocks[MAX_FILE_SIZE];
+	union {
+		struct { // 블록 매핑 (기본)
+			int direct_blocks[NUM_DIRECT_BLOCKS];
+			int indirect_block; // 블록 번호들을 담은 블록 (-1이면 없음)
+			int double_indirect_block; // indirect block 번호들을 담은 블록 (-1이면 없음)
+		};
+		struct { // extent 매핑 (SSUFS_FLAG_EXTENTS)
+			struct extent_t extents[NUM_INLINE_EXTENTS]; // 파일 앞쪽부터 순서대로
+			int extent_block; // 나머지 extent들을 담은 블록 (-1이면 없음)
+			int num_extents;
+		};
+		char inline_data[INLINE_DATA_SIZE]; // 작은 파일의 내용 (SSUFS_FLAG_INLINE이고 file_size가 INLINE_DATA_SIZE 이하일 때)
+	};
+};
+
+struct inode_cache_t
+{
+	int refcount; // 이 inode를 사용중인 곳의 수 (0이면 cache에 없음)
+	int dirty; // 디스크에 기록되지 않은 변경이 있는지
+	pthread_rwlock_t lock; // inode 내용(파일 크기, 블록 매핑)과 파일의 data block을 보호한다
+	struct inode_t inode;
+	char **delayed; // 파일 끝에서 아직 data block을 할당하지 않은 블록들의 내용 (delayed allocation, flush할 때 할당해서 기록한다)
+	int delayed_start; // delayed[0]의 파일 블록 index (이 앞의 블록들은 할당되어 있다)
+	int delayed_count;
+	int delayed_capacity; // delayed 배열의 크기
+	int reserved; // delayed 블록들을 기록할 때 쓸 data block 수 (indirect block 포함, 미리 예약해둔다)
+};
+
+struct dentry_t // 이름 해시 테이블의 항목, 사용중인 inode마다 하나씩 있다 (inode 번호로 접근)
+{
+	char name[MAX_NAME_STRLEN + 1]; // inode의 이름과 달리 항상 '\0'으로 끝난다
+	int parent;
+	int next; // 같은 버킷에 있는 다음 inode 번호 (-1이면 끝)
+	int is_dir;
+	int entries; // 디렉토리면 그 안에 있는 파일과 디렉토리 수
+};
+
+struct path_cache_t // 최근에 찾은 디렉토리 경로 (경로 문자열의 해시값으로 접근)
+{
+	char path[MAX_PATH_STRLEN + 1];
+	int inodenum;
+	unsigned generation; // PATH_GENERATION과 다르면 무효
 };
 
 struct filehandle_t
 {
 	int offset;
 	int inode_number;
+	int ra_next; // 순차 읽기라면 다음 읽기가 시작할 위치 (마지막 읽기가 끝난 위치)
+	int ra_window; // 다음에 미리 읽을 블록 수 (0이면 순차 읽기가 아니다)
+	int ra_end; // 미리 읽기를 요청한 마지막 블록의 다음 블록 index
+	unsigned generation; // slot을 반납할 때마다 증가한다 (handle 번호에 들어있는 값과 다르면 이미 닫힌 handle이다)
+	int next_free; // 비어있는 slot이면 free list에서 다음 slot 번호 (-1이면 끝)
 };
 
+extern struct superblock_t SUPERBLOCK;
+extern long SSUFS_SYSCALLS;
+
 int open_namei(char *filename);
+int ssufs_lookup(int dir, char *name);
+int ssufs_resolvePath(char *path, int *dir, char *name);
+int ssufs_isDir(int inodenum);
+int ssufs_dirEntries(int inodenum);
+void ssufs_addName(int inodenum, int dir, char *name, int is_dir);
+void ssufs_removeName(int inodenum);
+void ssufs_setPathCacheSize(int nentries);
 
+void ssufs_diskRead(off_t offset, void *buf, int size);
+void ssufs_diskWrite(off_t offset, void *buf, int size);
+void ssufs_diskReadv(off_t offset, struct iovec *iov, int iovcnt);
+void ssufs_diskWritev(off_t offset, struct iovec *iov, int iovcnt);
+
+void ssufs_setDiskPath(char *path);
+void ssufs_setDiskMode(int mode);
+void ssufs_setFormatFlags(int flags);
+void ssufs_setDelayedAllocation(int on);
+void ssufs_setDirtyLimit(int bytes);
 void ssufs_formatDisk();
+int ssufs_formatDiskGeometry(int block_size, int num_blocks, int num_inodes);
+int ssufs_mountDisk();
+void ssufs_sync();
+void ssufs_unmountDisk();
 int ssufs_allocInode();
 void ssufs_freeInode(int inodenum);
 void ssufs_readInode(int inodenum, struct inode_t *inodeptr);
 void ssufs_writeInode(int inodenum, struct inode_t *inodeptr); 
+struct inode_t *ssufs_getInode(int inodenum);
+void ssufs_putInode(int inodenum);
+void ssufs_markInodeDirty(int inodenum);
+void ssufs_lockInode(int inodenum, int write);
+void ssufs_unlockInode(int inodenum);
 int ssufs_allocDataBlock();
 void ssufs_freeDataBlock(int blocknum);
+char *ssufs_getDataBlock(int blocknum);
+char *ssufs_getDataBlockForWrite(int blocknum, int overwrite);
 void ssufs_readDataBlock(int blocknum, char *buf);
 void ssufs_writeDataBlock(int blocknum, char *buf);
+void ssufs_flushDataBlock(int blocknum);
+off_t ssufs_prepareDataBlocks(int blocknum, int count, int write);
+void ssufs_readDataBlocks(int blocknum, int count, struct iovec *iov, int iovcnt);
+void ssufs_writeDataBlocks(int blocknum, int count, struct iovec *iov, int iovcnt);
+int ssufs_prefetchDataBlocks(int blocknum, int count);
+int ssufs_bmap(struct inode_t *inode, int index, int alloc);
+int ssufs_bmapRun(struct inode_t *inode, int index, int max, int *count);
+int ssufs_allocFileBlocks(struct inode_t *inode, int first, int nblocks);
+int ssufs_growFile(int inodenum, int nblocks);
+int ssufs_isInline(struct inode_t *inode);
+int ssufs_moveInlineData(int inodenum, int nblocks);
+int ssufs_allocatedBlocks(int inodenum);
+char *ssufs_getDelayedBlock(int inodenum, int index);
+int ssufs_flushDelayed(int inodenum);
+void ssufs_freeFileBlocks(struct inode_t *inode, int first);
+void ssufs_flushFile(struct inode_t *inode);
+int ssufs_maxFileSize();
 void ssufs_dump();
+
+#endif
@@ -1,246 +1,721 @@
 #include "ssufs-ops.h"
 
-extern struct filehandle_t file_handle_array[MAX_OPEN_FILES];
+extern struct filehandle_t *HANDLE_TABLE[MAX_OPEN_FILES / HANDLE_CHUNK];
+extern int HANDLE_SLOTS;
+extern int FREE_HANDLE;
+extern pthread_mutex_t HANDLE_LOCK;
+pthread_mutex_t NAMESPACE_LOCK = PTHREAD_MUTEX_INITIALIZER; // 이름 해시 테이블과 경로 캐시를 보호한다 (create, delete, mkdir, rmdir, open)
+int RA_MAX = RA_MAX_BLOCKS; // 미리 읽는 window의 최대 블록 수 (0이면 미리 읽지 않는다)
+
+// 여러 thread에서 동시에 사용할 수 있다. 읽기는 inode의 read lock을, 쓰기는 write lock을 잡으므로
+// 서로 다른 파일이나 같은 파일을 읽는 thread들은 동시에 진행된다. file handle 하나는 한 thread에서만 사용해야 한다. (offset을 공유하므로)
+
+// file handle 번호는 아래 HANDLE_INDEX_BITS bit가 handle table의 slot 번호이고, 그 위가 slot의 generation이다.
+// 닫을 때 slot의 generation을 올리므로, 닫힌 handle 번호는 같은 slot이 다시 쓰이더라도 ssufs_getFileHandle()에서 걸러진다.
+
+struct filehandle_t *handleSlot(int file_handle) { // handle 번호의 slot (범위는 확인하지 않는다)
+	int slot = file_handle & (MAX_OPEN_FILES - 1);
+	return &HANDLE_TABLE[slot / HANDLE_CHUNK][slot % HANDLE_CHUNK];
+}
 
-int ssufs_allocFileHandle() {
-	for(int i = 0; i < MAX_OPEN_FILES; i++) {
-		if (file_handle_array[i].inode_number == -1) {
-			return i;
+int ssufs_allocFileHandle() { // 비어있는 file handle 번호 (HANDLE_LOCK을 잡은 상태에서 부른다)
+	if (FREE_HANDLE == -1) { // free list가 비었으면 slot들을 새로 만든다
+		if (HANDLE_SLOTS == MAX_OPEN_FILES) {
+			return -1;
+		}
+		struct filehandle_t *chunk = (struct filehandle_t *)calloc(HANDLE_CHUNK, sizeof(struct filehandle_t));
+		if (chunk == NULL) {
+			return -1;
+		}
+		for (int i = 0; i < HANDLE_CHUNK; i++) {
+			chunk[i].inode_number = -1;
+			chunk[i].next_free = i + 1 < HANDLE_CHUNK ? HANDLE_SLOTS + i + 1 : -1;
 		}
+		HANDLE_TABLE[HANDLE_SLOTS / HANDLE_CHUNK] = chunk;
+		FREE_HANDLE = HANDLE_SLOTS;
+		__atomic_store_n(&HANDLE_SLOTS, HANDLE_SLOTS + HANDLE_CHUNK, __ATOMIC_RELEASE); // 다른 thread의 ssufs_getFileHandle()이 chunk를 볼 수 있게 한다
 	}
-	return -1;
+	int slot = FREE_HANDLE;
+	struct filehandle_t *handle = &HANDLE_TABLE[slot / HANDLE_CHUNK][slot % HANDLE_CHUNK];
+	FREE_HANDLE = handle->next_free;
+	return (int)(handle->generation % HANDLE_GENERATIONS) << HANDLE_INDEX_BITS | slot;
 }
 
-int ssufs_create(char *filename){
-	/* 1 */
-	struct inode_t *tmp;
-	int inode_number;
+void ssufs_freeFileHandle(int file_handle) { // 닫은 file handle의 slot을 free list에 돌려주는 함수 (HANDLE_LOCK을 잡은 상태에서 부른다)
+	struct filehandle_t *handle = handleSlot(file_handle);
+	handle->inode_number = -1;
+	handle->offset = 0;
+	__atomic_store_n(&handle->generation, handle->generation + 1, __ATOMIC_RELAXED); // 이 handle 번호는 이제 쓸 수 없다
+	handle->next_free = FREE_HANDLE;
+	FREE_HANDLE = file_handle & (MAX_OPEN_FILES - 1);
+}
 
-	if (strlen(filename) > MAX_NAME_STRLEN) {
-		return -1;
-	}
+struct filehandle_t *ssufs_getFileHandle(int file_handle) {
+	/*
+		file_handle 번호가 가리키는 열린 handle을 반환한다. 잘못된 번호이거나 이미 닫힌 handle이면 NULL을 반환한다.
+		lock을 잡지 않고 slot 번호와 generation만 비교한다.
+	*/
+	int slot = file_handle & (MAX_OPEN_FILES - 1);
+	struct filehandle_t *handle;
 
-	if (open_namei(filename) != -1) { // 동일한 이름의 파일이 존재하는지 확인한다.
-		return -1;
+	if (file_handle < 0 || slot >= __atomic_load_n(&HANDLE_SLOTS, __ATOMIC_ACQUIRE)) {
+		return NULL;
+	}
+	handle = &HANDLE_TABLE[slot / HANDLE_CHUNK][slot % HANDLE_CHUNK];
+	if (__atomic_load_n(&handle->generation, __ATOMIC_RELAXED) % HANDLE_GENERATIONS != (unsigned)file_handle >> HANDLE_INDEX_BITS || handle->inode_number == -1) {
+		return NULL;
 	}
+	return handle;
+}
 
-	if ((inode_number = ssufs_allocInode()) == -1) { // 새로운 inode를 할당한다
+int ssufs_createNode(char *path, int status) {
+	/*
+		path에 status(INODE_IN_USE: 파일, INODE_DIR: 디렉토리)인 inode를 새로 만들고 inode 번호를 반환한다.
+		경로 중간의 디렉토리가 없거나 같은 이름이 이미 있으면 -1을 반환한다.
+	*/
+	struct inode_t *tmp;
+	int inode_number;
+	int dir;
+	char name[MAX_NAME_STRLEN + 1];
+	size_t len;
+
+	pthread_mutex_lock(&NAMESPACE_LOCK);
+	if (ssufs_resolvePath(path, &dir, name) == -1 // 만들 위치의 디렉토리와 이름을 구한다
+			|| ssufs_lookup(dir, name) != -1 // 동일한 이름의 파일이 존재하는지 확인한다.
+			|| (inode_number = ssufs_allocInode()) == -1) { // 새로운 inode를 할당한다
+		pthread_mutex_unlock(&NAMESPACE_LOCK);
 		return -1;
 	}
 
 	tmp = (struct inode_t *) malloc(sizeof(struct inode_t)); // 임시로 inode 내용 저장할 메모리 공간 할당
 	ssufs_readInode(inode_number, tmp);
-	tmp->status = INODE_IN_USE; // inode의 status 변경
-	strcpy(tmp->name, filename); // 파일명 저장
+	tmp->status = status; // inode의 status 변경
+	len = strnlen(name, MAX_NAME_STRLEN); // 파일명 저장 (디스크의 이름은 고정 길이라 MAX_NAME_STRLEN 글자면 '\0' 없이 저장된다)
+	memcpy(tmp->name, name, len);
+	memset(tmp->name + len, 0, MAX_NAME_STRLEN - len); // 남은 자리는 '\0'으로 채운다
+	tmp->parent = dir; // 들어있는 디렉토리 저장
 	tmp->file_size = 0; // 새로 생성된 파일이므로 크기 0으로 초기화
 	ssufs_writeInode(inode_number, tmp); // 새로운 inode 내용을 inode block에 저장
+	ssufs_addName(inode_number, dir, name, status == INODE_DIR); // 이름으로 찾을 수 있도록 해시 테이블에 추가
+	pthread_mutex_unlock(&NAMESPACE_LOCK);
+	free(tmp);
 
 	return inode_number;
 }
 
-void ssufs_delete(char *filename){
-	/* 2 */
+int ssufs_create(char *filename){
+	/* 1 */
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_CREATE);
+	int ret = ssufs_createNode(filename, INODE_IN_USE);
+	ssufs_statEnd(SSUFS_OP_CREATE, stat, 0, ret == -1);
+	return ret;
+}
+
+int ssufs_mkdir(char *path){
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_MKDIR);
+	int ret = ssufs_createNode(path, INODE_DIR);
+	ssufs_statEnd(SSUFS_OP_MKDIR, stat, 0, ret == -1);
+	return ret;
+}
+
+int deleteFile(char *filename) { // 파일을 지우는 함수 (없거나 디렉토리면 -1)
 	int inode_number;
 
-	if (strlen(filename) > MAX_NAME_STRLEN) {
-		return;
+	pthread_mutex_lock(&NAMESPACE_LOCK);
+	if ((inode_number = open_namei(filename)) == -1 || ssufs_isDir(inode_number)) { // 해당 파일의 inode 번호를 구한다
+		pthread_mutex_unlock(&NAMESPACE_LOCK);
+		return -1; // 해당 파일이 존재하지 않으면 종료한다 (디렉토리는 ssufs_rmdir()로 지운다)
 	}
 
-	if ((inode_number = open_namei(filename)) == -1) { // 해당 파일의 inode 번호를 구한다
-		return; // 해당 파일이 존재하지 않으면 종료한다
+	ssufs_removeName(inode_number); // 해시 테이블에서 이름 삭제
+	ssufs_freeInode(inode_number); // inode free
+	pthread_mutex_unlock(&NAMESPACE_LOCK);
+
+	return 0;
+}
+
+void ssufs_delete(char *filename){
+	/* 2 */
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_DELETE);
+	int ret = deleteFile(filename);
+	ssufs_statEnd(SSUFS_OP_DELETE, stat, 0, ret == -1);
+}
+
+int removeDir(char *path) { // 빈 디렉토리를 지우는 함수 (디렉토리가 아니거나 비어있지 않으면 -1)
+	int inode_number;
+
+	pthread_mutex_lock(&NAMESPACE_LOCK);
+	if ((inode_number = open_namei(path)) == -1 || !ssufs_isDir(inode_number) || ssufs_dirEntries(inode_number) > 0) {
+		pthread_mutex_unlock(&NAMESPACE_LOCK);
+		return -1;
 	}
 
-	ssufs_freeInode(inode_number); // inode free
+	ssufs_removeName(inode_number);
+	ssufs_freeInode(inode_number);
+	pthread_mutex_unlock(&NAMESPACE_LOCK);
+	return 0;
+}
 
-	return;
+int ssufs_rmdir(char *path){
+	/*
+		빈 디렉토리 path를 지운다. 디렉토리가 아니거나 비어있지 않으면 -1을 반환한다.
+	*/
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_RMDIR);
+	int ret = removeDir(path);
+	ssufs_statEnd(SSUFS_OP_RMDIR, stat, 0, ret == -1);
+	return ret;
 }
 
-int ssufs_open(char *filename){
-	/* 3 */
+int openFile(char *filename) { // 파일을 열고 새 file handle 번호를 반환하는 함수 (실패하면 -1)
 	int inode_number;
 	int new_handle_index = -1;
+	struct filehandle_t *handle;
 
-	if ((inode_number = open_namei(filename)) == -1) { // 해당 파일의 inode 번호 구함
-		return -1; // 파일 존재하지 않으면 -1 리턴
+	pthread_mutex_lock(&NAMESPACE_LOCK);
+	if ((inode_number = open_namei(filename)) == -1 || ssufs_isDir(inode_number)) { // 해당 파일의 inode 번호 구함
+		pthread_mutex_unlock(&NAMESPACE_LOCK);
+		return -1; // 파일 존재하지 않거나 디렉토리면 -1 리턴
 	}
 
+	pthread_mutex_lock(&HANDLE_LOCK);
 	if ((new_handle_index = ssufs_allocFileHandle()) == -1) { // 새로운 file handle 할당
+		pthread_mutex_unlock(&HANDLE_LOCK);
+		pthread_mutex_unlock(&NAMESPACE_LOCK);
 		return -1; // file handle을 할당받지 못했다면 -1 리턴
 	}
-	file_handle_array[new_handle_index].inode_number = inode_number; // file handle에 inode 번호 저장
-	file_handle_array[new_handle_index].offset = 0; // offset 0으로 초기화
+	handle = handleSlot(new_handle_index);
+	handle->inode_number = inode_number; // file handle에 inode 번호 저장
+	handle->offset = 0; // offset 0으로 초기화
+	handle->ra_next = 0; // 처음부터 읽으면 순차 읽기로 본다
+	handle->ra_window = 0;
+	handle->ra_end = 0;
+	pthread_mutex_unlock(&HANDLE_LOCK);
+	ssufs_getInode(inode_number); // 파일이 열려있는 동안 inode를 cache에 올려둔다 (지워지기 전에 잡도록 NAMESPACE_LOCK 안에서)
+	pthread_mutex_unlock(&NAMESPACE_LOCK);
 
 	return new_handle_index; // 새로운 file handle의 index를 리턴함
 }
 
+int ssufs_open(char *filename){
+	/* 3 */
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_OPEN);
+	int ret = openFile(filename);
+	ssufs_statEnd(SSUFS_OP_OPEN, stat, 0, ret == -1);
+	return ret;
+}
+
+int closeFile(int file_handle) { // 파일의 변경 내용을 기록하고 handle을 닫는 함수 (잘못된 handle이거나 기록하지 못하면 -1)
+	struct filehandle_t *handle = ssufs_getFileHandle(file_handle);
+	if (handle == NULL) {
+		return -1;
+	}
+	int inode_number = handle->inode_number;
+	struct inode_t *tmp = ssufs_getInode(inode_number);
+	ssufs_lockInode(inode_number, 1);
+	if (ssufs_flushDelayed(inode_number) == -1) { // delayed 블록들을 할당해서 기록 (실패하면 블록을 버리지 않도록 handle을 열어둔다)
+		ssufs_unlockInode(inode_number);
+		ssufs_putInode(inode_number);
+		return -1;
+	}
+	ssufs_flushFile(tmp); // 파일의 data block 중 변경된 것들을 디스크에 기록
+	ssufs_unlockInode(inode_number);
+	ssufs_putInode(inode_number);
+	ssufs_putInode(inode_number); // open 때 얻은 inode 반납 (마지막 참조면 변경 내용 기록)
+	pthread_mutex_lock(&HANDLE_LOCK);
+	ssufs_freeFileHandle(file_handle);
+	pthread_mutex_unlock(&HANDLE_LOCK);
+	return 0;
+}
+
 void ssufs_close(int file_handle){
-	file_handle_array[file_handle].inode_number = -1;
-	file_handle_array[file_handle].offset = 0;
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_CLOSE);
+	int ret = closeFile(file_handle);
+	ssufs_statEnd(SSUFS_OP_CLOSE, stat, 0, ret == -1);
+}
+
+int iovTotal(const struct iovec *iov, int iovcnt) { // iovec들의 길이의 합 (int 범위를 넘으면 -1)
+	long total = 0;
+	for (int i = 0; i < iovcnt; i++) {
+		total += iov[i].iov_len;
+		if (total > INT_MAX) {
+			return -1;
+		}
+	}
+	return (int)total;
+}
+
+void iovCopy(struct iov_cursor_t *cursor, char *data, int size, int to_iov) {
+	/*
+		to_iov가 0이 아니면 data의 size 바이트를 cursor 위치의 iovec들에 복사하고, 0이면 반대로 iovec들에서 data로 복사한다.
+		복사한 만큼 cursor를 옮긴다.
+	*/
+	while (size > 0) {
+		const struct iovec *iov = &cursor->iov[cursor->index];
+		int n = iov->iov_len - cursor->offset < (size_t)size ? (int)(iov->iov_len - cursor->offset) : size;
+
+		if (to_iov) {
+			memcpy((char *)iov->iov_base + cursor->offset, data, n);
+		} else {
+			memcpy(data, (char *)iov->iov_base + cursor->offset, n);
+		}
+		data += n;
+		size -= n;
+		cursor->offset += n;
+		if (cursor->offset == iov->iov_len) {
+			cursor->index++;
+			cursor->offset = 0;
+		}
+	}
+}
+
+int iovSlice(struct iov_cursor_t *cursor, int size, struct iovec *out) {
+	/*
+		cursor 위치부터 size 바이트에 해당하는 iovec 조각들을 out에 채우고 조각 수를 반환한다. cursor는 size만큼 옮긴다.
+	*/
+	int count = 0;
+
+	while (size > 0) {
+		const struct iovec *iov = &cursor->iov[cursor->index];
+		int n = iov->iov_len - cursor->offset < (size_t)size ? (int)(iov->iov_len - cursor->offset) : size;
+
+		if (n > 0) {
+			out[count].iov_base = (char *)iov->iov_base + cursor->offset;
+			out[count].iov_len = n;
+			count++;
+		}
+		size -= n;
+		cursor->offset += n;
+		if (cursor->offset == iov->iov_len) {
+			cursor->index++;
+			cursor->offset = 0;
+		}
+	}
+	return count;
 }
 
 int ssufs_read(int file_handle, char *buf, int nbytes){
 	/* 4 */
-	struct inode_t *tmp;
-	char *block_buf;
-	int file_size, offset;
-	int read_bytes;
+	struct iovec iov = { buf, nbytes };
+	return ssufs_readv(file_handle, &iov, 1);
+}
+
+void readBlocks(int inode_number, struct inode_t *tmp, int offset, int nbytes, const struct iovec *iov, int iovcnt, struct aio_request_t *request) {
+	/*
+		파일의 offset부터 nbytes를 iov들로 읽는다. 디스크에서 연속해서 놓인 블록들을 통째로 읽을 때는 buffer cache를 거치지 않는다.
+		아직 할당되지 않은 delayed 블록과 inode에 들어있는 inline 파일의 내용은 메모리에서 바로 복사한다.
+		request가 NULL이 아니면 블록 전체를 읽는 부분은 모두 request의 segment로 넘기고(비동기), 블록 일부만 읽는 부분만 바로 복사한다.
+	*/
 	int start_byte, end_byte;
 	int start_block_index, end_block_index;
+	struct iov_cursor_t cursor = { iov, 0, 0 };
+	struct iovec *slices;
 
-	if (file_handle_array[file_handle].inode_number == -1) { // 잘못된 file_handle 번호를 전달받았으면 -1 리턴
-		return -1;
+	if (ssufs_isInline(tmp)) { // 블록을 읽지 않는다
+		iovCopy(&cursor, tmp->inline_data + offset, nbytes, 1);
+		return;
 	}
 
-	tmp = (struct inode_t *) malloc(sizeof(struct inode_t));
-	ssufs_readInode(file_handle_array[file_handle].inode_number, tmp); // inode 읽어옴
-
-	offset = file_handle_array[file_handle].offset;
-	file_size = tmp->file_size;
 	start_byte = offset; // 읽기 시작할 위치의 오프셋
 	end_byte = offset + nbytes - 1; // 읽기 종료할 위치의 오프셋 (여기까지 읽고 종료)
-	start_block_index = offset / BLOCKSIZE; // 읽기 시작할 블록 index
-	end_block_index = end_byte / BLOCKSIZE; // 읽기 종료할 블록 index
+	start_block_index = offset / SUPERBLOCK.block_size; // 읽기 시작할 블록 index
+	end_block_index = end_byte / SUPERBLOCK.block_size; // 읽기 종료할 블록 index
 
-	if (offset + nbytes > file_size) { // 파일 크기를 넘어서 읽으려고 하는 경우에는 아무것도 읽지 않아야함 -> -1 리턴하며 함수 종료
-		free(tmp);
-		return -1;
-	}
-
-	for (int i = start_block_index, read_bytes = 0; i <= end_block_index; ++i) {
+	slices = (struct iovec *)malloc(iovcnt * sizeof(struct iovec)); // preadv에 넘길 iovec 조각들
+	for (int i = start_block_index; i <= end_block_index; ++i) {
 		int read_start_byte, read_end_byte;
-		int data_block_index = tmp->direct_blocks[i];
-
-		block_buf = (char *)calloc(BLOCKSIZE, sizeof(char)); // 읽은 데이터 임시로 저장할 공간 할당
-		ssufs_readDataBlock(data_block_index, block_buf); // 블럭 통째로 데이터 읽어옴
+		int run; // i번째 블록부터 디스크에서 연속된 블록 수
+		int full_blocks = (end_byte + 1) / SUPERBLOCK.block_size - i; // i번째 블록부터 통째로 읽는 블록 수
+		char *block_buf;
 
-		// 읽어온 블럭의 데이터들 중에서 우리에게 필요한 데이터의 시작위치, 끝 위치를 구한다
+		// 블럭의 데이터들 중에서 우리에게 필요한 데이터의 시작위치, 끝 위치를 구한다
 		read_start_byte = 0;
-		read_end_byte = BLOCKSIZE - 1;
+		read_end_byte = SUPERBLOCK.block_size - 1;
 		if (i == start_block_index) {
-			read_start_byte = start_byte % BLOCKSIZE;
+			read_start_byte = start_byte % SUPERBLOCK.block_size;
 		} 
 		if (i == end_block_index) {
-			read_end_byte = end_byte % BLOCKSIZE;
+			read_end_byte = end_byte % SUPERBLOCK.block_size;
+		}
+		if ((block_buf = ssufs_getDelayedBlock(inode_number, i)) != NULL) { // delayed 블록이면 메모리에서 바로 복사
+			iovCopy(&cursor, block_buf + read_start_byte, read_end_byte - read_start_byte + 1, 1);
+			continue;
+		}
+
+		if (i == start_block_index && start_byte % SUPERBLOCK.block_size != 0) {
+			full_blocks = 0;
+		}
+		int data_block_index = ssufs_bmapRun(tmp, i, full_blocks, &run); // 파일의 i번째 블록이 저장된 data block
+		if (request != NULL && full_blocks > 0) { // 통째로 읽는 블록들은 worker thread나 io_uring이 읽는다
+			int nslices = iovSlice(&cursor, run * SUPERBLOCK.block_size, slices);
+			off_t disk_offset = ssufs_prepareDataBlocks(data_block_index, run, 0);
+			for (int j = 0; j < nslices; j++) {
+				ssufs_aioAddSegment(request, disk_offset, 0, &slices[j]);
+				disk_offset += slices[j].iov_len;
+			}
+			i += run - 1;
+			continue;
+		}
+		if (run > 1) { // 연속된 블록 여러 개를 통째로 읽을 때는 buffer cache를 거치지 않고 한번에 읽는다
+			int nslices = iovSlice(&cursor, run * SUPERBLOCK.block_size, slices);
+			ssufs_readDataBlocks(data_block_index, run, slices, nslices);
+			i += run - 1;
+			continue;
+		}
+
+		// buffer cache에 있는 블럭에서 iovec들로 바로 copy (중간 buffer를 거치지 않는다)
+		iovCopy(&cursor, ssufs_getDataBlock(data_block_index) + read_start_byte, read_end_byte - read_start_byte + 1, 1);
+	}
+	free(slices);
+}
+
+void readAhead(struct filehandle_t *handle, struct inode_t *tmp, int offset, int nbytes) {
+	/*
+		handle로 offset부터 nbytes를 읽은 뒤에 불러서, 읽기가 순차적이면 그 뒤의 블록들을 미리 읽어오도록 요청한다. (inode의 lock을 잡은 상태에서 부른다)
+		window는 RA_MIN_BLOCKS부터 시작해서 순차 읽기가 이어지는 동안 RA_MAX까지 두 배씩 커지고,
+		미리 읽어둔 블록이 window의 절반 이하로 남으면 그 뒤의 window를 요청한다. 순차가 아니면 처음부터 다시 시작한다.
+		두 블록 이상 읽는 경우는 buffer cache를 거치지 않고 한번에 읽으므로 미리 읽지 않는다.
+	*/
+	int block_size = SUPERBLOCK.block_size;
+	int next_block = (offset + nbytes - 1) / block_size + 1; // 이번에 읽은 마지막 블록의 다음 블록
+	int file_blocks = ssufs_allocatedBlocks(handle->inode_number); // delayed 블록은 이미 메모리에 있다
+	int sequential = offset == handle->ra_next && nbytes < 2 * block_size;
+
+	handle->ra_next = offset + nbytes;
+	if (!sequential || RA_MAX == 0) {
+		handle->ra_window = 0;
+		handle->ra_end = 0;
+		return;
+	}
+	if (handle->ra_window == 0) {
+		handle->ra_window = RA_MIN_BLOCKS < RA_MAX ? RA_MIN_BLOCKS : RA_MAX;
+	}
+	if (handle->ra_end < next_block) {
+		handle->ra_end = next_block;
+	}
+	if (handle->ra_end - next_block > handle->ra_window / 2) { // 아직 미리 읽어둔 블록이 충분하다
+		return;
+	}
+
+	int start = handle->ra_end;
+	int end = start + handle->ra_window < file_blocks ? start + handle->ra_window : file_blocks;
+	int i = start;
+	while (i < end) {
+		int run;
+		int data_block_index = ssufs_bmapRun(tmp, i, end - i, &run); // 디스크에서 연속된 블록들은 한번에 요청한다
+		int done = ssufs_prefetchDataBlocks(data_block_index, run);
+		i += done;
+		if (done < run) { // buffer cache에 미리 읽어둘 자리가 없다
+			break;
 		}
+	}
+	handle->ra_end = i;
+	if (i < end) { // buffer cache가 받아줄 수 있는 만큼으로 window를 줄인다
+		handle->ra_window = i - start > 1 ? i - start : 1;
+	} else {
+		handle->ra_window = handle->ra_window * 2 < RA_MAX ? handle->ra_window * 2 : RA_MAX;
+	}
+}
 
-		memcpy(buf + read_bytes, block_buf + read_start_byte, read_end_byte - read_start_byte + 1); // 데이터를 buf에 copy
-		read_bytes += read_end_byte - read_start_byte + 1; // 이번 블럭에서 읽어온 데이터의 크기를 구한다
+int readFile(int file_handle, const struct iovec *iov, int iovcnt) { // ssufs_readv()의 본체
+	struct filehandle_t *handle;
+	struct inode_t *tmp;
+	int inode_number;
+	int offset;
+	int nbytes;
 
-		free(block_buf);
+	if ((handle = ssufs_getFileHandle(file_handle)) == NULL) { // 잘못된 file_handle 번호를 전달받았으면 -1 리턴
+		return -1;
+	}
+	if ((nbytes = iovTotal(iov, iovcnt)) <= 0) { // 읽을 내용이 없으면 바로 리턴
+		return nbytes;
 	}
 
-	file_handle_array[file_handle].offset = end_byte + 1; // 새로운 offset 저장
+	inode_number = handle->inode_number;
+	tmp = ssufs_getInode(inode_number); // inode cache에서 inode를 가져옴
+	ssufs_lockInode(inode_number, 0); // 다른 thread도 같이 읽을 수 있다
 
-	free(tmp);
+	offset = handle->offset;
+	if (offset + nbytes > tmp->file_size) { // 파일 크기를 넘어서 읽으려고 하는 경우에는 아무것도 읽지 않아야함 -> -1 리턴하며 함수 종료
+		ssufs_unlockInode(inode_number);
+		ssufs_putInode(inode_number);
+		return -1;
+	}
+
+	readBlocks(inode_number, tmp, offset, nbytes, iov, iovcnt, NULL);
+	readAhead(handle, tmp, offset, nbytes); // 순차 읽기면 다음 블록들을 미리 읽어오게 한다
+
+	handle->offset = offset + nbytes; // 새로운 offset 저장
+
+	ssufs_unlockInode(inode_number);
+	ssufs_putInode(inode_number);
 	return 0;
 }
 
+int ssufs_readv(int file_handle, const struct iovec *iov, int iovcnt){
+	/*
+		file_handle의 현재 offset부터 iov들을 차례로 채울 만큼 읽는다. 파일 크기를 넘어서면 아무것도 읽지 않고 -1을 반환한다.
+		디스크에서 연속해서 놓인 블록들을 통째로 읽을 때는 buffer cache를 거치지 않고 preadv 한번으로 읽는다.
+	*/
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_READ);
+	int ret = readFile(file_handle, iov, iovcnt);
+	ssufs_statEnd(SSUFS_OP_READ, stat, ret == 0 ? iovTotal(iov, iovcnt) : 0, ret == -1);
+	return ret;
+}
+
 int ssufs_write(int file_handle, char *buf, int nbytes){
 	/* 5 */
-	struct inode_t *tmp;
-	int file_size, offset;
-	int write_bytes;
+	struct iovec iov = { buf, nbytes };
+	return ssufs_writev(file_handle, &iov, 1);
+}
+
+int writeBlocks(int inode_number, struct inode_t *tmp, int offset, int nbytes, const struct iovec *iov, int iovcnt, struct aio_request_t *request) {
+	/*
+		파일의 offset부터 iov들의 내용 nbytes를 쓰고 파일 크기를 늘린다. 블록을 할당하지 못하면 아무것도 쓰지 않고 -1을 반환한다.
+		디스크에서 연속해서 놓인 블록들을 통째로 덮어쓸 때는 buffer cache를 거치지 않는다.
+		delayed allocation을 쓰면 파일 끝에 새로 붙는 블록들은 할당하지 않고 메모리(delayed 블록)에만 쓴다.
+		inline 파일은 INLINE_DATA_SIZE를 넘지 않는 동안 inode에만 쓰고, 넘어서면 내용을 data block으로 옮긴 뒤에 쓴다.
+		request가 NULL이 아니면 블록 전체를 덮어쓰는 부분은 모두 request의 segment로 넘기고(비동기), 블록 일부만 쓰는 부분만 바로 쓴다.
+	*/
+	int file_size = tmp->file_size;
 	int start_byte, end_byte;
 	int start_block_index, end_block_index;
+	struct iov_cursor_t cursor = { iov, 0, 0 };
+	struct iovec *slices;
 
-	if (file_handle_array[file_handle].inode_number == -1) { // 잘못된 file_handle 번호를 전달받았으면 -1 리턴
-		return -1;
-	}
-
-	tmp = (struct inode_t *) malloc(sizeof(struct inode_t));
-	ssufs_readInode(file_handle_array[file_handle].inode_number, tmp); // inode 읽어옴
-
-	offset = file_handle_array[file_handle].offset;
-	file_size = tmp->file_size;
 	start_byte = offset; // 쓰기 시작할 위치의 오프셋
 	end_byte = offset + nbytes - 1; // 쓰기 종료할 위치의 오프셋 (여기까지 쓰고 종료)
-	start_block_index = offset / BLOCKSIZE; // 쓰기 시작할 블록의 index
-	end_block_index = end_byte / BLOCKSIZE; // 쓰기 종료할 블록의 index
+	start_block_index = offset / SUPERBLOCK.block_size; // 쓰기 시작할 블록의 index
+	end_block_index = end_byte / SUPERBLOCK.block_size; // 쓰기 종료할 블록의 index
 
-	if (end_byte > BLOCKSIZE * MAX_FILE_SIZE) { // 요청된 바이트 수를 쓰면 최대 파일 크기 제한을 초과하는 경우 -1 리턴하고 함수 종료
-		free(tmp);
+	if (end_byte >= ssufs_maxFileSize()) { // 요청된 바이트 수를 쓰면 최대 파일 크기 제한을 초과하는 경우 -1 리턴하고 함수 종료
 		return -1;
 	}
 
-	int new_alloced_data_blocks[MAX_FILE_SIZE] = {0,};
-	for (int i = start_block_index; i <= end_block_index; ++i) {
-		int data_block_index = tmp->direct_blocks[i];
-
-		if (data_block_index == -1) {
-			data_block_index = tmp->direct_blocks[i] = ssufs_allocDataBlock(); // 새로운 data block이 필요하면 새로 할당함
-			if (data_block_index == -1) { // 할당 실패 시
-				// 앞서 새로 할당했던 data block들 다시 반환하여 쓰기 하기 전 상태를 유지하도록 한다
-				for (int j = 0; j < MAX_FILE_SIZE; ++j) {
-					if (new_alloced_data_blocks[j]) {
-						ssufs_freeDataBlock(tmp->direct_blocks[j]);
-					}
-				}
-
-				return -1; // -1 리턴하며 종료
-
-			} else { // 할당 성공 시 새로 할당된 데이터 블럭임을 표시
-				new_alloced_data_blocks[i] = 1;
+	// 파일 크기 안쪽의 블록들은 이미 있으므로 그 뒤의 블록들만 새로 만들어진다
+	int old_block_count = (file_size + SUPERBLOCK.block_size - 1) / SUPERBLOCK.block_size;
+	if (ssufs_isInline(tmp)) {
+		if (end_byte < INLINE_DATA_SIZE) { // 여전히 inode에 들어가면 블록 없이 inode에만 쓴다
+			iovCopy(&cursor, tmp->inline_data + offset, nbytes, 0);
+			if (end_byte >= file_size) {
+				tmp->file_size = end_byte + 1;
 			}
-		}	
+			return 0;
+		}
+		if (ssufs_moveInlineData(inode_number, end_block_index + 1) == -1) { // 기존 내용은 첫 블록으로 옮겨진다
+			return -1;
+		}
+	} else if (ssufs_growFile(inode_number, end_block_index + 1) == -1) { // 새로운 블록이 필요하면 만들고, 공간이 모자라면
+		return -1; // 아무것도 쓰지 않고 -1 리턴하며 종료
 	}
 
-	for (int i = start_block_index, write_bytes = 0; i <= end_block_index; ++i) {
+	slices = (struct iovec *)malloc(iovcnt * sizeof(struct iovec)); // pwritev에 넘길 iovec 조각들
+	for (int i = start_block_index; i <= end_block_index; ++i) {
 		char *block_buf;
 		int write_start_byte, write_end_byte;
-		int data_block_index = tmp->direct_blocks[i];
-
-		block_buf = (char *)calloc(BLOCKSIZE, sizeof(char)); // write할 데이터 임시로 저장할 공간 할당
-
-		if (!new_alloced_data_blocks[i]) {
-			ssufs_readDataBlock(data_block_index, block_buf);
-		}
+		int run; // i번째 블록부터 디스크에서 연속된 블록 수
+		int full_blocks = (end_byte + 1) / SUPERBLOCK.block_size - i; // i번째 블록부터 통째로 덮어쓰는 블록 수
 
 		// 데이터를 쓸 위치의 인덱스를 구한다
 		write_start_byte = 0;
-		write_end_byte = BLOCKSIZE - 1;
+		write_end_byte = SUPERBLOCK.block_size - 1;
 		if (i == start_block_index) {
-			write_start_byte = start_byte % BLOCKSIZE;
+			write_start_byte = start_byte % SUPERBLOCK.block_size;
 		} 
 		if (i == end_block_index) {
-			write_end_byte = end_byte % BLOCKSIZE;
+			write_end_byte = end_byte % SUPERBLOCK.block_size;
+		}
+		if ((block_buf = ssufs_getDelayedBlock(inode_number, i)) != NULL) { // delayed 블록이면 메모리에만 쓴다
+			iovCopy(&cursor, block_buf + write_start_byte, write_end_byte - write_start_byte + 1, 0);
+			continue;
 		}
 
-		memcpy(block_buf + write_start_byte, buf + write_bytes, write_end_byte - write_start_byte + 1); // write
-		ssufs_writeDataBlock(data_block_index, block_buf); // write한 내용 디스크에 쓴다
-
-		write_bytes += write_end_byte - write_start_byte + 1; // write한 바이트 수 계산
+		if (i == start_block_index && start_byte % SUPERBLOCK.block_size != 0) {
+			full_blocks = 0;
+		}
+		int data_block_index = ssufs_bmapRun(tmp, i, full_blocks, &run);
+		if (request != NULL && full_blocks > 0) { // 통째로 덮어쓰는 블록들은 worker thread나 io_uring이 쓴다
+			int nslices = iovSlice(&cursor, run * SUPERBLOCK.block_size, slices);
+			off_t disk_offset = ssufs_prepareDataBlocks(data_block_index, run, 1);
+			for (int j = 0; j < nslices; j++) {
+				ssufs_aioAddSegment(request, disk_offset, 1, &slices[j]);
+				disk_offset += slices[j].iov_len;
+			}
+			i += run - 1;
+			continue;
+		}
+		if (run > 1) { // 연속된 블록 여러 개를 통째로 덮어쓸 때는 buffer cache를 거치지 않고 한번에 기록한다
+			int nslices = iovSlice(&cursor, run * SUPERBLOCK.block_size, slices);
+			ssufs_writeDataBlocks(data_block_index, run, slices, nslices);
+			i += run - 1;
+			continue;
+		}
 
-		free(block_buf);
+		// buffer cache의 블럭에 바로 write (새 블럭이거나 블럭 전체를 덮어쓰면 기존 내용을 읽지 않는다)
+		block_buf = ssufs_getDataBlockForWrite(data_block_index,
+			i >= old_block_count || (write_start_byte == 0 && write_end_byte == SUPERBLOCK.block_size - 1));
+		iovCopy(&cursor, block_buf + write_start_byte, write_end_byte - write_start_byte + 1, 0); // write
 	}
+	free(slices);
 
-	if (end_byte > file_size) { // write 후에 파일의 크기가 커진 경우 file size 증가시킴
+	if (end_byte >= file_size) { // write 후에 파일의 크기가 커진 경우 file size 증가시킴
 		tmp->file_size = end_byte + 1;
 	}
+	return 0;
+}
 
-	file_handle_array[file_handle].offset = end_byte + 1; // 새로운 offset 저장
-	ssufs_writeInode(file_handle_array[file_handle].inode_number, tmp); // 변경된 idnode 내용 저장
+int writeFile(int file_handle, const struct iovec *iov, int iovcnt) { // ssufs_writev()의 본체
+	struct filehandle_t *handle;
+	struct inode_t *tmp;
+	int inode_number;
+	int offset;
+	int nbytes;
+	int ret;
 
-	free(tmp);
+	if ((handle = ssufs_getFileHandle(file_handle)) == NULL) { // 잘못된 file_handle 번호를 전달받았으면 -1 리턴
+		return -1;
+	}
+	if ((nbytes = iovTotal(iov, iovcnt)) <= 0) { // 쓸 내용이 없으면 바로 리턴
+		return nbytes;
+	}
+
+	inode_number = handle->inode_number;
+	tmp = ssufs_getInode(inode_number); // inode cache에서 inode를 가져옴
+	ssufs_lockInode(inode_number, 1); // 블록 할당과 파일 크기 변경이 있으므로 혼자 쓴다
+	offset = handle->offset;
+
+	ret = writeBlocks(inode_number, tmp, offset, nbytes, iov, iovcnt, NULL);
+	if (ret == 0) {
+		handle->offset = offset + nbytes; // 새로운 offset 저장
+	}
+	ssufs_markInodeDirty(inode_number); // 변경된 inode 내용은 close나 sync 때 기록된다
+
+	ssufs_unlockInode(inode_number);
+	ssufs_putInode(inode_number);
+	return ret;
+}
+
+int ssufs_writev(int file_handle, const struct iovec *iov, int iovcnt){
+	/*
+		file_handle의 현재 offset부터 iov들의 내용을 차례로 쓴다. 블록을 할당하지 못하면 아무것도 쓰지 않고 -1을 반환한다.
+		디스크에서 연속해서 놓인 블록들을 통째로 덮어쓸 때는 buffer cache를 거치지 않고 pwritev 한번으로 쓴다.
+	*/
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_WRITE);
+	int ret = writeFile(file_handle, iov, iovcnt);
+	ssufs_statEnd(SSUFS_OP_WRITE, stat, ret == 0 ? iovTotal(iov, iovcnt) : 0, ret == -1);
+	return ret;
+}
+
+int ssufs_submit_read(int file_handle, char *buf, int nbytes, int offset, void *data){
+	/*
+		파일의 offset 위치에서 nbytes를 buf로 읽는 비동기 요청을 제출한다. file_handle의 offset은 바꾸지 않는다.
+		완료되면 ssufs_poll_completions()가 data와 결과(읽은 바이트 수, 실패하면 -1)를 돌려준다.
+		파일 크기를 넘어서거나 queue depth만큼 요청이 밀려있으면 제출하지 않고 -1을 반환한다.
+		완료되기 전에는 buf와 파일의 그 범위를 다른 요청이나 read/write, close/delete로 건드리면 안 된다.
+	*/
+	struct filehandle_t *handle;
+	struct inode_t *tmp;
+	struct aio_request_t *request;
+	struct iovec iov = { buf, nbytes };
+	int inode_number;
+
+	if ((handle = ssufs_getFileHandle(file_handle)) == NULL || nbytes < 0 || offset < 0 || ssufs_aioFull()) {
+		return -1;
+	}
+	inode_number = handle->inode_number;
+	tmp = ssufs_getInode(inode_number);
+	ssufs_lockInode(inode_number, 0);
+	if ((long)offset + nbytes > tmp->file_size) {
+		ssufs_unlockInode(inode_number);
+		ssufs_putInode(inode_number);
+		return -1;
+	}
+
+	request = ssufs_aioNewRequest(data, nbytes);
+	if (nbytes > 0) {
+		readBlocks(inode_number, tmp, offset, nbytes, &iov, 1, request);
+	}
+	ssufs_unlockInode(inode_number);
+	ssufs_putInode(inode_number);
+	ssufs_aioStart(request);
 	return 0;
 }
 
-int ssufs_lseek(int file_handle, int nseek){
-	int offset = file_handle_array[file_handle].offset;
+int ssufs_submit_write(int file_handle, char *buf, int nbytes, int offset, void *data){
+	/*
+		파일의 offset 위치에 buf의 nbytes를 쓰는 비동기 요청을 제출한다. file_handle의 offset은 바꾸지 않는다.
+		블록 할당과 파일 크기 변경은 제출할 때 끝나고, 블록 전체를 덮어쓰는 부분의 기록만 나중에 끝난다.
+		블록을 할당하지 못하거나 queue depth만큼 요청이 밀려있으면 제출하지 않고 -1을 반환한다.
+	*/
+	struct filehandle_t *handle;
+	struct inode_t *tmp;
+	struct aio_request_t *request;
+	struct iovec iov = { buf, nbytes };
+	int inode_number;
+	int ret = 0;
+
+	if ((handle = ssufs_getFileHandle(file_handle)) == NULL || nbytes < 0 || offset < 0 || ssufs_aioFull()) {
+		return -1;
+	}
+	inode_number = handle->inode_number;
+	tmp = ssufs_getInode(inode_number);
+	ssufs_lockInode(inode_number, 1);
+	if (offset > tmp->file_size) { // 파일 끝 뒤에 빈 공간을 만들 수는 없다
+		ssufs_unlockInode(inode_number);
+		ssufs_putInode(inode_number);
+		return -1;
+	}
+
+	request = ssufs_aioNewRequest(data, nbytes);
+	if (nbytes > 0) {
+		ret = writeBlocks(inode_number, tmp, offset, nbytes, &iov, 1, request);
+		ssufs_markInodeDirty(inode_number);
+	}
+	ssufs_unlockInode(inode_number);
+	ssufs_putInode(inode_number);
+	if (ret == -1) {
+		ssufs_aioCancel(request);
+		return -1;
+	}
+	ssufs_aioStart(request);
+	return 0;
+}
+
+void ssufs_setReadahead(int max_blocks){
+	/*
+		순차 읽기일 때 미리 읽는 window의 최대 블록 수를 정한다. 0이면 미리 읽지 않는다.
+	*/
+	RA_MAX = max_blocks < 0 ? 0 : max_blocks;
+}
 
-	struct inode_t *tmp = (struct inode_t *) malloc(sizeof(struct inode_t));
-	ssufs_readInode(file_handle_array[file_handle].inode_number, tmp);
+int seekFile(int file_handle, int nseek) { // ssufs_lseek()의 본체
+	struct filehandle_t *handle = ssufs_getFileHandle(file_handle);
+	if (handle == NULL) {
+		return -1;
+	}
+	int offset = handle->offset;
+	int inode_number = handle->inode_number;
+
+	struct inode_t *tmp = ssufs_getInode(inode_number);
 	
+	ssufs_lockInode(inode_number, 0);
 	int fsize = tmp->file_size;
+	ssufs_unlockInode(inode_number);
+	ssufs_putInode(inode_number);
 	
 	offset += nseek;
 
 	if ((fsize == -1) || (offset < 0) || (offset > fsize)) {
-		free(tmp);
 		return -1;
 	}
 
-	file_handle_array[file_handle].offset = offset;
-	free(tmp);
+	handle->offset = offset;
 
 	return 0;
 }
+
+int ssufs_lseek(int file_handle, int nseek){
+	unsigned long stat = ssufs_statBegin(SSUFS_OP_LSEEK);
+	int ret = seekFile(file_handle, nseek);
+	ssufs_statEnd(SSUFS_OP_LSEEK, stat, 0, ret == -1);
+	return ret;
+}
@@ -1,13 +1,36 @@
+#ifndef SSUFS_OPS_H
+#define SSUFS_OPS_H
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include "ssufs-disk.h"
+#include "ssufs-aio.h"
+
+struct iov_cursor_t // iovec 배열에서 다음에 읽거나 쓸 위치
+{
+	const struct iovec *iov;
+	int index; // 지금 보고있는 iovec
+	size_t offset; // 그 iovec 안에서의 위치
+};
 
 int ssufs_allocFileHandle();
+void ssufs_freeFileHandle(int file_handle);
+struct filehandle_t *ssufs_getFileHandle(int file_handle);
+int ssufs_createNode(char *path, int status);
 int ssufs_create(char *filename);
+int ssufs_mkdir(char *path);
+int ssufs_rmdir(char *path);
 int ssufs_open(char *filename);
 void ssufs_delete(char *filename); 
 void ssufs_close(int file_handle);
 int ssufs_read(int file_handle, char *buf, int nbytes);
 int ssufs_write(int file_handle, char *buf, int nbytes);
+int ssufs_readv(int file_handle, const struct iovec *iov, int iovcnt);
+int ssufs_writev(int file_handle, const struct iovec *iov, int iovcnt);
+int ssufs_submit_read(int file_handle, char *buf, int nbytes, int offset, void *data);
+int ssufs_submit_write(int file_handle, char *buf, int nbytes, int offset, void *data);
 int ssufs_lseek(int file_handle, int nseek);
+void ssufs_setReadahead(int max_blocks);
+
+#endif
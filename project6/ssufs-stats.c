@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ssufs-stats.h"
+
+int STATS_SAMPLE = DEFAULT_STATS_SAMPLE; // 연산 몇 번에 한번씩 시간을 잴지 (0이면 재지 않는다)
+int DUMP_STATS; // ssufs_dump()가 통계도 출력할지
+pthread_mutex_t STATS_LOCK = PTHREAD_MUTEX_INITIALIZER; // thread 목록과 RETIRED, BASELINE을 보호한다
+pthread_once_t STATS_ONCE = PTHREAD_ONCE_INIT;
+pthread_key_t STATS_KEY; // thread가 끝날 때 그 thread의 통계를 정리한다
+__thread struct thread_stats_t *MY_STATS; // 이 thread의 통계 (처음 연산할 때 만든다)
+struct thread_stats_t *STATS_THREADS; // 살아있는 thread들의 통계 목록
+struct ssufs_stats_t RETIRED; // 끝난 thread들의 통계 합계
+struct ssufs_stats_t BASELINE; // ssufs_resetStats() 때의 합계 (ssufs_stats()는 이 값을 뺀다)
+unsigned STATS_EPOCH; // ssufs_resetStats()마다 증가한다 (최대값은 빼서 구할 수 없으므로 epoch가 바뀌면 각 thread가 지운다)
+
+const char *STAT_NAMES[SSUFS_OP_COUNT] = {
+	"create", "mkdir", "rmdir", "open", "close", "read", "write", "lseek", "delete", "sync",
+	"sb read", "sb write", "inode read", "inode write", "block read", "block write"
+};
+
+unsigned long statsNanos() { // 나노초 단위의 현재시간 (0은 시간을 재지 않는다는 뜻으로 쓰므로 피한다)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec + 1;
+}
+
+int ssufs_histBucket(unsigned long value, int sub_bits) { // value가 들어갈 histogram 칸
+	if (value < (1UL << sub_bits))
+		return (int)value;
+	int shift = 63 - __builtin_clzl(value) - sub_bits;
+	return ((shift + 1) << sub_bits) + (int)((value >> shift) & ((1UL << sub_bits) - 1));
+}
+
+unsigned long ssufs_histLow(int bucket, int sub_bits) { // histogram 칸에 들어가는 가장 작은 값
+	int group = bucket >> sub_bits, sub = bucket & ((1 << sub_bits) - 1);
+	if (group == 0)
+		return sub;
+	return ((1UL << sub_bits) + sub) << (group - 1);
+}
+
+unsigned long ssufs_histHigh(int bucket, int sub_bits) { // histogram 칸에 들어가는 가장 큰 값
+	int group = bucket >> sub_bits;
+	if (group == 0)
+		return ssufs_histLow(bucket, sub_bits);
+	return ssufs_histLow(bucket, sub_bits) + ((1UL << (group - 1)) - 1);
+}
+
+void addStats(struct ssufs_stats_t *to, struct ssufs_stats_t *from, int sign) { // to에 from을 더하거나(sign 1) 뺀다(sign -1) (from은 다른 thread가 쓰는 중일 수 있다, 최대값은 addMax()로 따로 구한다)
+	for (int i = 0; i < SSUFS_OP_COUNT; i++) {
+		struct ssufs_op_stats_t *a = &to->ops[i], *b = &from->ops[i];
+		a->count += sign * __atomic_load_n(&b->count, __ATOMIC_RELAXED);
+		a->errors += sign * __atomic_load_n(&b->errors, __ATOMIC_RELAXED);
+		a->bytes += sign * __atomic_load_n(&b->bytes, __ATOMIC_RELAXED);
+		a->timed += sign * __atomic_load_n(&b->timed, __ATOMIC_RELAXED);
+		a->total_ns += sign * __atomic_load_n(&b->total_ns, __ATOMIC_RELAXED);
+		for (int j = 0; j < STATS_BUCKETS; j++)
+			a->hist[j] += sign * __atomic_load_n(&b->hist[j], __ATOMIC_RELAXED);
+	}
+}
+
+void addMax(struct ssufs_stats_t *to, struct ssufs_stats_t *from) { // to의 최대값들을 from의 값과 비교해 키운다
+	for (int i = 0; i < SSUFS_OP_COUNT; i++) {
+		long max = __atomic_load_n(&from->ops[i].max_ns, __ATOMIC_RELAXED);
+		if (max > to->ops[i].max_ns)
+			to->ops[i].max_ns = max;
+	}
+}
+
+void retireStats(void *arg) { // thread가 끝날 때 통계를 합계에 더하고 해제하는 함수
+	struct thread_stats_t *stats = (struct thread_stats_t *)arg;
+
+	pthread_mutex_lock(&STATS_LOCK);
+	addStats(&RETIRED, &stats->stats, 1);
+	if (stats->epoch == STATS_EPOCH) // 지난 reset 전에 잰 최대값은 버린다
+		addMax(&RETIRED, &stats->stats);
+	if (stats->prev != NULL)
+		stats->prev->next = stats->next;
+	else
+		STATS_THREADS = stats->next;
+	if (stats->next != NULL)
+		stats->next->prev = stats->prev;
+	pthread_mutex_unlock(&STATS_LOCK);
+	free(stats);
+}
+
+void createStatsKey() {
+	pthread_key_create(&STATS_KEY, retireStats);
+}
+
+struct thread_stats_t *myStats() { // 이 thread의 통계 (없으면 만들어서 목록에 넣는다)
+	if (MY_STATS != NULL)
+		return MY_STATS;
+	struct thread_stats_t *stats = (struct thread_stats_t *)calloc(1, sizeof(struct thread_stats_t));
+	if (stats == NULL)
+		return NULL;
+	pthread_once(&STATS_ONCE, createStatsKey);
+	pthread_mutex_lock(&STATS_LOCK);
+	stats->epoch = __atomic_load_n(&STATS_EPOCH, __ATOMIC_RELAXED);
+	stats->next = STATS_THREADS;
+	if (STATS_THREADS != NULL)
+		STATS_THREADS->prev = stats;
+	STATS_THREADS = stats;
+	pthread_mutex_unlock(&STATS_LOCK);
+	pthread_setspecific(STATS_KEY, stats);
+	MY_STATS = stats;
+	return stats;
+}
+
+void bump(long *counter, long value) { // 이 thread만 쓰는 값을 늘린다 (다른 thread가 읽는 중이어도 찢어진 값을 보지 않도록 atomic store)
+	__atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+void ssufs_setStatsSampling(int every){
+	/*
+		연산 every번에 한번씩 시간을 재서 latency histogram에 넣는다. 0이면 시간은 재지 않고 횟수만 센다. (기본은 DEFAULT_STATS_SAMPLE)
+	*/
+	__atomic_store_n(&STATS_SAMPLE, every < 0 ? 0 : every, __ATOMIC_RELAXED);
+}
+
+void ssufs_setDumpStats(int on){
+	/*
+		ssufs_dump()가 디스크 상태 뒤에 연산별 통계도 출력할지 정한다. (기본은 출력하지 않는다)
+	*/
+	DUMP_STATS = on;
+}
+
+unsigned long ssufs_statBegin(int op){
+	/*
+		연산을 시작할 때 불러서 이번에 시간을 잴 차례면 시작 시간을, 아니면 0을 반환한다. 반환값은 ssufs_statEnd()에 넘긴다.
+	*/
+	struct thread_stats_t *stats = myStats();
+	int every = __atomic_load_n(&STATS_SAMPLE, __ATOMIC_RELAXED);
+
+	if (stats == NULL || every == 0 || --stats->ticks[op] > 0) // 나눗셈 대신 남은 횟수를 센다
+		return 0;
+	stats->ticks[op] = every;
+	return statsNanos();
+}
+
+void ssufs_statEnd(int op, unsigned long start, long bytes, int error){
+	/*
+		연산이 끝났을 때 불러서 횟수와 바이트 수, 실패 여부를 더하고, 시간을 재는 중이었으면 latency를 histogram에 넣는다.
+	*/
+	struct thread_stats_t *stats = myStats();
+
+	if (stats == NULL)
+		return;
+	struct ssufs_op_stats_t *s = &stats->stats.ops[op];
+	bump(&s->count, 1);
+	if (bytes > 0)
+		bump(&s->bytes, bytes);
+	if (error)
+		bump(&s->errors, 1);
+	if (start != 0) {
+		long ns = (long)(statsNanos() - start);
+		unsigned epoch = __atomic_load_n(&STATS_EPOCH, __ATOMIC_RELAXED);
+		if (stats->epoch != epoch) { // reset 뒤 처음 잰 연산이면 예전 최대값들을 지운다
+			for (int i = 0; i < SSUFS_OP_COUNT; i++)
+				__atomic_store_n(&stats->stats.ops[i].max_ns, 0, __ATOMIC_RELAXED);
+			__atomic_store_n(&stats->epoch, epoch, __ATOMIC_RELAXED);
+		}
+		bump(&s->timed, 1);
+		bump(&s->total_ns, ns);
+		bump(&s->hist[ssufs_histBucket(ns, STATS_SUB_BITS)], 1);
+		if (ns > s->max_ns)
+			__atomic_store_n(&s->max_ns, ns, __ATOMIC_RELAXED);
+	}
+}
+
+void ssufs_stats(struct ssufs_stats_t *stats){
+	/*
+		모든 thread의 연산별 통계를 더해서 stats에 넣는다. (마지막 ssufs_resetStats() 이후의 값)
+		다른 thread가 연산하는 중에 불러도 되고, 그 연산들은 포함될 수도 있고 아닐 수도 있다.
+	*/
+	memset(stats, 0, sizeof(struct ssufs_stats_t));
+	pthread_mutex_lock(&STATS_LOCK);
+	addStats(stats, &RETIRED, 1);
+	addMax(stats, &RETIRED);
+	for (struct thread_stats_t *t = STATS_THREADS; t != NULL; t = t->next) {
+		addStats(stats, &t->stats, 1);
+		if (__atomic_load_n(&t->epoch, __ATOMIC_RELAXED) == STATS_EPOCH) // reset 뒤로 시간을 잰 적이 없는 thread의 최대값은 예전 값이다
+			addMax(stats, &t->stats);
+	}
+	addStats(stats, &BASELINE, -1);
+	pthread_mutex_unlock(&STATS_LOCK);
+}
+
+void ssufs_resetStats(){
+	/*
+		통계를 0부터 다시 센다. 각 thread의 통계를 지우는 대신 지금까지의 합계를 기억해두고 ssufs_stats()에서 뺀다.
+		최대값은 뺄 수 없으므로 epoch를 올려서 각 thread가 다음에 시간을 잴 때 자기 최대값을 지우게 한다.
+	*/
+	struct ssufs_stats_t total;
+
+	memset(&total, 0, sizeof(total));
+	pthread_mutex_lock(&STATS_LOCK);
+	addStats(&total, &RETIRED, 1);
+	for (struct thread_stats_t *t = STATS_THREADS; t != NULL; t = t->next)
+		addStats(&total, &t->stats, 1);
+	memcpy(&BASELINE, &total, sizeof(total));
+	for (int i = 0; i < SSUFS_OP_COUNT; i++)
+		RETIRED.ops[i].max_ns = 0;
+	__atomic_store_n(&STATS_EPOCH, STATS_EPOCH + 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&STATS_LOCK);
+}
+
+long ssufs_statsPercentile(struct ssufs_op_stats_t *op, double percent){
+	/*
+		시간을 잰 연산들 중 percent%의 latency가 이 값(ns) 이하다. histogram 칸의 끝 값이므로 실제보다 최대 1/4 크다.
+	*/
+	long rank = (long)(op->timed * percent / 100.0 + 0.5), seen = 0;
+
+	if (op->timed == 0)
+		return 0;
+	if (rank < 1)
+		rank = 1;
+	for (int i = 0; i < STATS_BUCKETS; i++) {
+		seen += op->hist[i];
+		if (seen >= rank) {
+			long high = (long)ssufs_histHigh(i, STATS_SUB_BITS);
+			return high < op->max_ns ? high : op->max_ns;
+		}
+	}
+	return op->max_ns;
+}
+
+const char *ssufs_statName(int op){
+	return op >= 0 && op < SSUFS_OP_COUNT ? STAT_NAMES[op] : "?";
+}
+
+void ssufs_printStats(FILE *fp){
+	/*
+		연산별 통계를 표로 출력한다. (한번도 하지 않은 연산은 생략한다)
+	*/
+	struct ssufs_stats_t stats;
+
+	ssufs_stats(&stats);
+	fprintf(fp, "%-12s %10s %8s %12s %10s %10s %10s %10s %10s\n", "OP", "COUNT", "ERRORS", "BYTES", "MEAN(ns)", "P50", "P99", "P99.9", "MAX");
+	for (int i = 0; i < SSUFS_OP_COUNT; i++) {
+		struct ssufs_op_stats_t *op = &stats.ops[i];
+		if (op->count == 0)
+			continue;
+		fprintf(fp, "%-12s %10ld %8ld %12ld %10.0f %10ld %10ld %10ld %10ld\n", STAT_NAMES[i], op->count, op->errors, op->bytes,
+			op->timed ? (double)op->total_ns / op->timed : 0.0, ssufs_statsPercentile(op, 50), ssufs_statsPercentile(op, 99),
+			ssufs_statsPercentile(op, 99.9), op->max_ns);
+	}
+}
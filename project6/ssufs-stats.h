@@ -0,0 +1,79 @@
+#ifndef SSUFS_STATS_H
+#define SSUFS_STATS_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+// log-linear histogram: 2의 거듭제곱 구간 하나를 2^sub_bits칸으로 나눈다 (칸의 폭은 값의 1/2^sub_bits 이하)
+// 2^sub_bits보다 작은 값은 값마다 한 칸씩이다. ssufs_histBucket()으로 칸을 구하고 ssufs_histLow(), ssufs_histHigh()로 칸의 범위를 구한다.
+#define SSUFS_HIST_BUCKETS(sub_bits) ((64 - (sub_bits) + 1) << (sub_bits)) // unsigned long 값 전체를 담는 칸 수
+
+#define STATS_SUB_BITS 2 // latency histogram에서 2의 거듭제곱 구간 하나를 2^STATS_SUB_BITS칸으로 나눈다 (오차 1/4 이하)
+#define STATS_BUCKETS SSUFS_HIST_BUCKETS(STATS_SUB_BITS)
+#define DEFAULT_STATS_SAMPLE 16 // 기본으로 연산 몇 번에 한번씩 시간을 잴지 (매번 재면 짧은 연산이 눈에 띄게 느려진다)
+
+// 연산별 통계: 각 thread는 자기 통계에만 쓰고(lock이나 atomic read-modify-write 없이), ssufs_stats()가 모든 thread의 것을 더한다.
+// 끝난 thread의 통계는 thread가 끝날 때 합계에 더해두고 해제한다.
+// 횟수, 바이트, 실패 수는 항상 세고, latency는 STATS_SAMPLE번에 한번씩만 재서 histogram에 넣는다. (시계를 읽는 비용을 줄인다)
+
+enum ssufs_stat_op // 통계를 모으는 연산들
+{
+	// 공개 API
+	SSUFS_OP_CREATE,
+	SSUFS_OP_MKDIR,
+	SSUFS_OP_RMDIR,
+	SSUFS_OP_OPEN,
+	SSUFS_OP_CLOSE,
+	SSUFS_OP_READ, // ssufs_read()와 ssufs_readv()
+	SSUFS_OP_WRITE, // ssufs_write()와 ssufs_writev()
+	SSUFS_OP_LSEEK,
+	SSUFS_OP_DELETE,
+	SSUFS_OP_SYNC,
+	// 디스크 접근
+	SSUFS_OP_SUPERBLOCK_READ,
+	SSUFS_OP_SUPERBLOCK_WRITE, // 변경된 bitmap 기록 포함
+	SSUFS_OP_INODE_READ,
+	SSUFS_OP_INODE_WRITE,
+	SSUFS_OP_BLOCK_READ, // buffer cache miss, 미리 읽기, buffer cache를 거치지 않는 여러 블록 읽기
+	SSUFS_OP_BLOCK_WRITE, // dirty buffer 기록, buffer cache를 거치지 않는 여러 블록 쓰기
+	SSUFS_OP_COUNT
+};
+
+struct ssufs_op_stats_t
+{
+	long count; // 연산 횟수
+	long errors; // 실패한 횟수
+	long bytes; // 읽거나 쓴 바이트 수
+	long timed; // 시간을 잰 횟수
+	long total_ns; // 시간을 잰 연산들의 시간의 합
+	long max_ns;
+	long hist[STATS_BUCKETS]; // 시간을 잰 연산들의 latency histogram (ssufs_statsPercentile()로 읽는다)
+};
+
+struct ssufs_stats_t
+{
+	struct ssufs_op_stats_t ops[SSUFS_OP_COUNT];
+};
+
+struct thread_stats_t // thread 하나의 통계
+{
+	struct ssufs_stats_t stats;
+	int ticks[SSUFS_OP_COUNT]; // 연산별로 다음에 시간을 잴 때까지 남은 횟수
+	unsigned epoch; // max_ns들이 속한 STATS_EPOCH
+	struct thread_stats_t *prev, *next; // 살아있는 thread들의 목록
+};
+
+int ssufs_histBucket(unsigned long value, int sub_bits);
+unsigned long ssufs_histLow(int bucket, int sub_bits);
+unsigned long ssufs_histHigh(int bucket, int sub_bits);
+void ssufs_setStatsSampling(int every);
+void ssufs_setDumpStats(int on);
+unsigned long ssufs_statBegin(int op);
+void ssufs_statEnd(int op, unsigned long start, long bytes, int error);
+void ssufs_stats(struct ssufs_stats_t *stats);
+void ssufs_resetStats();
+long ssufs_statsPercentile(struct ssufs_op_stats_t *op, double percent);
+const char *ssufs_statName(int op);
+void ssufs_printStats(FILE *fp);
+
+#endif
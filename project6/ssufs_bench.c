@@ -0,0 +1,688 @@
+#include <time.h>
+#include "ssufs-ops.h"
+#include "ssufs-cache.h"
+
+/*
+	ssufs 연산 하나당 비용을 측정한다.
+	디스크 이미지에 대한 시스템콜 수(SSUFS_SYSCALLS)와 실행 시간(ns)을 연산 횟수로 나누어 출력하고,
+	buffer cache의 hit 비율도 함께 출력한다.
+	pread/pwrite 모드에서 buffer cache 크기를 바꿔가며 측정한 뒤,
+	여러 크기의 디스크 이미지에서 pread/pwrite 모드와 mmap 모드를 비교하고,
+	큰 파일의 순차 읽기/쓰기 처리량(MB/s)을 chunk 크기별로(iovec으로 나눈 경우 포함) 블록 매핑(indirect block)과 extent 매핑에서 측정한다.
+	블록보다 작은 chunk의 순차 읽기는 미리 읽기(readahead)를 켠 경우와 끈 경우를 비교하고, 미리 읽어온 블록 중 실제로 사용된 비율도 출력한다.
+	마지막으로 디렉토리의 파일 수와 깊이를 바꿔가며 create/open/delete의 비용을 측정한다.
+	(이름 검색은 디렉토리 크기와 상관없이 일정해야 하고, 깊은 경로는 경로 캐시가 있으면 앞부분을 다시 따라가지 않는다)
+	비동기 I/O는 4K 랜덤 읽기/쓰기를 queue depth를 바꿔가며 worker thread backend와 io_uring backend에서 측정한다.
+	여러 thread가 서로 다른 파일이나 같은 파일을 동시에 4K씩 랜덤하게 읽을 때의 전체 처리량을 thread 수별로 측정한다.
+	(읽기는 inode의 read lock만 잡으므로 CPU 수만큼 늘어나야 한다)
+	file handle을 수만 개까지 열어둔 상태에서 open/close의 비용이 열린 handle 수와 상관없이 일정한지 측정한다.
+	작은 append를 여러 파일에 번갈아 하는 경우를 delayed allocation을 켠 경우와 끈 경우로 비교하고,
+	다 쓴 파일들을 1MB씩 다시 읽어서 블록들이 디스크에서 얼마나 연속으로 놓였는지(읽기의 syscalls/op)도 함께 출력한다.
+	작은 파일 여러 개를 만들어 쓰고 다시 읽는 비용을 inline data(SSUFS_FLAG_INLINE)를 켠 경우와 끈 경우로 비교한다.
+
+	gcc -O2 -o ssufs_bench ssufs_bench.c ssufs-ops.c ssufs-disk.c ssufs-cache.c ssufs-aio.c ssufs-stats.c -pthread
+*/
+
+#define OPS 512000 // 1바이트 읽기/쓰기 벤치마크의 연산 횟수
+#define ROUNDS 2000
+#define FILE_BYTES (SUPERBLOCK.block_size * MAX_FILE_SIZE) // direct block만으로 담을 수 있는 파일 크기
+#define SEQ_BYTES (64 << 20) // 순차 읽기/쓰기 벤치마크의 파일 크기
+#define AIO_OPS 32768 // 비동기 I/O 벤치마크의 요청 수 (4K씩)
+#define MT_OPS 65536 // 멀티스레드 읽기 벤치마크에서 thread들이 나눠서 하는 읽기 수 (4K씩)
+#define MT_FILE_BYTES (8 << 20) // 멀티스레드 읽기 벤치마크의 파일 하나 크기
+#define MT_MAX_THREADS 8
+#define APPEND_BYTES (16 << 20) // append 벤치마크에서 모든 파일에 쓰는 전체 크기
+#define APPEND_FILES 4 // append 벤치마크에서 번갈아 쓰는 파일 수
+#define SMALL_FILES 4096 // 작은 파일 벤치마크의 파일 수
+
+struct mt_arg_t // 멀티스레드 읽기 벤치마크의 thread 하나가 할 일
+{
+	char name[8]; // 읽을 파일
+	int ops;
+	unsigned seed;
+};
+
+unsigned long get_nanos() { // 나노초 단위의 현재시간 리턴하는 함수
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+void report(char *name, long ops, long syscalls, unsigned long nanos) {
+	struct cache_stats_t stats;
+	ssufs_getCacheStats(&stats);
+	printf("%-16s %8ld ops %8.2f syscalls/op %10.1f ns/op %6.1f%% cache hits\n", name, ops, (double)syscalls / ops, (double)nanos / ops,
+		stats.hits + stats.misses ? 100.0 * stats.hits / (stats.hits + stats.misses) : 0.0);
+}
+
+void bench_write1() { // 1바이트씩 파일 끝까지 쓰고 처음으로 돌아가기를 반복
+	int fd;
+	long ops = 0;
+	long syscalls;
+	unsigned long start;
+
+	ssufs_create("w1");
+	fd = ssufs_open("w1");
+
+	ssufs_resetCacheStats();
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	while (ops < OPS) {
+		for (int i = 0; i < FILE_BYTES; i++, ops++) {
+			if (ssufs_write(fd, "x", 1) == -1) {
+				printf("write failed\n");
+				exit(1);
+			}
+		}
+		ssufs_lseek(fd, -FILE_BYTES);
+	}
+	report("write 1B", ops, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	ssufs_close(fd);
+	ssufs_delete("w1");
+}
+
+void bench_read1() { // 1바이트씩 파일 끝까지 읽고 처음으로 돌아가기를 반복
+	char *buf = (char *)malloc(FILE_BYTES);
+	char c;
+	int fd;
+	long ops = 0;
+	long syscalls;
+	unsigned long start;
+
+	memset(buf, 'r', FILE_BYTES);
+	ssufs_create("r1");
+	fd = ssufs_open("r1");
+	ssufs_write(fd, buf, FILE_BYTES);
+	ssufs_lseek(fd, -FILE_BYTES);
+
+	ssufs_resetCacheStats();
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	while (ops < OPS) {
+		for (int i = 0; i < FILE_BYTES; i++, ops++) {
+			if (ssufs_read(fd, &c, 1) == -1) {
+				printf("read failed\n");
+				exit(1);
+			}
+		}
+		ssufs_lseek(fd, -FILE_BYTES);
+	}
+	report("read 1B", ops, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	ssufs_close(fd);
+	ssufs_delete("r1");
+	free(buf);
+}
+
+void bench_files(int nfiles) { // nfiles개 파일의 블록들을 돌아가며 한 블록씩 읽기
+	char *buf = (char *)malloc(FILE_BYTES);
+	char name[32];
+	int fds[MAX_FILES];
+	long ops = 0;
+	long syscalls;
+	unsigned long start;
+
+	memset(buf, 'f', FILE_BYTES);
+	for (int i = 0; i < nfiles; i++) {
+		sprintf(name, "f%d", i);
+		ssufs_create(name);
+		fds[i] = ssufs_open(name);
+		ssufs_write(fds[i], buf, FILE_BYTES);
+	}
+
+	ssufs_resetCacheStats();
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int r = 0; r < ROUNDS; r++) {
+		for (int i = 0; i < nfiles; i++) {
+			ssufs_lseek(fds[i], -FILE_BYTES);
+			for (int j = 0; j < MAX_FILE_SIZE; j++, ops++) {
+				ssufs_read(fds[i], buf, SUPERBLOCK.block_size);
+			}
+		}
+	}
+	sprintf(name, "read %d blocks", nfiles * MAX_FILE_SIZE);
+	report(name, ops, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	for (int i = 0; i < nfiles; i++) {
+		sprintf(name, "f%d", i);
+		ssufs_close(fds[i]);
+		ssufs_delete(name);
+	}
+	free(buf);
+}
+
+void bench_meta() { // 파일 생성, 열기, 1바이트 쓰기, 닫기, 삭제를 반복 (메타데이터 경로)
+	long ops = 0;
+	long syscalls;
+	unsigned long start;
+
+	ssufs_resetCacheStats();
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int r = 0; r < ROUNDS * 10; r++, ops++) {
+		ssufs_create("m1");
+		int fd = ssufs_open("m1");
+		ssufs_write(fd, "m", 1);
+		ssufs_close(fd);
+		ssufs_delete("m1");
+	}
+	report("create..delete", ops, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+}
+
+void run_all() {
+	bench_write1();
+	bench_read1();
+	bench_files(2);
+	bench_files(6);
+	bench_meta();
+}
+
+void bench_image(int mode, int block_size, int num_blocks, int num_inodes) { // 주어진 geometry와 모드로 format/mount 시간과 연산 비용 측정
+	unsigned long start;
+
+	ssufs_setDiskMode(mode);
+	start = get_nanos();
+	if (ssufs_formatDiskGeometry(block_size, num_blocks, num_inodes) == -1) {
+		printf("format failed\n");
+		exit(1);
+	}
+	printf("%s, %d x %d byte blocks (%.1f MiB), %d inodes: format %.2f ms", mode == SSUFS_MODE_MMAP ? "mmap" : "pread",
+		num_blocks, block_size, (double)num_blocks * block_size / (1 << 20), num_inodes, (get_nanos() - start) / 1e6);
+	ssufs_unmountDisk();
+
+	start = get_nanos();
+	if (ssufs_mountDisk() == -1) {
+		printf("\nmount failed\n");
+		exit(1);
+	}
+	printf(", mount %.2f ms\n", (get_nanos() - start) / 1e6);
+
+	run_all();
+	ssufs_unmountDisk();
+}
+
+void seq_pass(char *name, int write, struct iovec *iov, int iovcnt) { // "seq" 파일 전체를 iov 단위로 순차 쓰기/읽기하고 처리량 출력
+	long ops = SEQ_BYTES / (iov[0].iov_len * iovcnt);
+	long syscalls = SSUFS_SYSCALLS;
+	unsigned long start = get_nanos(), nanos;
+	int fd = ssufs_open("seq");
+	struct cache_stats_t stats;
+
+	ssufs_resetCacheStats();
+
+	for (long j = 0; j < ops; j++) {
+		if ((write ? ssufs_writev(fd, iov, iovcnt) : ssufs_readv(fd, iov, iovcnt)) == -1) {
+			printf("%s failed\n", name);
+			exit(1);
+		}
+	}
+	ssufs_close(fd); // 닫을 때 파일의 dirty buffer가 기록된다
+	nanos = get_nanos() - start;
+	ssufs_getCacheStats(&stats);
+	printf("%-16s %8ld ops %8.2f syscalls/op %10.1f MB/s", name, ops, (double)(SSUFS_SYSCALLS - syscalls) / ops, SEQ_BYTES / (nanos / 1e9) / 1e6);
+	if (stats.readahead > 0) {
+		printf(" %6.1f%% of %ld prefetched blocks used", 100.0 * stats.readahead_hits / stats.readahead, stats.readahead);
+	}
+	printf("\n");
+}
+
+void bench_seq(int mode, int flags) { // SEQ_BYTES 크기의 파일을 chunk 단위로 순차 쓰기/읽기
+	int chunks[] = {1024, 4096, 64 << 10, 1 << 20};
+	char *buf = (char *)malloc(1 << 20);
+	char name[32];
+	struct iovec iov[16];
+
+	memset(buf, 's', 1 << 20);
+	ssufs_setDiskMode(mode);
+	ssufs_setFormatFlags(flags);
+	if (ssufs_formatDiskGeometry(4096, 65536, 1024) == -1) {
+		printf("format failed\n");
+		exit(1);
+	}
+	printf("%s, %s, sequential %d MiB file (max file size %d bytes)\n", mode == SSUFS_MODE_MMAP ? "mmap" : "pread",
+		flags & SSUFS_FLAG_EXTENTS ? "extents" : "blocks", SEQ_BYTES >> 20, ssufs_maxFileSize());
+
+	for (int i = 0; i < (int)(sizeof(chunks) / sizeof(int)); i++) {
+		iov[0].iov_base = buf;
+		iov[0].iov_len = chunks[i];
+		ssufs_create("seq");
+		sprintf(name, "write %dK", chunks[i] >> 10);
+		seq_pass(name, 1, iov, 1);
+		sprintf(name, "read %dK", chunks[i] >> 10);
+		seq_pass(name, 0, iov, 1);
+		if (chunks[i] <= 4096) { // buffer cache를 거치는 읽기는 미리 읽기 없이도 측정한다
+			ssufs_setReadahead(0);
+			sprintf(name, "read %dK no-RA", chunks[i] >> 10);
+			seq_pass(name, 0, iov, 1);
+			ssufs_setReadahead(RA_MAX_BLOCKS);
+		}
+		ssufs_delete("seq");
+	}
+
+	// 서로 떨어진 buffer 16개를 iovec으로 넘겨 64K씩 쓰고 읽기
+	for (int i = 0; i < 16; i++) {
+		iov[i].iov_base = buf + i * (64 << 10);
+		iov[i].iov_len = 4096;
+	}
+	ssufs_create("seq");
+	seq_pass("writev 16x4K", 1, iov, 16);
+	seq_pass("readv 16x4K", 0, iov, 16);
+	ssufs_delete("seq");
+
+	ssufs_unmountDisk();
+	ssufs_setFormatFlags(0);
+	free(buf);
+}
+
+void bench_names(int nfiles, int depth, int path_cache) { // 깊이 depth인 디렉토리에 파일 nfiles개를 만들고, 모두 열었다 닫고, 모두 지우는 각 단계의 비용 측정
+	char dir[MAX_PATH_STRLEN] = "";
+	char name[MAX_PATH_STRLEN + MAX_NAME_STRLEN + 2];
+	long syscalls;
+	unsigned long start;
+
+	ssufs_setPathCacheSize(path_cache);
+	if (ssufs_formatDiskGeometry(4096, 4096, nfiles + depth) == -1) {
+		printf("format failed\n");
+		exit(1);
+	}
+	for (int i = 0; i < depth; i++) {
+		sprintf(dir + strlen(dir), "d%d/", i);
+		if (ssufs_mkdir(dir) == -1) {
+			printf("mkdir failed\n");
+			exit(1);
+		}
+	}
+	printf("pread, %d files in \"/%s\", path cache %d\n", nfiles, dir, path_cache);
+
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int i = 0; i < nfiles; i++) {
+		sprintf(name, "%sn%d", dir, i);
+		if (ssufs_create(name) == -1) {
+			printf("create failed\n");
+			exit(1);
+		}
+	}
+	report("create", nfiles, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int i = 0; i < nfiles; i++) {
+		sprintf(name, "%sn%d", dir, i);
+		int fd = ssufs_open(name);
+		if (fd == -1) {
+			printf("open failed\n");
+			exit(1);
+		}
+		ssufs_close(fd);
+	}
+	report("open..close", nfiles, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	// 다시 mount하면 inode들로부터 이름 해시 테이블을 새로 만든다
+	ssufs_unmountDisk();
+	start = get_nanos();
+	ssufs_mountDisk();
+	printf("mount %.2f ms\n", (get_nanos() - start) / 1e6);
+
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int i = 0; i < nfiles; i++) {
+		sprintf(name, "%sn%d", dir, i);
+		ssufs_delete(name);
+	}
+	report("delete", nfiles, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+	sprintf(name, "%sn0", dir);
+	if (open_namei(name) != -1) {
+		printf("delete failed\n");
+		exit(1);
+	}
+	for (int i = depth; i > 0; i--) {
+		if (ssufs_rmdir(dir) == -1) {
+			printf("rmdir failed\n");
+			exit(1);
+		}
+		dir[strlen(dir) - 1] = '\0';
+		*(strrchr(dir, '/') ? strrchr(dir, '/') + 1 : dir) = '\0';
+	}
+
+	ssufs_unmountDisk();
+	ssufs_setPathCacheSize(DEFAULT_PATH_CACHE_SIZE);
+}
+
+void bench_handles(int nhandles) { // 파일 하나를 nhandles번 열어두고, 그 상태에서 open..close를 반복한 뒤 모두 닫는 비용 측정
+	int *fds = (int *)malloc(nhandles * sizeof(int));
+	long syscalls;
+	unsigned long start;
+
+	ssufs_formatDiskGeometry(4096, 256, 64);
+	ssufs_create("h");
+	printf("pread, %d open handles\n", nhandles);
+
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int i = 0; i < nhandles; i++) {
+		if ((fds[i] = ssufs_open("h")) == -1) {
+			printf("open failed\n");
+			exit(1);
+		}
+	}
+	report("open", nhandles, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int i = 0; i < ROUNDS * 50; i++) {
+		ssufs_close(ssufs_open("h"));
+	}
+	report("open..close", ROUNDS * 50, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+	syscalls = SSUFS_SYSCALLS;
+	start = get_nanos();
+	for (int i = 0; i < nhandles; i++) {
+		ssufs_close(fds[i]);
+	}
+	report("close", nhandles, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+	ssufs_unmountDisk();
+	free(fds);
+}
+
+void aio_pass(char *name, int fd, int write, int depth) { // 파일의 랜덤한 4K 블록들에 AIO_OPS개의 요청을 depth개씩 동시에 보내고 처리량 출력
+	char *bufs = (char *)malloc((size_t)depth * 4096);
+	int *free_bufs = (int *)malloc(depth * sizeof(int)); // 쓰고있지 않은 buffer 번호
+	int nfree = depth;
+	int nblocks = SEQ_BYTES / 4096;
+	long submitted = 0, completed = 0;
+	long syscalls = SSUFS_SYSCALLS;
+	unsigned long start = get_nanos(), nanos;
+	struct ssufs_completion_t completions[64];
+
+	memset(bufs, 'a', (size_t)depth * 4096);
+	for (int i = 0; i < depth; i++) {
+		free_bufs[i] = i;
+	}
+	srand(depth);
+	while (completed < AIO_OPS) {
+		while (submitted < AIO_OPS && nfree > 0) {
+			int b = free_bufs[nfree - 1];
+			int offset = (rand() % nblocks) * 4096;
+			int ret = write ? ssufs_submit_write(fd, bufs + (size_t)b * 4096, 4096, offset, (void *)(long)b)
+				: ssufs_submit_read(fd, bufs + (size_t)b * 4096, 4096, offset, (void *)(long)b);
+			if (ret == -1) {
+				break;
+			}
+			nfree--;
+			submitted++;
+		}
+		int n = ssufs_poll_completions(completions, 64, 1);
+		for (int i = 0; i < n; i++) {
+			if (completions[i].result != 4096) {
+				printf("%s failed\n", name);
+				exit(1);
+			}
+			free_bufs[nfree++] = (int)(long)completions[i].data;
+		}
+		completed += n;
+	}
+	nanos = get_nanos() - start;
+	printf("%-16s %8d ops %8.2f syscalls/op %10.0f IOPS %10.1f MB/s\n", name, AIO_OPS, (double)(SSUFS_SYSCALLS - syscalls) / AIO_OPS,
+		AIO_OPS / (nanos / 1e9), (double)AIO_OPS * 4096 / (nanos / 1e9) / 1e6);
+	free(bufs);
+	free(free_bufs);
+}
+
+void bench_aio(int backend) { // SEQ_BYTES 크기 파일의 랜덤한 4K 블록 읽기/쓰기를 queue depth별로 측정
+	int depths[] = {1, 4, 16, 64};
+	char *buf = (char *)malloc(1 << 20);
+	char name[32];
+	int fd;
+
+	memset(buf, 'a', 1 << 20);
+	ssufs_setDiskMode(SSUFS_MODE_PREAD);
+	ssufs_setFormatFlags(SSUFS_FLAG_EXTENTS);
+	ssufs_formatDiskGeometry(4096, 65536, 1024);
+	ssufs_create("aio");
+	fd = ssufs_open("aio");
+	for (int i = 0; i < SEQ_BYTES >> 20; i++) {
+		ssufs_write(fd, buf, 1 << 20);
+	}
+	ssufs_sync();
+
+	for (int i = 0; i < (int)(sizeof(depths) / sizeof(int)); i++) {
+		if (ssufs_aioInit(backend, depths[i], depths[i]) == -1) { // worker thread는 depth만큼 둔다
+			printf("%s backend is not supported\n", backend == SSUFS_AIO_URING ? "io_uring" : "threads");
+			break;
+		}
+		if (i == 0) {
+			printf("%s, random 4K requests in a %d MiB file\n", backend == SSUFS_AIO_URING ? "io_uring" : "threads", SEQ_BYTES >> 20);
+		}
+		sprintf(name, "read qd %d", depths[i]);
+		aio_pass(name, fd, 0, depths[i]);
+		sprintf(name, "write qd %d", depths[i]);
+		aio_pass(name, fd, 1, depths[i]);
+	}
+	ssufs_aioShutdown();
+
+	ssufs_close(fd);
+	ssufs_unmountDisk();
+	ssufs_setFormatFlags(0);
+	free(buf);
+}
+
+void *mt_reader(void *arg) { // 자기 file handle로 파일의 랜덤한 4K 블록들을 읽는 thread
+	struct mt_arg_t *work = (struct mt_arg_t *)arg;
+	char buf[4096];
+	int fd = ssufs_open(work->name);
+	int pos = 0;
+
+	for (int i = 0; i < work->ops; i++) {
+		int offset = (rand_r(&work->seed) % (MT_FILE_BYTES / 4096)) * 4096;
+		if (ssufs_lseek(fd, offset - pos) == -1 || ssufs_read(fd, buf, 4096) == -1) {
+			printf("read %s failed\n", work->name);
+			exit(1);
+		}
+		pos = offset + 4096;
+	}
+	ssufs_close(fd);
+	return NULL;
+}
+
+void bench_mt(int mode) { // thread 1, 2, 4, 8개가 각자 다른 파일이나 모두 같은 파일을 읽을 때의 처리량
+	struct mt_arg_t work[MT_MAX_THREADS];
+	pthread_t threads[MT_MAX_THREADS];
+	char *buf = (char *)malloc(1 << 20);
+	char name[32];
+
+	memset(buf, 'm', 1 << 20);
+	ssufs_setDiskMode(mode);
+	ssufs_setCacheSize(256);
+	ssufs_formatDiskGeometry(4096, 32768, 64);
+	for (int i = 0; i < MT_MAX_THREADS; i++) {
+		sprintf(name, "mt%d", i);
+		ssufs_create(name);
+		int fd = ssufs_open(name);
+		for (int j = 0; j < MT_FILE_BYTES >> 20; j++) {
+			ssufs_write(fd, buf, 1 << 20);
+		}
+		ssufs_close(fd);
+	}
+	printf("%s, %d random 4K reads split across threads (%ld CPUs)\n", mode == SSUFS_MODE_MMAP ? "mmap" : "pread", MT_OPS, sysconf(_SC_NPROCESSORS_ONLN));
+
+	for (int same = 0; same < 2; same++) {
+		for (int nthreads = 1; nthreads <= MT_MAX_THREADS; nthreads *= 2) {
+			long syscalls = SSUFS_SYSCALLS;
+			unsigned long start = get_nanos(), nanos;
+
+			for (int i = 0; i < nthreads; i++) {
+				sprintf(work[i].name, "mt%d", same ? 0 : i);
+				work[i].ops = MT_OPS / nthreads;
+				work[i].seed = i + 1;
+				pthread_create(&threads[i], NULL, mt_reader, &work[i]);
+			}
+			for (int i = 0; i < nthreads; i++) {
+				pthread_join(threads[i], NULL);
+			}
+			nanos = get_nanos() - start;
+			sprintf(name, "%s x%d", same ? "same file" : "own file", nthreads);
+			printf("%-16s %8d ops %8.2f syscalls/op %10.0f IOPS %10.1f MB/s\n", name, MT_OPS, (double)(SSUFS_SYSCALLS - syscalls) / MT_OPS,
+				MT_OPS / (nanos / 1e9), (double)MT_OPS * 4096 / (nanos / 1e9) / 1e6);
+		}
+	}
+	ssufs_unmountDisk();
+	ssufs_setCacheSize(DEFAULT_CACHE_SIZE);
+	free(buf);
+}
+
+void bench_append(int flags) { // APPEND_FILES개 파일에 번갈아 작은 append를 하고 (close까지), 다 쓴 파일을 다시 읽는 비용을 delayed allocation 유무별로 측정
+	int sizes[] = {64, 512, 4096};
+	char *buf = (char *)malloc(1 << 20);
+	char name[32];
+
+	memset(buf, 'a', 1 << 20);
+	printf("pread, %s, %d files, appends of %d MB in total\n", flags & SSUFS_FLAG_EXTENTS ? "extents" : "blocks", APPEND_FILES, APPEND_BYTES >> 20);
+	for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+		for (int delayed = 0; delayed < 2; delayed++) {
+			int fds[APPEND_FILES];
+			long ops = APPEND_BYTES / sizes[i];
+
+			ssufs_setDelayedAllocation(delayed);
+			ssufs_setDiskMode(SSUFS_MODE_PREAD);
+			ssufs_setFormatFlags(flags);
+			ssufs_formatDiskGeometry(4096, 16384, 64);
+			for (int j = 0; j < APPEND_FILES; j++) {
+				sprintf(name, "ap%d", j);
+				ssufs_create(name);
+				fds[j] = ssufs_open(name);
+			}
+
+			long syscalls = SSUFS_SYSCALLS;
+			unsigned long start = get_nanos(), nanos;
+			for (long j = 0; j < ops; j++) {
+				ssufs_write(fds[j % APPEND_FILES], buf, sizes[i]);
+			}
+			for (int j = 0; j < APPEND_FILES; j++) {
+				ssufs_close(fds[j]);
+			}
+			nanos = get_nanos() - start;
+			if (sizes[i] >= 1024)
+				sprintf(name, "append %dK %s", sizes[i] >> 10, delayed ? "delay" : "now");
+			else
+				sprintf(name, "append %dB %s", sizes[i], delayed ? "delay" : "now");
+			printf("%-16s %8ld ops %8.2f syscalls/op %10.1f MB/s", name, ops, (double)(SSUFS_SYSCALLS - syscalls) / ops, APPEND_BYTES / (nanos / 1e9) / 1e6);
+
+			ssufs_setCacheSize(1); // 다시 읽을 때 buffer cache에 남은 블록이 섞이지 않도록 한다
+			ssufs_unmountDisk();
+			ssufs_mountDisk();
+			syscalls = SSUFS_SYSCALLS;
+			for (int j = 0; j < APPEND_FILES; j++) {
+				sprintf(name, "ap%d", j);
+				int fd = ssufs_open(name);
+				for (int k = 0; k < APPEND_BYTES / APPEND_FILES >> 20; k++) {
+					ssufs_read(fd, buf, 1 << 20);
+				}
+				ssufs_close(fd);
+			}
+			printf(" (read back %.1f syscalls/MB)\n", (double)(SSUFS_SYSCALLS - syscalls) / (APPEND_BYTES >> 20));
+			ssufs_unmountDisk();
+			ssufs_setCacheSize(DEFAULT_CACHE_SIZE);
+		}
+	}
+	ssufs_setDelayedAllocation(1);
+	ssufs_setFormatFlags(0);
+	free(buf);
+}
+
+void bench_small(int size) { // size 바이트짜리 파일 SMALL_FILES개를 만들어 쓰고, 다시 mount해서 읽는 비용을 inline data 유무별로 측정
+	char buf[4096];
+	char name[32];
+
+	memset(buf, 's', sizeof(buf));
+	printf("pread, %d files of %d bytes\n", SMALL_FILES, size);
+	for (int inline_data = 0; inline_data < 2; inline_data++) {
+		ssufs_setDiskMode(SSUFS_MODE_PREAD);
+		ssufs_setFormatFlags(inline_data ? SSUFS_FLAG_INLINE : 0);
+		ssufs_formatDiskGeometry(4096, 16384, SMALL_FILES);
+
+		long syscalls = SSUFS_SYSCALLS;
+		unsigned long start = get_nanos();
+		for (int i = 0; i < SMALL_FILES; i++) {
+			sprintf(name, "s%d", i);
+			ssufs_create(name);
+			int fd = ssufs_open(name);
+			ssufs_write(fd, buf, size);
+			ssufs_close(fd);
+		}
+		ssufs_sync();
+		sprintf(name, "write %s", inline_data ? "inline" : "block");
+		report(name, SMALL_FILES, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+
+		ssufs_setCacheSize(1); // 다시 읽을 때 buffer cache에 남은 블록이 섞이지 않도록 한다
+		ssufs_unmountDisk();
+		ssufs_mountDisk();
+		syscalls = SSUFS_SYSCALLS;
+		start = get_nanos();
+		for (int i = 0; i < SMALL_FILES; i++) {
+			sprintf(name, "s%d", i);
+			int fd = ssufs_open(name);
+			ssufs_read(fd, buf, size);
+			ssufs_close(fd);
+		}
+		sprintf(name, "read %s", inline_data ? "inline" : "block");
+		report(name, SMALL_FILES, SSUFS_SYSCALLS - syscalls, get_nanos() - start);
+		ssufs_unmountDisk();
+		ssufs_setCacheSize(DEFAULT_CACHE_SIZE);
+	}
+	ssufs_setFormatFlags(0);
+}
+
+int main() {
+	int cache_sizes[] = {1, 4, DEFAULT_CACHE_SIZE, 32};
+
+	for (int i = 0; i < (int)(sizeof(cache_sizes) / sizeof(int)); i++) {
+		printf("pread, cache size %d\n", cache_sizes[i]);
+		ssufs_setCacheSize(cache_sizes[i]);
+		ssufs_formatDisk();
+		run_all();
+		ssufs_unmountDisk();
+	}
+	ssufs_setCacheSize(DEFAULT_CACHE_SIZE);
+
+	// 기본 이미지, 1 MiB, 256 MiB, 1 GiB
+	int geometries[][3] = {{BLOCKSIZE, NUM_BLOCKS, NUM_INODES}, {4096, 256, 64}, {4096, 65536, 1024}, {4096, 262144, 4096}};
+	for (int i = 0; i < (int)(sizeof(geometries) / sizeof(geometries[0])); i++) {
+		bench_image(SSUFS_MODE_PREAD, geometries[i][0], geometries[i][1], geometries[i][2]);
+		bench_image(SSUFS_MODE_MMAP, geometries[i][0], geometries[i][1], geometries[i][2]);
+	}
+
+	bench_seq(SSUFS_MODE_PREAD, 0);
+	bench_seq(SSUFS_MODE_PREAD, SSUFS_FLAG_EXTENTS);
+	bench_seq(SSUFS_MODE_MMAP, 0);
+	bench_seq(SSUFS_MODE_MMAP, SSUFS_FLAG_EXTENTS);
+
+	ssufs_setDiskMode(SSUFS_MODE_PREAD);
+	bench_names(1000, 0, DEFAULT_PATH_CACHE_SIZE);
+	bench_names(10000, 0, DEFAULT_PATH_CACHE_SIZE);
+	bench_names(200000, 0, DEFAULT_PATH_CACHE_SIZE); // 디렉토리 하나에 20만개
+	bench_names(10000, 8, 0);
+	bench_names(10000, 8, DEFAULT_PATH_CACHE_SIZE);
+
+	bench_handles(16);
+	bench_handles(1000);
+	bench_handles(50000);
+
+	bench_aio(SSUFS_AIO_THREADS);
+	bench_aio(SSUFS_AIO_URING);
+
+	bench_mt(SSUFS_MODE_PREAD);
+	bench_mt(SSUFS_MODE_MMAP);
+
+	bench_append(0);
+	bench_append(SSUFS_FLAG_EXTENTS);
+
+	bench_small(16);
+	bench_small(INLINE_DATA_SIZE);
+	bench_small(100);
+
+	unlink("ssufs");
+	return 0;
+}
@@ -0,0 +1,554 @@
+#include <time.h>
+#include <ctype.h>
+#include "ssufs-ops.h"
+#include "ssufs-cache.h"
+#ifdef __linux__
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#endif
+
+/*
+	fio처럼 workload를 옵션으로 정해서 ssufs를 측정하고 결과를 JSON으로 출력한다.
+	--name=으로 job을 시작하고, 그 뒤의 옵션들은 그 job에만 적용된다. 첫 --name= 앞의 옵션들은 모든 job의 기본값이다.
+	job마다 ssufs를 새로 format하고, numjobs개의 thread가 각자의 디렉토리(j0/, j1/, ...)에서 같은 workload를 돌린다.
+	연산 하나하나의 latency를 log-linear histogram에 모아 p50/p90/p99/p99.9를 구하고,
+	처리량(IOPS, MB/s)과 디스크 이미지에 대한 시스템콜 수(SSUFS_SYSCALLS)를 연산 수로 나눈 값을 함께 출력한다.
+	디스크 이미지는 기본적으로 tmpfs(/dev/shm)에 만들어서 저장장치와 상관없이 같은 결과가 나오도록 한다.
+
+	./ssufs_fio --bs=4k --size=64m --name=seq --rw=read --name=rand --rw=randrw --rwmixread=70
+
+	gcc -O2 -o ssufs_fio ssufs_fio.c ssufs-ops.c ssufs-disk.c ssufs-cache.c ssufs-aio.c ssufs-stats.c -pthread
+*/
+
+#define DEFAULT_IMAGE "/dev/shm/ssufs_fio.img" // tmpfs에 만드는 기본 디스크 이미지
+#define MAX_JOBS 32 // 한번에 정할 수 있는 job 수
+#define MAX_THREADS 64 // job 하나의 최대 numjobs
+#define HIST_SUB_BITS 4 // 2의 거듭제곱 구간 하나를 2^HIST_SUB_BITS개로 나눈다 (오차 1/16 이하)
+#define HIST_BUCKETS SSUFS_HIST_BUCKETS(HIST_SUB_BITS)
+
+enum workload_t { RW_READ, RW_WRITE, RW_RANDREAD, RW_RANDWRITE, RW_RW, RW_RANDRW, RW_CREATE, RW_OPEN, RW_DELETE, RW_META };
+char *WORKLOAD_NAMES[] = { "read", "write", "randread", "randwrite", "rw", "randrw", "create", "open", "delete", "meta" };
+
+struct job_t // 옵션으로 정한 job 하나
+{
+	char name[64];
+	int rw; // workload_t
+	long bs; // 읽기/쓰기 한번의 크기
+	long size; // thread 하나가 쓰는 파일의 크기
+	long ops; // thread 하나가 하는 연산 수 (0이면 데이터 workload는 size / bs, 메타데이터 workload는 nfiles)
+	int nfiles; // 메타데이터 workload에서 thread 하나가 다루는 파일 수
+	int numjobs; // 동시에 돌리는 thread 수
+	int rwmixread; // rw, randrw에서 읽기의 비율 (%)
+	unsigned seed;
+	int fs_block_size; // format할 때의 블록 크기
+	int mode; // SSUFS_MODE_PREAD / SSUFS_MODE_MMAP
+	int extents;
+	int inline_data; // 작은 파일을 inode에 저장할지 (SSUFS_FLAG_INLINE)
+	int cache; // buffer cache 크기 (buffer 수)
+	int readahead; // 미리 읽는 window의 최대 블록 수
+	int delalloc; // delayed allocation 사용 여부
+};
+
+struct histogram_t // latency(ns)의 log-linear histogram
+{
+	long count[HIST_BUCKETS];
+	long total;
+	unsigned long sum, min, max;
+};
+
+struct worker_t // job을 돌리는 thread 하나의 상태와 결과
+{
+	struct job_t *job;
+	int id;
+	struct histogram_t read_lat, write_lat; // 메타데이터 workload는 write_lat에 모은다
+	long read_bytes, write_bytes;
+	long errors;
+};
+
+unsigned long get_nanos() { // 나노초 단위의 현재시간 리턴하는 함수
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+unsigned long histValue(int bucket) { // histogram 칸의 가운데 값
+	unsigned long low = ssufs_histLow(bucket, HIST_SUB_BITS);
+	return low + (ssufs_histHigh(bucket, HIST_SUB_BITS) - low + 1) / 2;
+}
+
+void histAdd(struct histogram_t *hist, unsigned long ns) {
+	hist->count[ssufs_histBucket(ns, HIST_SUB_BITS)]++;
+	if (hist->total == 0 || ns < hist->min)
+		hist->min = ns;
+	if (ns > hist->max)
+		hist->max = ns;
+	hist->total++;
+	hist->sum += ns;
+}
+
+void histMerge(struct histogram_t *to, struct histogram_t *from) {
+	for (int i = 0; i < HIST_BUCKETS; i++)
+		to->count[i] += from->count[i];
+	if (from->total > 0 && (to->total == 0 || from->min < to->min))
+		to->min = from->min;
+	if (from->max > to->max)
+		to->max = from->max;
+	to->total += from->total;
+	to->sum += from->sum;
+}
+
+unsigned long histPercentile(struct histogram_t *hist, double percent) { // 전체의 percent%가 이 값 이하다
+	long rank = (long)(hist->total * percent / 100.0 + 0.5);
+	long seen = 0;
+
+	if (rank < 1)
+		rank = 1;
+	for (int i = 0; i < HIST_BUCKETS; i++) {
+		seen += hist->count[i];
+		if (seen >= rank)
+			return histValue(i) < hist->max ? histValue(i) : hist->max;
+	}
+	return hist->max;
+}
+
+void printHist(char *indent, struct histogram_t *hist) { // latency 통계와 histogram을 JSON object로 출력
+	double percents[] = {1, 5, 10, 50, 90, 95, 99, 99.9, 99.99};
+	int first = 1;
+
+	printf("{\n%s  \"samples\": %ld,\n", indent, hist->total);
+	printf("%s  \"min\": %lu,\n%s  \"max\": %lu,\n", indent, hist->min, indent, hist->max);
+	printf("%s  \"mean\": %.1f,\n", indent, hist->total ? (double)hist->sum / hist->total : 0.0);
+	printf("%s  \"percentile\": {", indent);
+	for (int i = 0; i < (int)(sizeof(percents) / sizeof(double)); i++)
+		printf("%s\"%g\": %lu", i ? ", " : "", percents[i], hist->total ? histPercentile(hist, percents[i]) : 0);
+	printf("},\n%s  \"histogram\": [", indent); // [칸의 가운데 값(ns), 개수] (비어있는 칸은 생략)
+	for (int i = 0; i < HIST_BUCKETS; i++) {
+		if (hist->count[i] == 0)
+			continue;
+		printf("%s[%lu, %ld]", first ? "" : ", ", histValue(i), hist->count[i]);
+		first = 0;
+	}
+	printf("]\n%s}", indent);
+}
+
+long parseSize(char *str) { // "4k", "64m", "1g" 같은 크기 (잘못된 값이면 -1)
+	char *end;
+	long value = strtol(str, &end, 10);
+
+	switch (tolower((unsigned char)*end)) {
+	case 'k': value <<= 10; end++; break;
+	case 'm': value <<= 20; end++; break;
+	case 'g': value <<= 30; end++; break;
+	}
+	if (end == str || *end != '\0' || value < 0)
+		return -1;
+	return value;
+}
+
+void usage() {
+	fprintf(stderr,
+		"usage: ssufs_fio [--image=PATH] [job options] --name=NAME [job options] ...\n"
+		"  --rw=read|write|randread|randwrite|rw|randrw|create|open|delete|meta\n"
+		"  --bs=SIZE --size=SIZE --ops=N --nfiles=N --numjobs=N --rwmixread=PCT --seed=N\n"
+		"  --fs_bs=SIZE --mode=pread|mmap --extents=0|1 --inline=0|1 --cache=NBUFS --readahead=NBLOCKS --delalloc=0|1\n");
+	exit(2);
+}
+
+int setOption(struct job_t *job, char *key, char *value) { // job의 옵션 하나를 정한다 (모르는 옵션이거나 잘못된 값이면 -1)
+	long size;
+
+	if (strcmp(key, "rw") == 0) {
+		for (int i = 0; i < (int)(sizeof(WORKLOAD_NAMES) / sizeof(char *)); i++) {
+			if (strcmp(value, WORKLOAD_NAMES[i]) == 0) {
+				job->rw = i;
+				return 0;
+			}
+		}
+		return -1;
+	}
+	if (strcmp(key, "mode") == 0) {
+		if (strcmp(value, "pread") != 0 && strcmp(value, "mmap") != 0)
+			return -1;
+		job->mode = strcmp(value, "mmap") == 0 ? SSUFS_MODE_MMAP : SSUFS_MODE_PREAD;
+		return 0;
+	}
+	if ((size = parseSize(value)) == -1)
+		return -1;
+	if (strcmp(key, "bs") == 0 && size > 0 && size <= INT_MAX)
+		job->bs = size;
+	else if (strcmp(key, "size") == 0 && size > 0 && size <= INT_MAX)
+		job->size = size;
+	else if (strcmp(key, "ops") == 0)
+		job->ops = size;
+	else if (strcmp(key, "nfiles") == 0 && size > 0 && size <= 1000000)
+		job->nfiles = size;
+	else if (strcmp(key, "numjobs") == 0 && size > 0 && size <= MAX_THREADS)
+		job->numjobs = size;
+	else if (strcmp(key, "rwmixread") == 0 && size <= 100)
+		job->rwmixread = size;
+	else if (strcmp(key, "seed") == 0)
+		job->seed = size;
+	else if (strcmp(key, "fs_bs") == 0 && size >= 64 && (size & (size - 1)) == 0)
+		job->fs_block_size = size;
+	else if (strcmp(key, "extents") == 0)
+		job->extents = size != 0;
+	else if (strcmp(key, "inline") == 0)
+		job->inline_data = size != 0;
+	else if (strcmp(key, "cache") == 0 && size > 0)
+		job->cache = size;
+	else if (strcmp(key, "readahead") == 0)
+		job->readahead = size;
+	else if (strcmp(key, "delalloc") == 0)
+		job->delalloc = size != 0;
+	else
+		return -1;
+	return 0;
+}
+
+int isDataWorkload(struct job_t *job) {
+	return job->rw <= RW_RANDRW;
+}
+
+long jobOps(struct job_t *job) { // thread 하나가 하는 연산 수
+	if (job->rw == RW_DELETE && (job->ops == 0 || job->ops > job->nfiles)) // 미리 만든 파일까지만 지운다
+		return job->nfiles;
+	if (job->ops > 0)
+		return job->ops;
+	return isDataWorkload(job) ? (job->size + job->bs - 1) / job->bs : job->nfiles;
+}
+
+int seekTo(int fd, long *pos, long offset) { // ssufs_lseek()은 현재 위치에서 상대적으로 움직인다
+	if (offset == *pos)
+		return 0;
+	if (ssufs_lseek(fd, (int)(offset - *pos)) == -1)
+		return -1;
+	*pos = offset;
+	return 0;
+}
+
+void fileName(char *name, int worker, int i) { // worker의 디렉토리에 있는 i번째 파일의 경로 (이름은 MAX_NAME_STRLEN 이하)
+	sprintf(name, "j%d/n%d", worker, i);
+}
+
+void *dataWorker(void *arg) { // 자기 파일을 workload대로 읽고 쓰는 thread
+	struct worker_t *worker = (struct worker_t *)arg;
+	struct job_t *job = worker->job;
+	long ops = jobOps(job), blocks = job->size / job->bs, pos = 0;
+	int random = job->rw == RW_RANDREAD || job->rw == RW_RANDWRITE || job->rw == RW_RANDRW;
+	unsigned seed = job->seed + worker->id;
+	char *buf = (char *)malloc(job->bs);
+	char name[32];
+
+	memset(buf, 'f', job->bs);
+	fileName(name, worker->id, 0);
+	int fd = ssufs_open(name);
+	for (long i = 0; i < ops; i++) {
+		int read;
+		long offset;
+
+		if (job->rw == RW_READ || job->rw == RW_RANDREAD)
+			read = 1;
+		else if (job->rw == RW_WRITE || job->rw == RW_RANDWRITE)
+			read = 0;
+		else
+			read = (int)(rand_r(&seed) % 100) < job->rwmixread;
+		if (random)
+			offset = (long)(rand_r(&seed) % blocks) * job->bs;
+		else
+			offset = pos + job->bs <= job->size ? pos : 0; // 파일 끝에 닿으면 처음으로 돌아간다
+
+		unsigned long start = get_nanos();
+		int ret = seekTo(fd, &pos, offset);
+		if (ret == 0)
+			ret = read ? ssufs_read(fd, buf, job->bs) : ssufs_write(fd, buf, job->bs);
+		if (ret == 0)
+			pos += job->bs;
+		histAdd(read ? &worker->read_lat : &worker->write_lat, get_nanos() - start);
+		if (ret == -1) {
+			worker->errors++;
+			ssufs_close(fd); // 위치를 알 수 없으므로 다시 연다
+			fd = ssufs_open(name);
+			pos = 0;
+		} else if (read) {
+			worker->read_bytes += job->bs;
+		} else {
+			worker->write_bytes += job->bs;
+		}
+	}
+	ssufs_close(fd);
+	free(buf);
+	return NULL;
+}
+
+void *metaWorker(void *arg) { // 자기 디렉토리에서 create/open/delete나 메타데이터 연산들을 반복하는 thread
+	struct worker_t *worker = (struct worker_t *)arg;
+	struct job_t *job = worker->job;
+	long ops = jobOps(job);
+	char name[32];
+
+	for (long i = 0; i < ops; i++) {
+		int n = (int)(i % job->nfiles), ret = 0, fd;
+		unsigned long start = get_nanos();
+
+		switch (job->rw) {
+		case RW_CREATE: // 새 파일 만들기 (미리 만든 파일 뒤 번호부터)
+			fileName(name, worker->id, job->nfiles + (int)i);
+			ret = ssufs_create(name);
+			break;
+		case RW_OPEN: // 미리 만든 파일들을 돌아가며 열고 닫기
+			fileName(name, worker->id, n);
+			ret = ssufs_open(name);
+			if (ret != -1)
+				ssufs_close(ret);
+			break;
+		case RW_DELETE: // 미리 만든 파일들을 차례로 지우기
+			fileName(name, worker->id, (int)i);
+			ssufs_delete(name);
+			break;
+		case RW_META: // create, open..close, mkdir, rmdir, delete를 차례로 (데이터 블록은 쓰지 않는다)
+			fileName(name, worker->id, job->nfiles + n / 5);
+			switch (n % 5) {
+			case 0: ret = ssufs_create(name); break;
+			case 1: if ((ret = ssufs_open(name)) != -1) ssufs_close(ret); break;
+			case 2: strcat(name, "d"); ret = ssufs_mkdir(name); break;
+			case 3: strcat(name, "d"); ret = ssufs_rmdir(name); break;
+			case 4: ssufs_delete(name); break;
+			}
+			break;
+		}
+		histAdd(&worker->write_lat, get_nanos() - start);
+		if (job->rw == RW_DELETE && (fd = ssufs_open(name)) != -1) { // 지워졌는지는 측정 구간 밖에서 확인한다
+			ssufs_close(fd);
+			ret = -1;
+		}
+		if (ret == -1)
+			worker->errors++;
+	}
+	return NULL;
+}
+
+int prepareJob(struct job_t *job, char *image) { // job에 맞는 크기로 ssufs를 format하고 thread들의 디렉토리와 파일을 만든다
+	long data_blocks = 0;
+	long inodes = 16 + job->numjobs * 2L;
+	char name[32];
+
+	if (isDataWorkload(job)) {
+		data_blocks = job->numjobs * ((job->size + job->fs_block_size - 1) / job->fs_block_size);
+	} else {
+		inodes += job->numjobs * (job->nfiles + (job->rw == RW_CREATE ? jobOps(job) : 0));
+	}
+	data_blocks += data_blocks / 16 + 1024; // indirect block과 extent block이 들어갈 자리
+	if (data_blocks > INT_MAX || inodes > INT_MAX)
+		return -1;
+
+	ssufs_setDiskPath(image);
+	ssufs_setDiskMode(job->mode);
+	ssufs_setFormatFlags((job->extents ? SSUFS_FLAG_EXTENTS : 0) | (job->inline_data ? SSUFS_FLAG_INLINE : 0));
+	ssufs_setCacheSize(job->cache);
+	ssufs_setReadahead(job->readahead);
+	ssufs_setDelayedAllocation(job->delalloc);
+	if (ssufs_formatDiskGeometry(job->fs_block_size, (int)data_blocks, (int)inodes) == -1)
+		return -1;
+
+	char *buf = (char *)malloc(1 << 20);
+	memset(buf, 'p', 1 << 20);
+	for (int w = 0; w < job->numjobs; w++) {
+		sprintf(name, "j%d", w);
+		if (ssufs_mkdir(name) == -1)
+			return -1;
+		if (isDataWorkload(job)) { // 쓰기만 하는 순차 workload 말고는 파일을 미리 채워둔다
+			fileName(name, w, 0);
+			if (ssufs_create(name) == -1)
+				return -1;
+			if (job->rw == RW_WRITE)
+				continue;
+			int fd = ssufs_open(name);
+			for (long done = 0; done < job->size; done += 1 << 20) {
+				int n = job->size - done < (1 << 20) ? (int)(job->size - done) : 1 << 20;
+				if (ssufs_write(fd, buf, n) == -1)
+					return -1;
+			}
+			ssufs_close(fd);
+		} else if (job->rw != RW_CREATE && job->rw != RW_META) {
+			for (int i = 0; i < job->nfiles; i++) {
+				fileName(name, w, i);
+				if (ssufs_create(name) == -1)
+					return -1;
+			}
+		}
+	}
+	free(buf);
+	ssufs_sync(); // 준비한 내용이 측정 중에 기록되지 않도록 한다
+	return 0;
+}
+
+int tmpfsImage(char *image) { // 디스크 이미지가 tmpfs에 있는지 (알 수 없으면 0)
+#ifdef __linux__
+	char dir[PATH_MAX];
+	struct statfs fs;
+	snprintf(dir, sizeof(dir), "%s", image);
+	char *slash = strrchr(dir, '/');
+	if (slash == NULL)
+		strcpy(dir, ".");
+	else if (slash == dir)
+		dir[1] = '\0';
+	else
+		*slash = '\0';
+	return statfs(dir, &fs) == 0 && fs.f_type == TMPFS_MAGIC;
+#else
+	return 0;
+#endif
+}
+
+void printOpStats(struct ssufs_stats_t *stats) { // ssufs 내부의 연산별 통계 (latency는 표본으로 잰 값)
+	int first = 1;
+
+	printf(",\n      \"ssufs\": {");
+	for (int i = 0; i < SSUFS_OP_COUNT; i++) {
+		struct ssufs_op_stats_t *op = &stats->ops[i];
+		if (op->count == 0)
+			continue;
+		printf("%s\n        \"%s\": {\"count\": %ld, \"errors\": %ld, \"bytes\": %ld, ", first ? "" : ",", ssufs_statName(i), op->count, op->errors, op->bytes);
+		printf("\"timed\": %ld, \"mean_ns\": %.1f, \"p50_ns\": %ld, \"p99_ns\": %ld, \"max_ns\": %ld}", op->timed,
+			op->timed ? (double)op->total_ns / op->timed : 0.0, ssufs_statsPercentile(op, 50), ssufs_statsPercentile(op, 99), op->max_ns);
+		first = 0;
+	}
+	printf("\n      }");
+}
+
+void runJob(struct job_t *job, char *image, int first) { // job 하나를 돌리고 결과를 JSON object로 출력
+	struct worker_t workers[MAX_THREADS];
+	pthread_t threads[MAX_THREADS];
+	struct histogram_t read_lat, write_lat;
+	long read_bytes = 0, write_bytes = 0, errors = 0;
+
+	if (job->bs > job->size && isDataWorkload(job)) {
+		fprintf(stderr, "%s: bs is larger than size\n", job->name);
+		exit(1);
+	}
+	if (prepareJob(job, image) == -1) {
+		fprintf(stderr, "%s: cannot set up the image (too large?)\n", job->name);
+		exit(1);
+	}
+	memset(workers, 0, sizeof(workers));
+	memset(&read_lat, 0, sizeof(read_lat));
+	memset(&write_lat, 0, sizeof(write_lat));
+
+	long syscalls = SSUFS_SYSCALLS;
+	ssufs_resetStats();
+	unsigned long start = get_nanos();
+	for (int i = 0; i < job->numjobs; i++) {
+		workers[i].job = job;
+		workers[i].id = i;
+		pthread_create(&threads[i], NULL, isDataWorkload(job) ? dataWorker : metaWorker, &workers[i]);
+	}
+	for (int i = 0; i < job->numjobs; i++) {
+		pthread_join(threads[i], NULL);
+		histMerge(&read_lat, &workers[i].read_lat);
+		histMerge(&write_lat, &workers[i].write_lat);
+		read_bytes += workers[i].read_bytes;
+		write_bytes += workers[i].write_bytes;
+		errors += workers[i].errors;
+	}
+	ssufs_sync(); // 쓴 내용이 디스크 이미지에 기록될 때까지를 포함한다
+	unsigned long nanos = get_nanos() - start;
+	syscalls = SSUFS_SYSCALLS - syscalls;
+	struct ssufs_stats_t stats;
+	ssufs_stats(&stats);
+	ssufs_unmountDisk();
+
+	long ops = read_lat.total + write_lat.total;
+	double seconds = nanos / 1e9;
+	printf("%s    {\n", first ? "" : ",\n");
+	printf("      \"name\": \"%s\",\n      \"rw\": \"%s\",\n", job->name, WORKLOAD_NAMES[job->rw]);
+	printf("      \"bs\": %ld,\n      \"size\": %ld,\n      \"numjobs\": %d,\n", job->bs, job->size, job->numjobs);
+	if (job->rw == RW_RW || job->rw == RW_RANDRW)
+		printf("      \"rwmixread\": %d,\n", job->rwmixread);
+	if (!isDataWorkload(job))
+		printf("      \"nfiles\": %d,\n", job->nfiles);
+	printf("      \"fs_bs\": %d,\n      \"mode\": \"%s\",\n      \"extents\": %d,\n      \"inline\": %d,\n", job->fs_block_size, job->mode == SSUFS_MODE_MMAP ? "mmap" : "pread", job->extents, job->inline_data);
+	printf("      \"cache\": %d,\n      \"readahead\": %d,\n      \"delalloc\": %d,\n", job->cache, job->readahead, job->delalloc);
+	printf("      \"ops\": %ld,\n      \"errors\": %ld,\n      \"runtime_ns\": %lu,\n", ops, errors, nanos);
+	printf("      \"iops\": %.1f,\n", ops / seconds);
+	printf("      \"bw_mbps\": %.2f,\n", (read_bytes + write_bytes) / seconds / 1e6);
+	printf("      \"syscalls\": %ld,\n      \"syscalls_per_op\": %.4f", syscalls, ops ? (double)syscalls / ops : 0.0);
+	if (isDataWorkload(job)) {
+		if (read_lat.total > 0) {
+			printf(",\n      \"read\": {\n        \"ops\": %ld,\n        \"bytes\": %ld,\n", read_lat.total, read_bytes);
+			printf("        \"iops\": %.1f,\n        \"bw_mbps\": %.2f,\n        \"lat_ns\": ", read_lat.total / seconds, read_bytes / seconds / 1e6);
+			printHist("        ", &read_lat);
+			printf("\n      }");
+		}
+		if (write_lat.total > 0) {
+			printf(",\n      \"write\": {\n        \"ops\": %ld,\n        \"bytes\": %ld,\n", write_lat.total, write_bytes);
+			printf("        \"iops\": %.1f,\n        \"bw_mbps\": %.2f,\n        \"lat_ns\": ", write_lat.total / seconds, write_bytes / seconds / 1e6);
+			printHist("        ", &write_lat);
+			printf("\n      }");
+		}
+	} else {
+		printf(",\n      \"lat_ns\": ");
+		printHist("      ", &write_lat);
+	}
+	printOpStats(&stats);
+	printf("\n    }");
+	fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+	static struct job_t jobs[MAX_JOBS];
+	struct job_t defaults = { // 적지 않은 필드(ops, extents, inline_data)는 0
+		.rw = RW_READ,
+		.bs = 4096,
+		.size = 64 << 20,
+		.nfiles = 1000,
+		.numjobs = 1,
+		.rwmixread = 50,
+		.seed = 1,
+		.fs_block_size = 4096,
+		.mode = SSUFS_MODE_PREAD,
+		.cache = DEFAULT_CACHE_SIZE,
+		.readahead = RA_MAX_BLOCKS,
+		.delalloc = 1,
+	};
+	struct job_t *current = &defaults;
+	char *image = DEFAULT_IMAGE;
+	int njobs = 0;
+
+	if (access("/dev/shm", W_OK) != 0) // tmpfs가 없으면 현재 디렉토리에 만든다
+		image = "ssufs_fio.img";
+	for (int i = 1; i < argc; i++) {
+		char *key = argv[i], *value;
+		if (strncmp(key, "--", 2) != 0 || (value = strchr(key, '=')) == NULL)
+			usage();
+		key += 2;
+		*value++ = '\0';
+		if (strcmp(key, "image") == 0) {
+			image = value;
+		} else if (strcmp(key, "name") == 0) {
+			if (njobs == MAX_JOBS)
+				usage();
+			current = &jobs[njobs++];
+			memcpy(current, &defaults, sizeof(struct job_t));
+			snprintf(current->name, sizeof(current->name), "%s", value);
+		} else if (setOption(current, key, value) == -1) {
+			fprintf(stderr, "bad option --%s=%s\n", key, value);
+			usage();
+		}
+	}
+	if (njobs == 0) { // job을 정하지 않으면 기본값으로 하나를 돌린다
+		memcpy(&jobs[0], &defaults, sizeof(struct job_t));
+		snprintf(jobs[0].name, sizeof(jobs[0].name), "%s", WORKLOAD_NAMES[defaults.rw]);
+		njobs = 1;
+	}
+
+	int tmpfs = tmpfsImage(image);
+	if (!tmpfs)
+		fprintf(stderr, "warning: %s is not on tmpfs, results depend on the storage device\n", image);
+	printf("{\n  \"image\": \"%s\",\n  \"tmpfs\": %s,\n", image, tmpfs ? "true" : "false");
+	printf("  \"cpus\": %ld,\n  \"jobs\": [\n", sysconf(_SC_NPROCESSORS_ONLN));
+	for (int i = 0; i < njobs; i++)
+		runJob(&jobs[i], image, i == 0);
+	printf("\n  ]\n}\n");
+	unlink(image);
+	return 0;
+}
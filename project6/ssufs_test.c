@@ -18,6 +18,363 @@ char buf2[BLOCKSIZE * MAX_FILE_SIZE];
 //    ssufs_dump();
 //}
 
+int failures = 0;
+
+void check(int ok, char *what) // print the result of one check and count failures
+{
+    printf("%s: %s\n", what, ok ? "passed" : "FAILED");
+    if (!ok)
+        failures++;
+}
+
+void fill(char *data, int size, int seed) // test pattern that differs per seed
+{
+    for (int i = 0; i < size; i++)
+        data[i] = 'a' + (i * 7 + seed) % 26;
+}
+
+void freshDisk(int flags) // unmount and format a disk large enough for the tests below
+{
+    ssufs_unmountDisk();
+    ssufs_setFormatFlags(flags);
+    ssufs_formatDiskGeometry(64, 512, 64);
+}
+
+void remount()
+{
+    ssufs_unmountDisk();
+    ssufs_mountDisk();
+}
+
+int putFile(char *path, char *data, int size) // create path holding size bytes of data, 0 on success
+{
+    int fd, ret;
+
+    if (ssufs_create(path) == -1 || (fd = ssufs_open(path)) == -1)
+        return -1;
+    ret = ssufs_write(fd, data, size);
+    ssufs_close(fd);
+    return ret;
+}
+
+int fileMatches(char *path, char *data, int size) // 1 if path holds exactly size bytes of data
+{
+    char *got = malloc(size + 1);
+    int fd, ok;
+
+    if ((fd = ssufs_open(path)) == -1) {
+        free(got);
+        return 0;
+    }
+    ok = ssufs_read(fd, got, size) == 0 && memcmp(got, data, size) == 0 && ssufs_read(fd, got, 1) == -1;
+    ssufs_close(fd);
+    free(got);
+    return ok;
+}
+
+void dirTest()
+{
+    char data[100];
+
+    printf ("***directory test***\n");
+    freshDisk(0);
+    fill(data, sizeof(data), 1);
+    check(ssufs_mkdir("d1") != -1 && ssufs_mkdir("d1/d2") != -1, "mkdir nested");
+    check(putFile("d1/d2/f", data, 100) == 0 && fileMatches("d1/d2/f", data, 100), "file in nested dir");
+    check(putFile("d1/eightchr", data, 10) == 0 && fileMatches("d1/eightchr", data, 10), "name of MAX_NAME_STRLEN");
+    check(ssufs_create("d1/ninechars") == -1, "too long name rejected");
+    check(ssufs_create("d1/d2/f") == -1 && ssufs_mkdir("d1") == -1, "duplicate name rejected");
+    check(ssufs_create("nodir/f") == -1 && ssufs_open("d1/f") == -1, "missing path rejected");
+    check(ssufs_open("d1") == -1, "directory not opened as file");
+    check(ssufs_rmdir("d1/d2") == -1, "non-empty rmdir rejected");
+    ssufs_delete("d1/d2/f");
+    ssufs_delete("d1/eightchr");
+    check(ssufs_rmdir("d1/d2") == 0 && ssufs_rmdir("d1") == 0, "rmdir after delete");
+
+    // the path cache must not keep d1/d2 alive after it was removed
+    check(ssufs_create("d1") != -1 && ssufs_create("d1/d2/g") == -1, "removed dir forgotten by path cache");
+    ssufs_delete("d1");
+    check(ssufs_mkdir("d1") != -1 && ssufs_mkdir("d1/d2") != -1 && putFile("d1/d2/g", data, 50) == 0, "recreated dir usable");
+    check(fileMatches("d1/d2/g", data, 50) && ssufs_open("d1/d2/f") == -1, "recreated dir has only new files");
+}
+
+void nameTest()
+{
+    char name[16];
+    int ok = 1;
+
+    printf ("***name lookup test***\n");
+    freshDisk(0);
+    ssufs_mkdir("d");
+    for (int i = 0; i < 20; i++) { // the same names in two directories
+        sprintf(name, "f%d", i);
+        ok = ok && ssufs_create(name) != -1;
+        sprintf(name, "d/f%d", i);
+        ok = ok && ssufs_create(name) != -1;
+    }
+    check(ok, "create 40 files");
+    for (int i = 0; i < 20; i += 2) {
+        sprintf(name, i % 4 ? "d/f%d" : "f%d", i);
+        ssufs_delete(name);
+    }
+    for (int i = 0; i < 20; i++) {
+        int fd;
+
+        sprintf(name, "f%d", i);
+        fd = ssufs_open(name);
+        ok = ok && (fd != -1) == (i % 4 != 0);
+        if (fd != -1)
+            ssufs_close(fd);
+        sprintf(name, "d/f%d", i);
+        fd = ssufs_open(name);
+        ok = ok && (fd != -1) == (i % 4 != 2);
+        if (fd != -1)
+            ssufs_close(fd);
+    }
+    check(ok, "lookup after deleting some names");
+}
+
+void remountTest()
+{
+    char data[300], data2[300];
+
+    printf ("***remount test***\n");
+    freshDisk(0);
+    fill(data, sizeof(data), 2);
+    fill(data2, sizeof(data2), 3);
+    ssufs_mkdir("d");
+    putFile("d/f", data, 300);
+    putFile("g", data, 100);
+    remount();
+    check(fileMatches("d/f", data, 300) && fileMatches("g", data, 100), "files kept after remount");
+    check(ssufs_create("d") == -1 && ssufs_rmdir("d") == -1, "directory kept after remount");
+
+    // blocks allocated before the remount must still be marked in use
+    check(putFile("h", data2, 300) == 0 && fileMatches("d/f", data, 300) && fileMatches("h", data2, 300), "free space kept after remount");
+}
+
+int extentCount(char *path) // number of extents of path (-1 if it does not exist)
+{
+    int inodenum = open_namei(path), count;
+
+    if (inodenum == -1)
+        return -1;
+    count = ssufs_getInode(inodenum)->num_extents;
+    ssufs_putInode(inodenum);
+    return count;
+}
+
+void extentTest()
+{
+    char data[1280], data2[1280];
+    int fd1, fd2, ok = 1;
+
+    printf ("***extent test***\n");
+    freshDisk(SSUFS_FLAG_EXTENTS);
+    fill(data, sizeof(data), 4);
+    fill(data2, sizeof(data2), 5);
+    check(putFile("seq", data, 1280) == 0 && fileMatches("seq", data, 1280), "sequential file");
+    check(extentCount("seq") == 1, "sequential file in one extent");
+
+    // two files growing block by block in turn get interleaved blocks
+    ssufs_setDelayedAllocation(0);
+    remount();
+    ssufs_create("a");
+    ssufs_create("b");
+    fd1 = ssufs_open("a");
+    fd2 = ssufs_open("b");
+    for (int i = 0; i < 1280; i += 64)
+        ok = ok && ssufs_write(fd1, data + i, 64) == 0 && ssufs_write(fd2, data2 + i, 64) == 0;
+    ssufs_close(fd1);
+    ssufs_close(fd2);
+    ssufs_setDelayedAllocation(1);
+    check(ok && extentCount("a") > NUM_INLINE_EXTENTS, "interleaved file spills into extent block");
+    remount();
+    check(fileMatches("a", data, 1280) && fileMatches("b", data2, 1280), "interleaved files after remount");
+
+    // overwrite in the middle keeps the mapping
+    fd1 = ssufs_open("seq");
+    ok = ssufs_lseek(fd1, 100) == 0 && ssufs_write(fd1, data2, 500) == 0;
+    ssufs_close(fd1);
+    memcpy(data + 100, data2, 500);
+    check(ok && fileMatches("seq", data, 1280) && extentCount("seq") == 1, "overwrite inside extent");
+}
+
+void vectorTest()
+{
+    char data[300], got[300];
+    struct iovec out[3] = { { data, 10 }, { data + 10, 130 }, { data + 140, 160 } };
+    struct iovec in[2] = { { got, 75 }, { got + 75, 225 } };
+    int fd, ok;
+
+    printf ("***readv/writev test***\n");
+    freshDisk(0);
+    fill(data, sizeof(data), 6);
+    ssufs_create("v");
+    fd = ssufs_open("v");
+    check(ssufs_writev(fd, out, 3) == 0, "writev across blocks");
+    memset(got, 0, sizeof(got));
+    ok = ssufs_lseek(fd, -300) == 0 && ssufs_readv(fd, in, 2) == 0;
+    check(ok && memcmp(got, data, 300) == 0, "readv with a different split");
+    check(ssufs_readv(fd, in, 1) == -1, "readv past the end rejected");
+    ssufs_close(fd);
+    check(fileMatches("v", data, 300), "writev content through read");
+}
+
+void aioTest()
+{
+    char data[1000], got[1000];
+    struct ssufs_completion_t done[4];
+    int fd, n, ok;
+
+    printf ("***aio test***\n");
+    freshDisk(0);
+    fill(data, sizeof(data), 7);
+    ssufs_aioInit(SSUFS_AIO_THREADS, 2, 2);
+    ssufs_create("aio");
+    fd = ssufs_open("aio");
+
+    ok = ssufs_submit_write(fd, data, 500, 0, (void *)1) == 0 && ssufs_submit_write(fd, data + 500, 500, 500, (void *)2) == 0;
+    check(ok && ssufs_submit_write(fd, data, 10, 0, (void *)3) == -1, "submit beyond queue depth rejected");
+    n = ssufs_poll_completions(done, 4, 2);
+    check(n == 2 && done[0].result == 500 && done[1].result == 500 && (long)done[0].data + (long)done[1].data == 3, "write completions");
+
+    memset(got, 0, sizeof(got));
+    ok = ssufs_submit_read(fd, got, 600, 0, NULL) == 0 && ssufs_submit_read(fd, got + 600, 400, 600, NULL) == 0;
+    n = ssufs_poll_completions(done, 4, 2);
+    check(ok && n == 2 && done[0].result + done[1].result == 1000 && memcmp(got, data, 1000) == 0, "read completions");
+    check(ssufs_submit_read(fd, got, 10, 995, NULL) == -1, "read past the end rejected");
+    ssufs_close(fd);
+    check(fileMatches("aio", data, 1000), "aio write content through read");
+    ssufs_aioShutdown();
+}
+
+int allocatedBlocks(char *path) // data blocks allocated to path so far (the rest are delayed)
+{
+    int inodenum = open_namei(path), count;
+
+    ssufs_getInode(inodenum);
+    count = ssufs_allocatedBlocks(inodenum);
+    ssufs_putInode(inodenum);
+    return count;
+}
+
+void delayedTest()
+{
+    static char data[4000], got[4000];
+    char name[16], block[64];
+    int fd, size, files;
+
+    printf ("***delayed allocation test***\n");
+    freshDisk(0);
+    fill(data, sizeof(data), 8);
+    ssufs_create("del");
+    fd = ssufs_open("del");
+    ssufs_write(fd, data, 640);
+    check(allocatedBlocks("del") == 0, "appended blocks delayed while open");
+    check(ssufs_lseek(fd, -640) == 0 && ssufs_read(fd, got, 640) == 0 && memcmp(got, data, 640) == 0, "delayed blocks readable");
+    ssufs_close(fd);
+    check(allocatedBlocks("del") == 10 && fileMatches("del", data, 640), "delayed blocks allocated on close");
+
+    // a full disk must fail the write, never the close that flushes it
+    ssufs_unmountDisk();
+    ssufs_setFormatFlags(0);
+    ssufs_formatDiskGeometry(64, 48, 16);
+    ssufs_create("full");
+    fd = ssufs_open("full");
+    for (size = 0; size + 200 <= (int)sizeof(data) && ssufs_write(fd, data + size, 200) == 0; size += 200)
+        ;
+    ssufs_close(fd);
+    check(size < (int)sizeof(data) && fileMatches("full", data, size), "acknowledged writes kept on a full disk");
+    remount();
+    check(fileMatches("full", data, size), "acknowledged writes kept after remount");
+
+    // free space split into single blocks: every delayed block may need its own extent
+    ssufs_unmountDisk();
+    ssufs_setFormatFlags(SSUFS_FLAG_EXTENTS);
+    ssufs_formatDiskGeometry(64, 200, 220);
+    memset(block, 'x', sizeof(block));
+    for (files = 0; files < 210; files++) {
+        sprintf(name, "s%d", files);
+        if (putFile(name, block, 64) == -1) {
+            ssufs_delete(name);
+            break;
+        }
+    }
+    for (int i = 0; i < files; i += 2) {
+        sprintf(name, "s%d", i);
+        ssufs_delete(name);
+    }
+    ssufs_sync();
+    ssufs_create("frag");
+    fd = ssufs_open("frag");
+    for (size = 0; size + 50 <= 3000 && ssufs_write(fd, data + size, 50) == 0; size += 50)
+        ;
+    ssufs_close(fd);
+    check(size > 0 && fileMatches("frag", data, size), "acknowledged writes kept on fragmented disk");
+    remount();
+    check(fileMatches("frag", data, size), "fragmented file after remount");
+}
+
+void handleTest()
+{
+    char data[100], got[100];
+    int fd1, fd2, ok;
+
+    printf ("***file handle test***\n");
+    freshDisk(0);
+    fill(data, sizeof(data), 9);
+    putFile("h1", data, 100);
+    putFile("h2", data, 100);
+    fd1 = ssufs_open("h1");
+    ssufs_close(fd1);
+    fd2 = ssufs_open("h2"); // takes the slot fd1 had
+    check(fd2 != -1 && fd2 != fd1 && (fd2 & (MAX_OPEN_FILES - 1)) == (fd1 & (MAX_OPEN_FILES - 1)), "reopened slot gets a new handle");
+    ok = ssufs_read(fd1, got, 10) == -1 && ssufs_write(fd1, data, 10) == -1 && ssufs_lseek(fd1, 0) == -1;
+    check(ok, "stale handle rejected");
+    ssufs_close(fd1);
+    check(ssufs_read(fd2, got, 100) == 0 && memcmp(got, data, 100) == 0, "closing stale handle leaves new one open");
+    ssufs_close(fd2);
+    check(fileMatches("h1", data, 100), "stale write did not reach the file");
+}
+
+int isInline(char *path) // 1 if the content of path sits in its inode
+{
+    int inodenum = open_namei(path), ret;
+
+    ret = ssufs_isInline(ssufs_getInode(inodenum));
+    ssufs_putInode(inodenum);
+    return ret;
+}
+
+void inlineTest()
+{
+    int flags[] = { SSUFS_FLAG_INLINE, SSUFS_FLAG_INLINE | SSUFS_FLAG_EXTENTS };
+    char data[200], what[64];
+    int fd, ok;
+
+    printf ("***inline data test***\n");
+    fill(data, sizeof(data), 10);
+    for (int i = 0; i < 2; i++) {
+        freshDisk(flags[i]);
+        ok = putFile("small", data, INLINE_DATA_SIZE) == 0 && isInline("small") && allocatedBlocks("small") == 0;
+        sprintf(what, "small file stored inline (flags %d)", flags[i]);
+        check(ok && fileMatches("small", data, INLINE_DATA_SIZE), what);
+        remount();
+        sprintf(what, "inline file after remount (flags %d)", flags[i]);
+        check(isInline("small") && fileMatches("small", data, INLINE_DATA_SIZE), what);
+
+        fd = ssufs_open("small");
+        ok = ssufs_lseek(fd, INLINE_DATA_SIZE) == 0 && ssufs_write(fd, data + INLINE_DATA_SIZE, 200 - INLINE_DATA_SIZE) == 0;
+        ssufs_close(fd);
+        sprintf(what, "growing file moved out of inode (flags %d)", flags[i]);
+        check(ok && !isInline("small") && allocatedBlocks("small") == 4 && fileMatches("small", data, 200), what);
+        remount();
+        sprintf(what, "moved file after remount (flags %d)", flags[i]);
+        check(fileMatches("small", data, 200), what);
+    }
+}
+
 int main()
 {
     char str[] = "!-------32 Bytes of Data-------!!-------32 Bytes of Data-------!";
@@ -78,4 +435,18 @@ int main()
     ssufs_dump();
     ssufs_delete("f2.txt");
     ssufs_dump();
+
+    dirTest();
+    nameTest();
+    remountTest();
+    extentTest();
+    vectorTest();
+    aioTest();
+    delayedTest();
+    handleTest();
+    inlineTest();
+
+    ssufs_unmountDisk();
+    printf("%d checks failed\n", failures);
+    return failures != 0;
 }
@@ -1,6 +1,6 @@
 #!/bin/bash
 
-gcc -o ssufs_test ssufs_test.c ssufs-ops.c ssufs-disk.c
+gcc -o ssufs_test ssufs_test.c ssufs-ops.c ssufs-disk.c ssufs-cache.c ssufs-aio.c ssufs-stats.c -pthread
 ./ssufs_test
 
 rm -f ssufs